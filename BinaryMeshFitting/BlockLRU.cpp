@@ -0,0 +1,162 @@
+#include "PCH.h"
+#include "BlockLRU.hpp"
+#include "DMCChunk.hpp"
+
+BlockLRU::BlockLRU() : max_bytes(0), bytes(0), density_allocator(0), binary_allocator(0), hits(0), misses(0), inserts(0), evictions(0)
+{
+}
+
+BlockLRU::~BlockLRU()
+{
+	clear();
+}
+
+void BlockLRU::init(size_t _max_bytes, ResourceAllocator<DensityBlock>* _density_allocator, ResourceAllocator<BinaryBlock>* _binary_allocator)
+{
+	clear();
+	std::unique_lock<std::mutex> lock(_mutex);
+	max_bytes = _max_bytes;
+	density_allocator = _density_allocator;
+	binary_allocator = _binary_allocator;
+}
+
+void BlockLRU::put(uint64_t sample_key, uint64_t morton_code, DMCChunk* chunk)
+{
+	Entry e;
+	e.key.sample_key = sample_key;
+	e.key.morton_code = morton_code;
+	e.overlap = chunk->overlap;
+	e.dim = chunk->dim;
+	e.contains_mesh = chunk->contains_mesh;
+	e.edit_serial = chunk->edit_serial;
+	e.density_block = chunk->density_block;
+	e.packed_block = 0;
+	e.binary_block = chunk->binary_block;
+	chunk->density_block = 0;
+	chunk->binary_block = 0;
+
+	if (!max_bytes || !e.density_block || !e.binary_block)
+	{
+		density_allocator->free_element(e.density_block);
+		binary_allocator->free_element(e.binary_block);
+		return;
+	}
+
+	uint32_t binary_words = (((e.dim + 31) / 32 * 32) * e.dim * e.dim + 31) / 32;
+	e.bytes = sizeof(Entry) + sizeof(uint32_t) * binary_words;
+	if (BLOCK_LRU_PACK_DENSITIES && !e.edit_serial)
+	{
+		e.packed_block = packed_allocator.new_element();
+		e.packed_block->pack(e.density_block->data, e.binary_block->data, e.dim);
+		density_allocator->free_element(e.density_block);
+		e.density_block = 0;
+		e.bytes += e.packed_block->bytes();
+	}
+	else
+		e.bytes += sizeof(float) * e.dim * e.dim * e.dim;
+
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	auto search = lookup.find(e.key);
+	if (search != lookup.end())
+		erase(search->second);
+
+	entries.push_front(e);
+	lookup[e.key] = entries.begin();
+	bytes += e.bytes;
+	inserts++;
+
+	while (bytes > max_bytes && !entries.empty())
+	{
+		erase(std::prev(entries.end()));
+		evictions++;
+	}
+}
+
+bool BlockLRU::contains(uint64_t sample_key, uint64_t morton_code, float overlap, uint32_t dim)
+{
+	if (!max_bytes)
+		return false;
+
+	Key key;
+	key.sample_key = sample_key;
+	key.morton_code = morton_code;
+
+	std::unique_lock<std::mutex> lock(_mutex);
+	auto search = lookup.find(key);
+	return search != lookup.end() && search->second->overlap == overlap && search->second->dim == dim;
+}
+
+bool BlockLRU::take(uint64_t sample_key, uint64_t morton_code, float overlap, DMCChunk* chunk)
+{
+	if (!max_bytes)
+		return false;
+
+	Key key;
+	key.sample_key = sample_key;
+	key.morton_code = morton_code;
+
+	Entry e;
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		auto search = lookup.find(key);
+		if (search == lookup.end() || search->second->overlap != overlap || search->second->dim != chunk->dim)
+		{
+			misses++;
+			return false;
+		}
+		e = *search->second;
+		bytes -= e.bytes;
+		entries.erase(search->second);
+		lookup.erase(search);
+		hits++;
+	}
+
+	if (e.packed_block)
+	{
+		e.density_block = density_allocator->new_element();
+		e.density_block->init(e.dim * e.dim * e.dim);
+		e.density_block->complete = false;
+		e.packed_block->unpack(e.density_block->data, e.binary_block->data);
+		packed_allocator.free_element(e.packed_block);
+	}
+
+	density_allocator->free_element(chunk->density_block);
+	binary_allocator->free_element(chunk->binary_block);
+	chunk->density_block = e.density_block;
+	chunk->binary_block = e.binary_block;
+	chunk->contains_mesh = e.contains_mesh;
+	chunk->edit_serial = e.edit_serial;
+	chunk->set_bounds(overlap);
+	return true;
+}
+
+void BlockLRU::clear()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	while (!entries.empty())
+		erase(entries.begin());
+}
+
+BlockLRUStats BlockLRU::stats()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	BlockLRUStats s;
+	s.hits = hits;
+	s.misses = misses;
+	s.inserts = inserts;
+	s.evictions = evictions;
+	s.entries = entries.size();
+	s.bytes = bytes;
+	return s;
+}
+
+void BlockLRU::erase(std::list<Entry>::iterator it)
+{
+	density_allocator->free_element(it->density_block);
+	packed_allocator.free_element(it->packed_block);
+	binary_allocator->free_element(it->binary_block);
+	bytes -= it->bytes;
+	lookup.erase(it->key);
+	entries.erase(it);
+}
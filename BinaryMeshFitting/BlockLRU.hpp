@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include "ResourceAllocator.hpp"
+#include "ChunkBlocks.hpp"
+#include "PackedDensity.hpp"
+
+// Densities of unedited chunks are kept as PackedDensityBlocks, edited ones stay as floats so
+// further brushes can be composed on top of them
+#define BLOCK_LRU_PACK_DENSITIES 1
+
+struct BlockLRUStats
+{
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t inserts;
+	uint64_t evictions;
+	size_t entries;
+	size_t bytes;
+};
+
+// Keeps the density and binary blocks of recently finished chunks, so re-meshing one (after an
+// edit, or a settings change that leaves its samples alone) restarts at label_edges instead of
+// sampling again. Bounded by bytes like MeshLRU, the least recently stored entries are freed first.
+// Entries are keyed by Morton code and a key of only the settings the samples depend on.
+// Packed densities are unpacked on take, after which they are only exact near the surface.
+class BlockLRU
+{
+public:
+	BlockLRU();
+	~BlockLRU();
+
+	void init(size_t max_bytes, ResourceAllocator<DensityBlock>* density_allocator, ResourceAllocator<BinaryBlock>* binary_allocator);
+	inline bool is_enabled() const { return max_bytes > 0; }
+
+	// Takes the chunk's density and binary blocks, freeing them if the cache is disabled
+	void put(uint64_t sample_key, uint64_t morton_code, class DMCChunk* chunk);
+	// On a hit, moves the blocks back into the chunk along with contains_mesh, edit_serial and its bounds
+	bool take(uint64_t sample_key, uint64_t morton_code, float overlap, class DMCChunk* chunk);
+	// Whether take would hit, without counting towards the stats
+	bool contains(uint64_t sample_key, uint64_t morton_code, float overlap, uint32_t dim);
+	void clear();
+
+	BlockLRUStats stats();
+
+private:
+	struct Key
+	{
+		uint64_t sample_key;
+		uint64_t morton_code;
+
+		inline bool operator==(const Key& other) const { return sample_key == other.sample_key && morton_code == other.morton_code; }
+	};
+
+	struct KeyHash
+	{
+		inline size_t operator()(const Key& k) const { return (size_t)(k.morton_code * 0x9E3779B97F4A7C15ull ^ k.sample_key); }
+	};
+
+	struct Entry
+	{
+		Key key;
+		float overlap;
+		uint32_t dim;
+		bool contains_mesh;
+		uint32_t edit_serial;
+		DensityBlock* density_block;
+		PackedDensityBlock* packed_block;
+		BinaryBlock* binary_block;
+		size_t bytes;
+	};
+
+	std::mutex _mutex;
+	size_t max_bytes;
+	size_t bytes;
+	ResourceAllocator<DensityBlock>* density_allocator;
+	ResourceAllocator<BinaryBlock>* binary_allocator;
+	ResourceAllocator<PackedDensityBlock> packed_allocator;
+	std::list<Entry> entries;	// Most recent first
+	std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> lookup;
+
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t inserts;
+	uint64_t evictions;
+
+	void erase(std::list<Entry>::iterator it);
+};
@@ -1,2 +1,2 @@
 # File generated by CMake process
-set(sources ChunkGenerator.cpp;ColorMapper.cpp;Core.cpp;DMCChunk.cpp;DebugScene.cpp;DynamicGLChunk.cpp;Entry.cpp;FPSCamera.cpp;Frustum.cpp;GLChunk.cpp;ImplicitSampler.cpp;MeshProcessor.cpp;NoiseSampler.cpp;PCH.cpp;Texture.cpp;WorldOctree.cpp;WorldOctreeNode.cpp;WorldStitcher.cpp;WorldWatcher.cpp)
+set(sources BlockLRU.cpp;ChunkGenerator.cpp;ChunkMesh.cpp;ColorMapper.cpp;Core.cpp;DMCChunk.cpp;DebugScene.cpp;DynamicGLChunk.cpp;EditLayer.cpp;Entry.cpp;FPSCamera.cpp;Frustum.cpp;GLChunk.cpp;HeightfieldCache.cpp;ImplicitSampler.cpp;JobSystem.cpp;MappedFile.cpp;MeshArchive.cpp;MeshCache.cpp;MeshLRU.cpp;MeshProcessor.cpp;MeshTiles.cpp;NoiseSampler.cpp;PCH.cpp;PackedDensity.cpp;SignMask.cpp;SlabStore.cpp;Texture.cpp;WorldBaker.cpp;WorldOctree.cpp;WorldOctreeNode.cpp;WorldStitcher.cpp;WorldWatcher.cpp)
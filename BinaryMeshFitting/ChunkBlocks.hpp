@@ -1,8 +1,12 @@
 #pragma once
 
 #include <cstdint>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 #include <string>
 #include <FastNoiseSIMD.h>
+#include "NoiseVectorSet.hpp"
 #include "LinkedNode.hpp"
 #include "Vertices.hpp"
 
@@ -26,12 +30,14 @@ struct BinaryBlock : public LinkedNode<BinaryBlock>
 		initialized = false;
 	}
 
+	// Blocks are pooled across chunks of every resolution, they only grow
 	void init(uint32_t _raw_size, uint32_t _binary_size)
 	{
-		if (initialized)
+		if (initialized && size >= _binary_size)
 			return;
 		_aligned_free(data);
 		data = (uint32_t*)_aligned_malloc(sizeof(uint32_t) * _binary_size, 16);
+		size = _binary_size;
 		initialized = true;
 	}
 };
@@ -41,10 +47,12 @@ struct DensityBlock : public LinkedNode<DensityBlock>
 	uint32_t size;
 	float* data;
 	bool initialized;
+	bool complete;	// Every sample holds its real density, not only those near the surface
 
 	inline DensityBlock()
 	{
 		initialized = false;
+		complete = false;
 		size = 0;
 		data = 0;
 	}
@@ -58,10 +66,11 @@ struct DensityBlock : public LinkedNode<DensityBlock>
 
 	void init(uint32_t _size)
 	{
-		if (initialized)
+		if (initialized && size >= _size)
 			return;
 		_aligned_free(data);
 		data = (float*)_aligned_malloc(sizeof(float) * _size, 16);
+		size = _size;
 		initialized = true;
 	}
 };
@@ -88,10 +97,11 @@ struct IsoVertexBlock : public LinkedNode<IsoVertexBlock>
 
 	void init(uint32_t _size)
 	{
-		if (initialized)
+		if (initialized && size >= _size)
 			return;
 		_aligned_free(data);
 		data = (DMC_Isovertex*)_aligned_malloc(sizeof(DMC_Isovertex) * _size, 16);
+		size = _size;
 		initialized = true;
 	}
 };
@@ -100,7 +110,8 @@ struct NoiseBlock : public LinkedNode<NoiseBlock>
 {
 	uint32_t size;
 	float* dest_noise;
-	FastNoiseVectorSet vectorset;
+	float* samples;	// Output of partial block samples, see DMCChunk::sample_hierarchical
+	NoiseVectorSet vectorset;
 	bool initialized;
 
 	inline NoiseBlock()
@@ -108,22 +119,27 @@ struct NoiseBlock : public LinkedNode<NoiseBlock>
 		initialized = false;
 		size = 0;
 		dest_noise = 0;
+		samples = 0;
 	}
 
 	inline ~NoiseBlock()
 	{
 		_aligned_free(dest_noise);
+		_aligned_free(samples);
 		size = 0;
 		initialized = false;
 	}
 
 	void init(uint32_t noise_size)
 	{
-		if (initialized)
+		if (initialized && size >= noise_size)
 			return;
 		_aligned_free(dest_noise);
+		_aligned_free(samples);
+		size = noise_size;
 		dest_noise = (float*)_aligned_malloc(sizeof(float) * noise_size, 16);
-		vectorset.SetSize(noise_size);
+		samples = (float*)_aligned_malloc(sizeof(float) * noise_size, 16);
+		vectorset.prepare((int)noise_size);
 		initialized = true;
 	}
 };
@@ -150,17 +166,18 @@ struct MasksBlock : public LinkedNode<MasksBlock>
 
 	void init(uint32_t _size)
 	{
-		if (initialized)
+		if (initialized && size >= _size)
 			return;
 		_aligned_free(data);
 		data = (uint64_t*)_aligned_malloc(sizeof(uint64_t) * _size, 16);
+		size = _size;
 		initialized = true;
 	}
 };
 
 struct VerticesIndicesBlock : public LinkedNode<VerticesIndicesBlock>
 {
-	SmartContainer<DualVertex> vertices;
+	DualVertexStore vertices;
 	SmartContainer<uint32_t> mesh_indexes;
 
 	inline VerticesIndicesBlock()
@@ -178,34 +195,68 @@ struct VerticesIndicesBlock : public LinkedNode<VerticesIndicesBlock>
 	}
 };
 
+inline uint32_t popcount64(uint64_t x)
+{
+#ifdef _MSC_VER
+	return (uint32_t)__popcnt64(x);
+#else
+	return (uint32_t)__builtin_popcountll(x);
+#endif
+}
+
+// Sparse index of the active cells in a chunk. Cells are emitted in x, y, z order, so each
+// 64-cell run of a z row only needs an occupancy word and the index of its first cell;
+// a cell's index is that offset plus the number of occupied cells below it in the word.
 struct IndexesBlock : public LinkedNode<IndexesBlock>
 {
 	uint32_t size;
-	uint32_t* inds;
+	uint32_t dim;
+	uint32_t words_per_row;
+	uint64_t* occupancy;
+	uint32_t* offsets;
 	bool initialized;
 
 	inline IndexesBlock()
 	{
 		initialized = false;
 		size = 0;
-		inds = 0;
+		dim = 0;
+		words_per_row = 0;
+		occupancy = 0;
+		offsets = 0;
 	}
 
 	inline ~IndexesBlock()
 	{
-		_aligned_free(inds);
+		_aligned_free(occupancy);
+		_aligned_free(offsets);
 		size = 0;
 		initialized = false;
 	}
 
-	void init(uint32_t size)
+	void init(uint32_t _dim)
 	{
-		if (initialized)
+		dim = _dim;
+		words_per_row = (_dim + 63) / 64;
+		uint32_t needed = _dim * _dim * words_per_row;
+		if (initialized && size >= needed)
 			return;
-		_aligned_free(inds);
-		inds = (uint32_t*)_aligned_malloc(sizeof(uint32_t) * size, 16);
+		_aligned_free(occupancy);
+		_aligned_free(offsets);
+		occupancy = (uint64_t*)_aligned_malloc(sizeof(uint64_t) * needed, 16);
+		offsets = (uint32_t*)_aligned_malloc(sizeof(uint32_t) * needed, 16);
+		size = needed;
 		initialized = true;
 	}
+
+	inline uint32_t find(uint32_t x, uint32_t y, uint32_t z) const
+	{
+		uint32_t w = (x * dim + y) * words_per_row + (z >> 6);
+		uint64_t bit = 1ull << (z & 63);
+		if (!(occupancy[w] & bit))
+			return (uint32_t)-1;
+		return offsets[w] + popcount64(occupancy[w] & (bit - 1));
+	}
 };
 
 struct DMC_CellsBlock : public LinkedNode<DMC_CellsBlock>
@@ -7,25 +7,54 @@
 #include "DMCChunk.hpp"
 #include "NoiseSampler.hpp"
 #include <iostream>
+#include <algorithm>
+
+// Heightfield tiles missing for a batch are sampled together, about this many columns per noise call
+#define HEIGHTFIELD_BATCH_POINTS 16384
 
 ChunkGenerator::ChunkGenerator() : ThreadDebug("ChunkGenerator")
 {
 	this->world = 0;
+	this->cancel_stale = false;
 }
 
 ChunkGenerator::~ChunkGenerator()
 {
-	world->generator_shutdown = true;
+	// Never initialized when only its allocators were used, as in bmf_bench
+	if (world)
+		world->generator_shutdown = true;
+	jobs.shutdown();
 }
 
 void ChunkGenerator::init(WorldOctree* _world)
 {
 	this->world = _world;
-	this->stitcher.init();
+	if (!world->properties.mesh_cache_path.empty())
+		mesh_cache.init(world->properties.mesh_cache_path);
+	if (!world->properties.baked_mesh_path.empty())
+		baked_tiles.init(world->properties.baked_mesh_path);
+	mesh_lru.init(world->properties.mesh_lru_bytes, &vi_allocator);
+	block_lru.init(world->properties.block_lru_bytes, &density_allocator, &binary_allocator);
+	slab_store.init(world->properties.slab_store_bytes);
+}
+
+void ChunkGenerator::retire_mesh(WorldOctreeNode* n)
+{
+	DMCChunk* chunk = n->chunk;
+	// A chunk with a mesh but no vi was already retired after its upload
+	if (!chunk || (chunk->contains_mesh && !chunk->vi))
+		return;
+	// Meshes of edited chunks no longer match the settings they'd be looked up by
+	if (chunk->params_key && !chunk->edit_serial)
+		mesh_lru.put(chunk->params_key, n->morton_code.code, chunk->overlap, chunk->contains_mesh, chunk->vi);
+	else
+		vi_allocator.free_element(chunk->vi);
+	chunk->vi = 0;
 }
 
-void ChunkGenerator::process_queue(SmartContainer<WorldOctreeNode*>& batch)
+void ChunkGenerator::process_queue(SmartContainer<WorldOctreeNode*>& batch, bool _cancel_stale)
 {
+	cancel_stale = _cancel_stale;
 	int count = (int)batch.count;
 	{
 		std::unique_lock<std::mutex> c_lock(world->chunk_mutex);
@@ -33,6 +62,8 @@ void ChunkGenerator::process_queue(SmartContainer<WorldOctreeNode*>& batch)
 		{
 			if (!batch[i]->chunk)
 				generate_chunk(batch[i]);
+			else
+				world->classify_chunk(batch[i]);
 		}
 	}
 
@@ -61,14 +92,17 @@ void ChunkGenerator::process_queue(SmartContainer<WorldOctreeNode*>& batch)
 
 bool ChunkGenerator::update_still_needed(WorldOctreeNode* n)
 {
-	return true;
-	if (!n->parent)
+	// Only the children of a split can go stale, a group regenerates the node that stays
+	// and an edit re-meshes one that is already drawn
+	if (!cancel_stale || !n->parent || (n->flags & (NODE_FLAGS_GROUP | NODE_FLAGS_EDITED)))
 		return true;
 	WorldOctreeNode* p = (WorldOctreeNode*)n->parent;
-	//if (!(p->flags & NODE_FLAGS_SPLIT))
-	//	return true;
 
-	glm::vec3 focus_pos = world->watcher.focus_pos;
+	glm::vec3 focus_pos;
+	{
+		std::unique_lock<std::mutex> lock(world->watcher._mutex);
+		focus_pos = world->watcher.focus_pos;
+	}
 	return !world->node_needs_group(focus_pos, p);
 }
 
@@ -79,71 +113,287 @@ void ChunkGenerator::generate_chunk(WorldOctreeNode* n)
 
 void ChunkGenerator::extract_chunk(SmartContainer<class WorldOctreeNode*>& batch)
 {
-	Sampler& sampler = world->sampler;
+	ChunkJobSettings& settings = job_settings;
+	settings.iters = world->properties.process_iters;
+	settings.max_level = world->properties.max_level;
+	settings.boundary_processing = world->properties.boundary_processing;
+	settings.retain_all_blocks = world->properties.retain_all_blocks;
+	settings.base_overlap = world->properties.overlap;
+	settings.world_size = world->sampler.world_size;
+	settings.sampler_type = world->sampler.type;
+	settings.noise_properties = world->noise_properties;
+
+	int threads = world->properties.num_threads;
+	threads = (threads < 1 ? 1 : threads);
+	if (jobs.get_thread_count() != threads)
+		jobs.init(threads);
+
+	prefetch_heightfields(batch);
+
+	JobGroup group;
 	int count = (int)batch.count;
-	int i;
-	int iters = world->properties.process_iters;
-	int max_level = world->properties.max_level;
-	bool boundary_processing = world->properties.boundary_processing;
-	float base_overlap = world->properties.overlap;
-	NoiseSamplers::NoiseSamplerProperties noise_properties = world->noise_properties;
+	// The batch is sorted by priority; submitting it backwards leaves the first chunks at
+	// the back of each worker's deque, which is where workers pop their own work from
+	for (int i = count - 1; i >= 0; i--)
+	{
+		WorldOctreeNode* n = batch[i];
+		jobs.submit([this, n, &group]() { run_stage(n, CHUNK_STAGES_SAMPLE, &group); }, &group, JOB_PRIORITIES_LOW);
+	}
 
-#pragma omp parallel for
-	for (i = 0; i < count; i++)
+	// Chunks are marked for upload as their format stage finishes, the render thread can
+	// pick them up while the rest of the batch is still running
+	group.wait();
+}
+
+// Heightfield chunks each sample their tile with a short noise call of their own (see HeightfieldCache).
+// The tiles a batch is missing are sampled here first instead, many per call, so the noise setup
+// is paid once per call and the SIMD lanes stay busy even for small chunks.
+void ChunkGenerator::prefetch_heightfields(SmartContainer<WorldOctreeNode*>& batch)
+{
+	ChunkJobSettings& settings = job_settings;
+	if (!world->sampler.heightfield_batch)
+		return;
+
+	// Only chunks that will get to label_grid's heightfield path
+	std::vector<HeightfieldFootprint> footprints;
+	int count = (int)batch.count;
+	for (int i = 0; i < count; i++)
 	{
-		if (batch[i]->generation_stage == GENERATION_STAGES_GENERATING)
+		WorldOctreeNode* n = batch[i];
+		DMCChunk* chunk = n->chunk;
+		if (n->generation_stage != GENERATION_STAGES_GENERATING || chunk->uniform || !update_still_needed(n))
+			continue;
+		float overlap = get_overlap(n);
+		if (mesh_lru.contains(get_cache_key(n), n->morton_code.code, overlap) || block_lru.contains(get_sample_key(n), n->morton_code.code, overlap, chunk->dim))
+			continue;
+		glm::vec3 box_min, box_max;
+		world->get_sample_bounds(n, box_min, box_max);
+		if (world->edits.intersects(box_min, box_max))
+			continue;
+
+		HeightfieldFootprint f;
+		chunk->get_bounds(overlap, f.pos, f.scale);
+		f.dim = chunk->dim;
+		footprints.push_back(f);
+	}
+
+	heightfield_cache.filter_missing(world->sampler, footprints, &settings.noise_properties);
+	if (footprints.empty())
+		return;
+	std::sort(footprints.begin(), footprints.end(), [](const HeightfieldFootprint& a, const HeightfieldFootprint& b) { return a.dim < b.dim; });
+
+	// Runs of equal dim, split so every worker gets a share
+	JobGroup group;
+	int threads = jobs.get_thread_count();
+	size_t start = 0;
+	while (start < footprints.size())
+	{
+		uint32_t dim = footprints[start].dim;
+		size_t end = start;
+		while (end < footprints.size() && footprints[end].dim == dim)
+			end++;
+
+		int run = (int)(end - start);
+		int per_job = std::max(1, HEIGHTFIELD_BATCH_POINTS / (int)(dim * dim));
+		per_job = std::min(per_job, (run + threads - 1) / threads);
+		for (int first = 0; first < run; first += per_job)
 		{
-			if (update_still_needed(batch[i]))
+			const HeightfieldFootprint* f = footprints.data() + start + first;
+			int n = std::min(per_job, run - first);
+			jobs.submit([this, f, n]()
 			{
-				float overlap = (batch[i]->level == max_level && (!boundary_processing || iters == 0) ? 0.0f : base_overlap + 0.005f * (float)iters);
-				batch[i]->chunk->label_grid(&binary_allocator, &density_allocator, &noise_allocator, overlap, noise_properties);
+				NoiseSamplers::NoiseSamplerProperties properties = job_settings.noise_properties;
+				heightfield_cache.prefetch(world->sampler, f, n, &properties);
+			}, &group, JOB_PRIORITIES_HIGH);
+		}
+		start = end;
+	}
+	group.wait();
+}
 
-				batch[i]->chunk->label_edges(&vi_allocator, &cell_allocator, &inds_allocator, &density_allocator, &masks_allocator);
+float ChunkGenerator::get_overlap(WorldOctreeNode* n)
+{
+	ChunkJobSettings& settings = job_settings;
+	return (n->level == settings.max_level && (!settings.boundary_processing || settings.iters == 0) ? 0.0f : settings.base_overlap + 0.005f * (float)settings.iters);
+}
 
-				/*batch[i]->chunk->generate_octree();
-				if (!(batch[i]->flags & NODE_FLAGS_GROUP))
-				{
-					memcpy(batch[i]->children, batch[i]->chunk->octree.children, sizeof(OctreeNode*) * 8);
-					batch[i]->leaf_flag = false;
-				}*/
+uint64_t ChunkGenerator::get_cache_key(WorldOctreeNode* n)
+{
+	ChunkJobSettings& settings = job_settings;
+	return MeshCache::make_params_key(n->chunk->dim, settings.iters, settings.max_level, settings.base_overlap, settings.boundary_processing, settings.world_size, settings.sampler_type, settings.noise_properties);
+}
 
-				batch[i]->chunk->polygonize();
+uint64_t ChunkGenerator::get_sample_key(WorldOctreeNode* n)
+{
+	// The overlap, which smoothing and the max level feed into, is matched per entry
+	ChunkJobSettings& settings = job_settings;
+	return MeshCache::make_params_key(n->chunk->dim, 0, 0, 0.0f, false, settings.world_size, settings.sampler_type, settings.noise_properties);
+}
 
-				if (iters > 0 && batch[i]->chunk->contains_mesh && batch[i]->chunk->vi->vertices.count && batch[i]->chunk->vi->mesh_indexes.count)
-				{
-					auto& v_out = batch[i]->chunk->vi->vertices;
-					auto& i_out = batch[i]->chunk->vi->mesh_indexes;
-					Processing::MeshProcessor<3> mp(true, SMOOTH_NORMALS);
-					mp.init(batch[i]->chunk->vi->vertices, batch[i]->chunk->vi->mesh_indexes, sampler);
+void ChunkGenerator::run_stage(WorldOctreeNode* n, int stage, JobGroup* group)
+{
+	DMCChunk* chunk = n->chunk;
+	ChunkJobSettings& settings = job_settings;
 
-					mp.optimize_dual_grid(iters, boundary_processing);
-					mp.optimize_primal_grid(false, false, boundary_processing);
-					v_out.count = 0;
-					i_out.count = 0;
-					mp.flush(v_out, i_out);
-				}
+	if (stage != CHUNK_STAGES_FORMAT && world->generator_shutdown)
+	{
+		// Drop whatever was built so far, a half finished mesh must never be uploaded
+		release_blocks(chunk);
+		if (stage != CHUNK_STAGES_SAMPLE && chunk->vi)
+		{
+			vi_allocator.free_element(chunk->vi);
+			chunk->vi = 0;
+			chunk->contains_mesh = false;
+		}
+		stage = CHUNK_STAGES_FORMAT;
+	}
+
+	int next = stage + 1;
+	switch (stage)
+	{
+	case CHUNK_STAGES_SAMPLE:
+	{
+		chunk->baked_archive = 0;
+		chunk->baked_entry = 0;
+		if (n->generation_stage != GENERATION_STAGES_GENERATING)
+		{
+			next = CHUNK_STAGES_FORMAT;
+			break;
+		}
+		if (chunk->uniform)
+		{
+			chunk->contains_mesh = false;
+			next = CHUNK_STAGES_FORMAT;
+			break;
+		}
+		if (!update_still_needed(n))
+		{
+			n->flags |= NODE_FLAGS_CANCELLED;
+			next = CHUNK_STAGES_FORMAT;
+			break;
+		}
+
+		float overlap = get_overlap(n);
+
+		// Brush edits reaching the chunk, composed over the sampler in the order they were made
+		std::vector<BrushEdit> edits;
+		glm::vec3 box_min, box_max;
+		world->get_sample_bounds(n, box_min, box_max);
+		world->edits.query(box_min, box_max, 0, edits);
+
+		if (n->flags & NODE_FLAGS_EDITED)
+		{
+			vi_allocator.free_element(chunk->vi);
+			chunk->vi = 0;
+		}
 
-				binary_allocator.free_element(batch[i]->chunk->binary_block);
-				batch[i]->chunk->binary_block = 0;
-				density_allocator.free_element(batch[i]->chunk->density_block);
-				batch[i]->chunk->density_block = 0;
-				cell_allocator.free_element(batch[i]->chunk->cell_block);
-				batch[i]->chunk->cell_block = 0;
-				inds_allocator.free_element(batch[i]->chunk->indexes_block);
-				batch[i]->chunk->indexes_block = 0;
+		uint64_t sample_key = get_sample_key(n);
+		chunk->params_key = get_cache_key(n);
+		// A cache hit leaves the chunk exactly as the stages below would
+		if (edits.empty())
+		{
+			bool cached = mesh_lru.take(chunk->params_key, n->morton_code.code, overlap, chunk);
+			if (!cached && baked_tiles.load(chunk->params_key, n->morton_code.code, overlap, chunk))
+			{
+				// Uploaded straight from the tile, the chunk keeps no vertices of its own
+				vi_allocator.free_element(chunk->vi);
+				chunk->vi = 0;
+				cached = true;
+			}
+			if (cached || mesh_cache.load(chunk->params_key, n->morton_code.code, overlap, chunk, &vi_allocator))
+			{
+				next = CHUNK_STAGES_FORMAT;
+				break;
+			}
+		}
+
+		// Retained blocks restart the chunk at label_edges. Edits made since can be composed on
+		// top of complete densities, otherwise the chunk is sampled again.
+		if (block_lru.take(sample_key, n->morton_code.code, overlap, chunk))
+		{
+			bool stale = (!edits.empty() && edits.back().serial > chunk->edit_serial);
+			if (!stale || chunk->density_block->complete)
+			{
+				if (stale)
+					chunk->apply_edits(&binary_allocator, edits);
+				if (!chunk->contains_mesh)
+					next = CHUNK_STAGES_SMOOTH;
+				break;
 			}
+			release_blocks(chunk);
+		}
+
+		chunk->label_grid(&binary_allocator, &density_allocator, &noise_allocator, overlap, settings.noise_properties, &heightfield_cache, (edits.empty() ? 0 : &edits), &slab_store, sample_key);
+		if (!chunk->contains_mesh)
+			next = CHUNK_STAGES_SMOOTH;
+		break;
+	}
+	case CHUNK_STAGES_LABEL:
+		chunk->label_edges(&vi_allocator, &cell_allocator, &inds_allocator, &density_allocator, &masks_allocator);
+		break;
+	case CHUNK_STAGES_POLYGONIZE:
+		chunk->polygonize();
+		break;
+	case CHUNK_STAGES_SMOOTH:
+		if (settings.iters > 0 && chunk->contains_mesh && chunk->vi->vertices.count && chunk->vi->mesh_indexes.count)
+		{
+			auto& v_out = chunk->vi->vertices;
+			auto& i_out = chunk->vi->mesh_indexes;
+			Processing::MeshProcessor<3> mp(true, SMOOTH_NORMALS);
+			mp.init(v_out, i_out, world->sampler);
+
+			mp.optimize_dual_grid(settings.iters, settings.boundary_processing);
+			mp.optimize_primal_grid(false, false, settings.boundary_processing);
+			v_out.count = 0;
+			i_out.count = 0;
+			mp.flush(v_out, i_out);
 		}
 
-		if (batch[i]->chunk->vi)
+		retain_blocks(n);
+		if (!chunk->edit_serial)
+			mesh_cache.store(chunk->params_key, n->morton_code.code, chunk->overlap, chunk);
+		break;
+	case CHUNK_STAGES_FORMAT:
+	{
+		// A re-meshed chunk always goes back to the render thread, even empty its old mesh has to go
+		bool edited = (n->flags & NODE_FLAGS_EDITED) != 0;
+		n->flags &= ~NODE_FLAGS_EDITED;
+		if (chunk->vi || chunk->baked_entry)
 		{
-			batch[i]->format(&gl_allocator);
-			batch[i]->generation_stage = GENERATION_STAGES_NEEDS_UPLOAD;
+			n->format(&mesh_allocator);
+			n->generation_stage = GENERATION_STAGES_NEEDS_UPLOAD;
 		}
 		else
-			batch[i]->generation_stage = GENERATION_STAGES_DONE;
+			n->generation_stage = (edited ? GENERATION_STAGES_NEEDS_UPLOAD : GENERATION_STAGES_DONE);
+		return;
+	}
 	}
 
+	// Later stages run first so chunks that are underway finish (and free their blocks)
+	// before new ones start sampling
+	int priority = (next >= CHUNK_STAGES_SMOOTH ? JOB_PRIORITIES_HIGH : JOB_PRIORITIES_NORMAL);
+	jobs.submit([this, n, next, group]() { run_stage(n, next, group); }, group, priority);
+}
 
+void ChunkGenerator::release_blocks(DMCChunk* chunk)
+{
+	binary_allocator.free_element(chunk->binary_block);
+	chunk->binary_block = 0;
+	density_allocator.free_element(chunk->density_block);
+	chunk->density_block = 0;
+	cell_allocator.free_element(chunk->cell_block);
+	chunk->cell_block = 0;
+	inds_allocator.free_element(chunk->indexes_block);
+	chunk->indexes_block = 0;
+}
+
+void ChunkGenerator::retain_blocks(WorldOctreeNode* n)
+{
+	DMCChunk* chunk = n->chunk;
+	// Edited chunks are the likeliest to be touched again, the rest only when opted in
+	if (chunk->edit_serial || job_settings.retain_all_blocks)
+		block_lru.put(get_sample_key(n), n->morton_code.code, chunk);
+	release_blocks(chunk);
 }
 
 void ChunkGenerator::extract_samples(SmartContainer<class WorldOctreeNode*>& batch)
@@ -326,7 +576,7 @@ void ChunkGenerator::extract_format_meshes(SmartContainer<class WorldOctreeNode*
 #pragma omp for
 		for (int i = 0; i < count; i++)
 		{
-			batch[i]->format(&gl_allocator);
+			batch[i]->format(&mesh_allocator);
 		}
 	}
 
@@ -2,6 +2,7 @@
 
 #include <thread>
 #include <mutex>
+#include <condition_variable>
 #include <atomic>
 #include <list>
 #include <vector>
@@ -11,6 +12,37 @@
 #include "ResourceAllocator.hpp"
 #include "ChunkBlocks.hpp"
 #include "WorldStitcher.hpp"
+#include "MeshCache.hpp"
+#include "MeshTiles.hpp"
+#include "MeshLRU.hpp"
+#include "BlockLRU.hpp"
+#include "SlabStore.hpp"
+#include "JobSystem.hpp"
+#include "HeightfieldCache.hpp"
+#include "NoiseSampler.hpp"
+
+// Each chunk goes through these as separate jobs
+enum CHUNK_STAGES
+{
+	CHUNK_STAGES_SAMPLE = 0,
+	CHUNK_STAGES_LABEL = 1,
+	CHUNK_STAGES_POLYGONIZE = 2,
+	CHUNK_STAGES_SMOOTH = 3,
+	CHUNK_STAGES_FORMAT = 4
+};
+
+// World settings captured once per batch so every stage of it sees the same values
+struct ChunkJobSettings
+{
+	int iters;
+	int max_level;
+	bool boundary_processing;
+	bool retain_all_blocks;
+	float base_overlap;
+	float world_size;
+	uint32_t sampler_type;
+	NoiseSamplers::NoiseSamplerProperties noise_properties;
+};
 
 class ChunkGenerator : public ThreadDebug
 {
@@ -20,12 +52,16 @@ public:
 
 	void init(class WorldOctree* _world);
 
-	void process_queue(SmartContainer<WorldOctreeNode*>& batch);
+	// With cancel_stale, chunks that the watcher's current focus no longer needs are dropped
+	// mid-batch. Only set it when a watcher thread is moving the focus.
+	void process_queue(SmartContainer<WorldOctreeNode*>& batch, bool cancel_stale = false);
+	// Hands the chunk's mesh to mesh_lru (or frees it) once nothing else needs it
+	void retire_mesh(class WorldOctreeNode* n);
 
 	std::mutex _mutex;
 	std::condition_variable _cv;
 
-	ResourceAllocator<GLChunk> gl_allocator;
+	ResourceAllocator<ChunkMesh> mesh_allocator;
 	ResourceAllocator<DensityBlock> density_allocator;
 	ResourceAllocator<BinaryBlock> binary_allocator;
 	ResourceAllocator<MasksBlock> masks_allocator;
@@ -36,16 +72,33 @@ public:
 	ResourceAllocator<NoiseBlock> noise_allocator;
 
 	WorldStitcher stitcher;
+	MeshCache mesh_cache;
+	MeshTileReader baked_tiles;
+	MeshLRU mesh_lru;
+	BlockLRU block_lru;
+	SlabStore slab_store;
+	HeightfieldCache heightfield_cache;
+	JobSystem jobs;
 
 private:
 	class WorldOctree* world;
 
 	std::vector<class WorldOctreeNode*> queue;
+	ChunkJobSettings job_settings;
+	bool cancel_stale;
 
 	bool update_still_needed(class WorldOctreeNode* n);
 	void generate_chunk(class WorldOctreeNode* n);
 
 	void extract_chunk(SmartContainer<class WorldOctreeNode*>& batch);
+	void prefetch_heightfields(SmartContainer<class WorldOctreeNode*>& batch);
+	void run_stage(class WorldOctreeNode* n, int stage, JobGroup* group);
+	float get_overlap(class WorldOctreeNode* n);
+	// Keys of the batch's settings at the chunk's resolution, which may differ per level
+	uint64_t get_cache_key(class WorldOctreeNode* n);
+	uint64_t get_sample_key(class WorldOctreeNode* n);
+	void release_blocks(class DMCChunk* chunk);
+	void retain_blocks(class WorldOctreeNode* n);
 	void extract_samples(SmartContainer<class WorldOctreeNode*>& batch);
 	void extract_filter(SmartContainer<class WorldOctreeNode*>& batch);
 	void extract_dual_vertices(SmartContainer<class WorldOctreeNode*>& batch);
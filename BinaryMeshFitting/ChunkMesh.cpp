@@ -0,0 +1,128 @@
+#include "PCH.h"
+#include "ChunkMesh.hpp"
+
+ChunkMesh::ChunkMesh() : box_min(0, 0, 0), box_size(0, 0, 0), vertices(0), vertex_count(0), indexes(0), index_count(0), index_size(0)
+{
+}
+
+ChunkMesh::~ChunkMesh()
+{
+}
+
+// 1 / size per axis, 0 for a flat axis so its vertices all pack to 0
+static inline glm::vec3 get_inv_size(const glm::vec3& size)
+{
+	return glm::vec3(size.x > 0.0f ? 1.0f / size.x : 0.0f, size.y > 0.0f ? 1.0f / size.y : 0.0f, size.z > 0.0f ? 1.0f / size.z : 0.0f);
+}
+
+bool ChunkMesh::format_packed(DualVertexStore& vert_data, SmartContainer<uint32_t>& index_data)
+{
+	packed_data.count = 0;
+	short_index_data.count = 0;
+	view_packed();
+	using namespace glm;
+
+	size_t count = vert_data.count;
+	if (!count)
+	{
+		box_min = vec3(0, 0, 0);
+		box_size = vec3(0, 0, 0);
+		return true;
+	}
+
+	const vec3* v_p = vert_data.p;
+	vec3 box_max = v_p[0];
+	box_min = v_p[0];
+	for (size_t i = 1; i < count; i++)
+	{
+		box_min = min(box_min, v_p[i]);
+		box_max = max(box_max, v_p[i]);
+	}
+	box_size = box_max - box_min;
+	vec3 inv_size = get_inv_size(box_size);
+
+	if (!packed_data.prepare_exact(count))
+		return false;
+	const vec3* v_n = vert_data.n;
+	const vec3* v_c = vert_data.color;
+	PackedVertex* out = packed_data.elements;
+	for (size_t i = 0; i < count; i++)
+		out[i] = pack_vertex(v_p[i], v_n[i], v_c[i], box_min, inv_size);
+	packed_data.count = count;
+
+	if (count <= 65536)
+	{
+		size_t i_count = index_data.count;
+		if (!short_index_data.prepare_exact(i_count))
+			return false;
+		const uint32_t* in = index_data.elements;
+		uint16_t* short_out = short_index_data.elements;
+		for (size_t i = 0; i < i_count; i++)
+			short_out[i] = (uint16_t)in[i];
+		short_index_data.count = i_count;
+	}
+
+	view_packed();
+	return true;
+}
+
+bool ChunkMesh::format_packed_tris(SmartContainer<DualVertex>& vert_data)
+{
+	packed_data.count = 0;
+	short_index_data.count = 0;
+	view_packed();
+	using namespace glm;
+
+	size_t count = vert_data.count;
+	if (!count)
+	{
+		box_min = vec3(0, 0, 0);
+		box_size = vec3(0, 0, 0);
+		return true;
+	}
+
+	vec3 box_max = vert_data[0].p;
+	box_min = vert_data[0].p;
+	for (size_t i = 1; i < count; i++)
+	{
+		box_min = min(box_min, vert_data[i].p);
+		box_max = max(box_max, vert_data[i].p);
+	}
+	box_size = box_max - box_min;
+	vec3 inv_size = get_inv_size(box_size);
+
+	if (!packed_data.prepare_exact(count))
+		return false;
+	for (size_t i = 0; i < count; i++)
+		packed_data.push_back(pack_vertex(vert_data[i].p, vert_data[i].n, vert_data[i].color, box_min, inv_size));
+
+	view_packed();
+	return true;
+}
+
+void ChunkMesh::set_view(const PackedVertex* _vertices, size_t _vertex_count, const void* _indexes, size_t _index_count, uint32_t _index_size, const glm::vec3& _box_min, const glm::vec3& _box_size)
+{
+	vertices = _vertices;
+	vertex_count = _vertex_count;
+	indexes = _indexes;
+	index_count = _index_count;
+	index_size = _index_size;
+	box_min = _box_min;
+	box_size = _box_size;
+}
+
+void ChunkMesh::view_packed()
+{
+	vertices = packed_data.elements;
+	vertex_count = packed_data.count;
+	indexes = (short_index_data.count ? short_index_data.elements : 0);
+	index_count = short_index_data.count;
+	index_size = (short_index_data.count ? 2 : 0);
+}
+
+void ChunkMesh::reset_data()
+{
+	packed_data.reset();
+	short_index_data.reset();
+	view_packed();
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include "SmartContainer.hpp"
+#include "Vertices.hpp"
+#include "PackedVertex.hpp"
+#include "LinkedNode.hpp"
+
+// CPU-side formatted mesh, ready to be handed to whatever uploads it.
+// Holds no GL state so it can be used without a context.
+class ChunkMesh : public LinkedNode<ChunkMesh>
+{
+public:
+	// Packed output, 12 bytes a vertex. Positions are quantized to the mesh's bounds in the
+	// chunk's cell space: p = box_min + unorm16(p) * box_size.
+	SmartContainer<PackedVertex> packed_data;
+	SmartContainer<uint16_t> short_index_data;	// Empty when an index doesn't fit, the 32-bit indexes are used as is
+	glm::vec3 box_min;
+	glm::vec3 box_size;
+
+	// What gets uploaded: packed_data and short_index_data after format_packed, or memory that
+	// outlives the upload after set_view. No indexes means the chunk's 32-bit ones are used.
+	const PackedVertex* vertices;
+	size_t vertex_count;
+	const void* indexes;
+	size_t index_count;
+	uint32_t index_size;
+
+	ChunkMesh();
+	~ChunkMesh();
+
+	bool format_packed(DualVertexStore& vert_data, SmartContainer<uint32_t>& index_data);
+	bool format_packed_tris(SmartContainer<DualVertex>& vert_data);
+	// Uses already packed vertices and indexes in place, without copying them
+	void set_view(const PackedVertex* _vertices, size_t _vertex_count, const void* _indexes, size_t _index_count, uint32_t _index_size, const glm::vec3& _box_min, const glm::vec3& _box_size);
+	void reset_data();
+
+private:
+	void view_packed();
+};
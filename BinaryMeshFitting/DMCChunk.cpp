@@ -2,9 +2,16 @@
 #include "DMCChunk.hpp"
 #include "Tables.hpp"
 #include "NoiseSampler.hpp"
+#include "SignMask.hpp"
+#include "HeightfieldCache.hpp"
+#include "EditLayer.hpp"
+#include "SlabStore.hpp"
 #include <iostream>
 #include <iomanip>
 #include <queue>
+#include <vector>
+#include <algorithm>
+#include <cstring>
 #include <omp.h>
 #include "MCTable.h"
 
@@ -17,26 +24,20 @@ using namespace glm;
 	if (samples[s0] & s0_mask) \
 		mask |= m;
 
-#define EDGE_LINE(l_z, z, b) \
-if(line & b) { \
-if (z_block < z_count || l_z * 8 + z < 32) \
-	local_masks[l_z] |= 1ull << (z * 8 + m); \
-if (z > 0) \
-	local_masks[l_z] |= 1ull << ((z - 1) * 8 + m + 1); \
-else if (l_z > 0) \
-	local_masks[l_z - 1] |= 1ull << (7 * 8 + m + 1); \
-else if (z_block > 0) \
-	line_masks[-1] |= 1ull << (7 * 8 + m + 1); \
-}
-
-#define EDGE_V(xoff, yoff, zoff, e) cell_block->cells[indexes_block->inds[(x + (xoff)) * dim * dim + (y + (yoff)) * dim + (z + (zoff))]].edges[e].iso_vertex.index
+#define EDGE_V(xoff, yoff, zoff, e) cell_block->cells[indexes_block->find(x + (xoff), y + (yoff), z + (zoff))].edges[e].iso_vertex.index
 
 #define RESOLUTION 32
 
+// Volume samplers with a Lipschitz bound are sampled coarse to fine, see sample_hierarchical
+#define HIERARCHICAL_SAMPLING 1
+#define HIERARCHICAL_SAMPLING_STEP 4
+
 DMCChunk::DMCChunk()
 {
 	cell_block = 0;
 	density_block = 0;
+	baked_archive = 0;
+	baked_entry = 0;
 }
 
 DMCChunk::DMCChunk(glm::vec3 pos, float size, int level, Sampler& sampler, uint64_t parent_code)
@@ -64,384 +65,444 @@ void DMCChunk::init(glm::vec3 pos, float size, int level, Sampler& sampler, uint
 	this->pem = false;
 
 	this->contains_mesh = false;
+	this->uniform = false;
 	this->mesh_offset = 0;
 
 	this->sampler = sampler;
 	this->vi = 0;
+	this->baked_archive = 0;
+	this->baked_entry = 0;
 	this->cell_block = 0;
 	this->indexes_block = 0;
 	this->density_block = 0;
 	this->binary_block = 0;
 	this->octree.leaf_flag = true;
 	this->parent_code = parent_code;
+	this->params_key = 0;
+	this->edit_serial = 0;
+	this->overlap = 0.0f;
+}
+
+void DMCChunk::set_bounds(float overlap)
+{
+	this->overlap = overlap;
+	get_bounds(overlap, overlap_pos, scale);
+
+	bound_size = size * (1.0f + overlap * 2.0f) * 0.5f;
+	bound_start = overlap_pos + bound_size;
 }
 
-void DMCChunk::label_grid(ResourceAllocator<BinaryBlock>* binary_allocator, ResourceAllocator<DensityBlock>* density_allocator, ResourceAllocator<NoiseBlock>* noise_allocator, float overlap, NoiseSamplers::NoiseSamplerProperties properties)
+void DMCChunk::get_bounds(float overlap, glm::vec3& out_overlap_pos, float& out_scale) const
 {
-	bool positive = false, negative = false;
+	out_overlap_pos = pos - size * overlap;
+	out_scale = size * (1.0f + overlap * 2.0f) / (float)(dim - 1);
+}
 
+void DMCChunk::label_grid(ResourceAllocator<BinaryBlock>* binary_allocator, ResourceAllocator<DensityBlock>* density_allocator, ResourceAllocator<NoiseBlock>* noise_allocator, float overlap, NoiseSamplers::NoiseSamplerProperties properties, HeightfieldCache* heightfield_cache, const std::vector<BrushEdit>* edits, SlabStore* slabs, uint64_t sample_key)
+{
 	assert(sampler.value != nullptr);
-	uint32_t dimp1 = dim + 1;
 	uint32_t z_per_y_chunks = ((dim + 31)) / 32;
-	uint32_t y_per_x_chunks = z_per_y_chunks * dim;
-	uint32_t z_per_y = dim;
-	uint32_t y_per_x = z_per_y * dim;
 	uint32_t real_count = ((z_per_y_chunks * 32) * dim * dim + 31) / 32;
 
-	binary_block = binary_allocator->new_element();
-	binary_block->init(dim * dim * dim, real_count);
-
-	float delta = size * (1.0f + overlap * 2.0f) / (float)(dim - 1);
+	set_bounds(overlap);
+	float delta = scale;
 	const float noise_scale = 1.0f;
 	const float res = sampler.world_size;
-	overlap_pos = pos - size * overlap;
-	scale = delta;
 
-	bound_size = size * (1.0f + overlap * 2.0f) * 0.5f;
-	bound_start = overlap_pos + bound_size;
+	// Also large enough for the coarse lattice and the runs of sample_hierarchical
+	uint32_t lattice = (dim - 1 + HIERARCHICAL_SAMPLING_STEP - 1) / HIERARCHICAL_SAMPLING_STEP + 1;
+	uint32_t noise_size = dim * dim;
+	noise_size = std::max(noise_size, lattice * lattice * lattice);
+	noise_size = std::max(noise_size, (HIERARCHICAL_SAMPLING_STEP + 1) * (HIERARCHICAL_SAMPLING_STEP + 1) * dim);
+	NoiseBlock* noise_block = noise_allocator->new_element();
+	noise_block->init(noise_size);
 
-	density_block = density_allocator->new_element();
-	density_block->init(dim * dim * dim);
+	// Brushes are composed over the full volume, edited chunks skip the shortcuts that don't produce one
+	bool edited = (edits && !edits->empty());
 
-	NoiseBlock* noise_block = noise_allocator->new_element();
-	noise_block->init(dim * dim);
+	const HeightfieldTile* tile = 0;
+	if (sampler.heightfield && heightfield_cache && !edited)
+	{
+		tile = heightfield_cache->acquire(sampler, overlap_pos, dim, delta * noise_scale, noise_block->dest_noise, &noise_block->vectorset, &properties);
 
-	properties.thread_id = omp_get_thread_num();
+		// Entirely below or above every column, the chunk is all one sign
+		float y_bottom = ((float)0 * delta * noise_scale + overlap_pos.y) * tile->y_scale;
+		float y_top = ((float)(dim - 1) * delta * noise_scale + overlap_pos.y) * tile->y_scale;
+		if (y_bottom > tile->max || y_top <= tile->min)
+		{
+			heightfield_cache->release(tile);
+			heightfield_cache->count_skipped();
+			contains_mesh = false;
+			noise_allocator->free_element(noise_block);
+			return;
+		}
+	}
 
-	sampler.block(res, overlap_pos/* + vec3(delta * 0.5f, delta * 0.5f, delta * 0.5f)*/, ivec3(dim, dim, dim), delta * noise_scale, (void**)&density_block->data, &noise_block->vectorset, noise_block->dest_noise, 0, sizeof(float), &properties);
+	binary_block = binary_allocator->new_element();
+	binary_block->init(dim * dim * dim, real_count);
 
-	vec3 dxyz;
-	auto f = sampler.value;
-	uint32_t s0_mask, s0;
-	uint32_t z_count = (dim + 31) / 32;
-	bool mesh = false;
-	for (uint32_t x = 0; x < dim; x++)
+	density_block = density_allocator->new_element();
+	density_block->init(dim * dim * dim);
+	density_block->complete = false;
+
+	uint32_t signs;
+	if (tile)
 	{
-		//float dx = (float)x;
-		for (uint32_t y = 0; y < dim; y++)
+		signs = SignMask::label_heightfield(tile->columns, dim, overlap_pos.y, delta * noise_scale, tile->y_scale, binary_block->data, density_block->data);
+		heightfield_cache->release(tile);
+	}
+	else if (sampler.heightfield && !edited)
+	{
+		// Sign words straight from the 2D columns. Only densities near the surface are written,
+		// which are the only ones calculate_isovertex reads.
+		float y_scale = sampler.heightfield(res, overlap_pos, ivec3(dim, dim, dim), delta * noise_scale, noise_block->dest_noise, &noise_block->vectorset, &properties);
+		signs = SignMask::label_heightfield(noise_block->dest_noise, dim, overlap_pos.y, delta * noise_scale, y_scale, binary_block->data, density_block->data);
+	}
+	else
+	{
+		float lipschitz = (HIERARCHICAL_SAMPLING && sampler.lipschitz && !edited ? sampler.lipschitz(res, &properties) : 0.0f);
+		if (lipschitz > 0.0f && dim > HIERARCHICAL_SAMPLING_STEP * 2)
+			sample_hierarchical(noise_block, lipschitz, &properties);
+		else
 		{
-			//float dy = (float)y;
-			for (uint32_t z_block = 0; z_block < z_count; z_block++)
-			{
-				float* block_samples = density_block->data + x * y_per_x + y * z_per_y + z_block * 32;
-				uint32_t m = 0;
-				uint32_t z_max = dim - z_block * 32;
-				if (z_max > 32)
-					z_max = 32;
+			sample_volume(density_allocator, noise_block, slabs, sample_key, &properties);
+			density_block->complete = true;
+		}
 
-				for (uint32_t z = 0; z < z_max; z++)
-				{
-					//float dz = (float)(z_block * 32 + z);
-					float s = block_samples[z];
-					if (s < 0.0f)
-						m |= 1 << z;
-					//block_samples[z].position = vec3(dx, dy, dz);
-					//block_samples[z].index = -1;
-				}
-				if (m != 0)
-				{
-					binary_block->data[x * y_per_x_chunks + y * z_per_y_chunks + z_block] = m;
-					if (m != 0xFFFFFFFF)
-						mesh = true;
-					else if (!mesh)
-						negative = true;
-				}
-				else
-				{
-					if (!mesh)
-						positive = true;
-					binary_block->data[x * y_per_x_chunks + y * z_per_y_chunks + z_block] = 0;
-				}
-			}
+		edit_serial = 0;
+		if (edited)
+		{
+			for (const BrushEdit& e : *edits)
+				e.apply(density_block->data, overlap_pos, dim, delta * noise_scale);
+			edit_serial = edits->back().serial;
 		}
-	}
 
-	if (!mesh)
-		contains_mesh = negative && positive;
-	else
-		contains_mesh = mesh;
+		// One sign word per 32 z samples, rows are laid out exactly like the density block
+		signs = SignMask::label(density_block->data, dim * dim, dim, binary_block->data);
+	}
+	contains_mesh = (signs == SignMask::SIGN_MASK_CLASSES_MIXED);
 
 	noise_allocator->free_element(noise_block);
 	noise_block = 0;
 }
 
-void DMCChunk::label_edges(ResourceAllocator<VerticesIndicesBlock>* vi_allocator, ResourceAllocator<DMC_CellsBlock>* cell_allocator, ResourceAllocator<IndexesBlock>* inds_allocator, ResourceAllocator<DensityBlock>* density_allocator, ResourceAllocator<MasksBlock>* masks_allocator)
+// Fast path for re-meshing a chunk with retained blocks (see BlockLRU) after an edit: its complete
+// densities already hold the sampler output and every edit up to edit_serial, only the newer ones
+// are composed on top before relabelling.
+void DMCChunk::apply_edits(ResourceAllocator<BinaryBlock>* binary_allocator, const std::vector<BrushEdit>& edits)
 {
-	if (!contains_mesh)
-		return;
+	assert(density_block && density_block->complete);
+	uint32_t z_per_y_chunks = ((dim + 31)) / 32;
+	uint32_t real_count = ((z_per_y_chunks * 32) * dim * dim + 31) / 32;
 
-	if (!vi)
+	for (const BrushEdit& e : edits)
 	{
-		vi = vi_allocator->new_element();
-		vi->init();
+		if (e.serial > edit_serial)
+			e.apply(density_block->data, overlap_pos, dim, scale);
 	}
-	if (!cell_block)
+	if (!edits.empty())
+		edit_serial = std::max(edit_serial, edits.back().serial);
+
+	if (!binary_block)
 	{
-		cell_block = cell_allocator->new_element();
-		cell_block->init();
+		binary_block = binary_allocator->new_element();
+		binary_block->init(dim * dim * dim, real_count);
 	}
+	uint32_t signs = SignMask::label(density_block->data, dim * dim, dim, binary_block->data);
+	contains_mesh = (signs == SignMask::SIGN_MASK_CLASSES_MIXED);
+}
 
-	uint32_t count = dim * dim * dim;
-	uint32_t z_per_y = (dim + 31) / 32;
-	uint32_t y_per_x = z_per_y * dim;
+// Samples the whole grid, except for the faces neighbours at the same level left in slabs (see
+// SlabStore), and leaves this chunk's other faces there. Brushes aren't applied yet at this point,
+// so only sampler output is ever shared.
+void DMCChunk::sample_volume(ResourceAllocator<DensityBlock>* density_allocator, NoiseBlock* noise_block, SlabStore* slabs, uint64_t sample_key, SamplerProperties* properties)
+{
+	const float res = sampler.world_size;
+	float* density = density_block->data;
+	bool share = (slabs && slabs->is_enabled() && overlap == 0.0f);
+	uint32_t taken = (share ? slabs->take(sample_key, parent_code, density, dim, scale) : 0);
 
-	uint32_t z_per_y8 = (dim + 7) / 8;
-	uint32_t y_per_x8 = z_per_y8 * dim;
-	uint32_t count8 = z_per_y8 * y_per_x8 * dim;
+	// The volume doesn't fit the noise block, the sampler's noise goes to a spare density block
+	DensityBlock* noise = density_allocator->new_element();
+	noise->init(dim * dim * dim);
 
-	//uint64_t* __restrict masks = (uint64_t*)malloc(sizeof(uint64_t) * count8);
-	//memset(masks, 0, sizeof(uint64_t) * count8);
-	MasksBlock* masks_block = masks_allocator->new_element();
-	masks_block->init(count8);
-	auto masks = masks_block->data;
+	if (!taken)
+		sampler.block(res, overlap_pos, ivec3(dim, dim, dim), scale, (void**)&density, &noise_block->vectorset, noise->data, 0, sizeof(float), properties);
+	else
+	{
+		// The box left after dropping the taken layers, sampled on its own and copied in row by row
+		ivec3 lo(0, 0, 0), hi(dim, dim, dim);
+		for (int axis = 0; axis < 3; axis++)
+		{
+			if (taken & (1u << (axis * 2)))
+				lo[axis] = 1;
+			if (taken & (1u << (axis * 2 + 1)))
+				hi[axis] = dim - 1;
+		}
+		ivec3 size = hi - lo;
 
-	uint32_t* samples = binary_block->data;
+		DensityBlock* box = density_allocator->new_element();
+		box->init(dim * dim * dim);
+		float* box_data = box->data;
+		sampler.block(res, overlap_pos + vec3(lo) * scale, size, scale, (void**)&box_data, &noise_block->vectorset, noise->data, 0, sizeof(float), properties);
+		for (int x = 0; x < size.x; x++)
+		{
+			for (int y = 0; y < size.y; y++)
+				memcpy(density + ((x + lo.x) * dim + y + lo.y) * dim + lo.z, box_data + (x * size.y + y) * size.z, sizeof(float) * size.z);
+		}
+		density_allocator->free_element(box);
+	}
+	density_allocator->free_element(noise);
 
-	uint32_t z_count = (dim + 31) / 32;
+	if (share)
+		slabs->put(sample_key, parent_code, density, dim, scale, taken);
+}
 
-	for (uint32_t x = 0; x < dim; x++)
+// Samples every HIERARCHICAL_SAMPLING_STEP-th point first. A block of step^3 cells whose corners all
+// have the same sign, further from zero than the Lipschitz bound allows the density to change
+// over half the block's diagonal, is uniform: every point in it is within that distance of a
+// corner. Those get a placeholder density of the right sign, the rest are sampled in full, a run
+// of blocks along z at a time. A sign changing edge always lies in a block that was sampled, so
+// calculate_isovertex only ever reads real densities.
+void DMCChunk::sample_hierarchical(NoiseBlock* noise_block, float lipschitz, SamplerProperties* properties)
+{
+	const uint32_t step = HIERARCHICAL_SAMPLING_STEP;
+	const float res = sampler.world_size;
+	float* density = density_block->data;
+	uint32_t blocks = (dim - 1 + step - 1) / step;
+	uint32_t lattice = blocks + 1;
+
+	// The last lattice layer may lie past the grid, the blocks only get larger for it
+	float* coarse = noise_block->samples;
+	sampler.block(res, overlap_pos, ivec3(lattice, lattice, lattice), scale * (float)step, (void**)&coarse, &noise_block->vectorset, noise_block->dest_noise, 0, sizeof(float), properties);
+
+	// 0: needs sampling, 1: all positive, 2: all negative
+	std::vector<uint8_t> block_signs(blocks * blocks * blocks);
+	float threshold = lipschitz * 0.5f * sqrtf(3.0f) * (float)step * scale;
+	for (uint32_t bx = 0; bx < blocks; bx++)
 	{
-		for (uint32_t y = 0; y < dim; y++)
+		for (uint32_t by = 0; by < blocks; by++)
 		{
-			const int m = 0;
-			for (uint32_t z_block = 0; z_block < z_count; z_block++)
+			for (uint32_t bz = 0; bz < blocks; bz++)
 			{
-				uint32_t line = samples[x * y_per_x + y * z_per_y + z_block];
-				uint64_t* __restrict line_masks = masks + x * y_per_x8 + y * z_per_y8 + z_block * 4;
-				if (line == 0)
+				uint8_t sign = 0;
+				bool uniform = true;
+				for (int c = 0; c < 8 && uniform; c++)
 				{
-					line_masks[0] = 0;
-					line_masks[1] = 0;
-					line_masks[2] = 0;
-					line_masks[3] = 0;
-					continue;
+					float v = coarse[((bx + Tables::MCDX[c]) * lattice + by + Tables::MCDY[c]) * lattice + bz + Tables::MCDZ[c]];
+					uint8_t s = (v > threshold ? 1 : (v < -threshold ? 2 : 0));
+					uniform = (s != 0 && (c == 0 || s == sign));
+					sign = s;
 				}
-				uint64_t local_masks[4] = { 0, 0, 0, 0 };
-				EDGE_LINE(0, 0, 0x1);
-				EDGE_LINE(0, 1, 0x2);
-
-				EDGE_LINE(0, 2, 0x4);
-				EDGE_LINE(0, 3, 0x8);
-				EDGE_LINE(0, 4, 0x10);
-				EDGE_LINE(0, 5, 0x20);
-				EDGE_LINE(0, 6, 0x40);
-				EDGE_LINE(0, 7, 0x80);
-				EDGE_LINE(1, 0, 0x100);
-				EDGE_LINE(1, 1, 0x200);
-				EDGE_LINE(1, 2, 0x400);
-				EDGE_LINE(1, 3, 0x800);
-				EDGE_LINE(1, 4, 0x1000);
-				EDGE_LINE(1, 5, 0x2000);
-				EDGE_LINE(1, 6, 0x4000);
-				EDGE_LINE(1, 7, 0x8000);
-				EDGE_LINE(2, 0, 0x10000);
-				EDGE_LINE(2, 1, 0x20000);
-				EDGE_LINE(2, 2, 0x40000);
-				EDGE_LINE(2, 3, 0x80000);
-				EDGE_LINE(2, 4, 0x100000);
-				EDGE_LINE(2, 5, 0x200000);
-				EDGE_LINE(2, 6, 0x400000);
-				EDGE_LINE(2, 7, 0x800000);
-				EDGE_LINE(3, 0, 0x1000000);
-				EDGE_LINE(3, 1, 0x2000000);
-				EDGE_LINE(3, 2, 0x4000000);
-				EDGE_LINE(3, 3, 0x8000000);
-				EDGE_LINE(3, 4, 0x10000000);
-				EDGE_LINE(3, 5, 0x20000000);
-				EDGE_LINE(3, 6, 0x40000000);
-				EDGE_LINE(3, 7, 0x80000000);
-
-				//if (local_masks[0] != 0)
-				line_masks[0] = local_masks[0];
-				//if (local_masks[1] != 0)
-				line_masks[1] = local_masks[1];
-				//if (local_masks[2] != 0)
-				line_masks[2] = local_masks[2];
-				//if (local_masks[3] != 0)
-				line_masks[3] = local_masks[3];
+				block_signs[(bx * blocks + by) * blocks + bz] = (uniform ? sign : 0);
 			}
 		}
 	}
 
-	for (uint32_t x = 0; x < dim; x++)
+	for (uint32_t bx = 0; bx < blocks; bx++)
 	{
-		for (uint32_t y = 0; y < dim - 1; y++)
+		uint32_t x0 = bx * step, x1 = std::min(x0 + step, dim - 1);
+		for (uint32_t by = 0; by < blocks; by++)
 		{
-			const int m = 2;
-			for (uint32_t z_block = 0; z_block < z_count; z_block++)
+			uint32_t y0 = by * step, y1 = std::min(y0 + step, dim - 1);
+			for (uint32_t bz = 0; bz < blocks; bz++)
 			{
-				uint32_t line = samples[x * y_per_x + (y + 1) * z_per_y + z_block];
-				if (line == 0)
+				uint8_t sign = block_signs[(bx * blocks + by) * blocks + bz];
+				if (!sign)
 					continue;
-				uint64_t* __restrict line_masks = masks + x * y_per_x8 + y * z_per_y8 + z_block * 4;
-				uint64_t local_masks[4] = { 0, 0, 0, 0 };
-				EDGE_LINE(0, 0, 0x1);
-				EDGE_LINE(0, 1, 0x2);
-
-				EDGE_LINE(0, 2, 0x4);
-				EDGE_LINE(0, 3, 0x8);
-				EDGE_LINE(0, 4, 0x10);
-				EDGE_LINE(0, 5, 0x20);
-				EDGE_LINE(0, 6, 0x40);
-				EDGE_LINE(0, 7, 0x80);
-				EDGE_LINE(1, 0, 0x100);
-				EDGE_LINE(1, 1, 0x200);
-				EDGE_LINE(1, 2, 0x400);
-				EDGE_LINE(1, 3, 0x800);
-				EDGE_LINE(1, 4, 0x1000);
-				EDGE_LINE(1, 5, 0x2000);
-				EDGE_LINE(1, 6, 0x4000);
-				EDGE_LINE(1, 7, 0x8000);
-				EDGE_LINE(2, 0, 0x10000);
-				EDGE_LINE(2, 1, 0x20000);
-				EDGE_LINE(2, 2, 0x40000);
-				EDGE_LINE(2, 3, 0x80000);
-				EDGE_LINE(2, 4, 0x100000);
-				EDGE_LINE(2, 5, 0x200000);
-				EDGE_LINE(2, 6, 0x400000);
-				EDGE_LINE(2, 7, 0x800000);
-				EDGE_LINE(3, 0, 0x1000000);
-				EDGE_LINE(3, 1, 0x2000000);
-				EDGE_LINE(3, 2, 0x4000000);
-				EDGE_LINE(3, 3, 0x8000000);
-				EDGE_LINE(3, 4, 0x10000000);
-				EDGE_LINE(3, 5, 0x20000000);
-				EDGE_LINE(3, 6, 0x40000000);
-				EDGE_LINE(3, 7, 0x80000000);
-
-				if (local_masks[0] != 0)
-					line_masks[0] |= local_masks[0];
-				if (local_masks[1] != 0)
-					line_masks[1] |= local_masks[1];
-				if (local_masks[2] != 0)
-					line_masks[2] |= local_masks[2];
-				if (local_masks[3] != 0)
-					line_masks[3] |= local_masks[3];
+				uint32_t z0 = bz * step, z1 = std::min(z0 + step, dim - 1);
+				float value = (sign == 1 ? 1.0f : -1.0f);
+				for (uint32_t x = x0; x <= x1; x++)
+					for (uint32_t y = y0; y <= y1; y++)
+						for (uint32_t z = z0; z <= z1; z++)
+							density[(x * dim + y) * dim + z] = value;
 			}
 		}
 	}
 
-	for (uint32_t x = 0; x < dim - 1; x++)
+	// Sampled after the placeholders, points shared with a uniform block get their real value
+	for (uint32_t bx = 0; bx < blocks; bx++)
 	{
-		for (uint32_t y = 0; y < dim; y++)
+		uint32_t x0 = bx * step, sx = std::min(step, dim - 1 - x0) + 1;
+		for (uint32_t by = 0; by < blocks; by++)
 		{
-			const int m = 4;
-			for (uint32_t z_block = 0; z_block < z_count; z_block++)
+			uint32_t y0 = by * step, sy = std::min(step, dim - 1 - y0) + 1;
+			uint32_t bz = 0;
+			while (bz < blocks)
 			{
-				uint32_t line = samples[(x + 1) * y_per_x + y * z_per_y + z_block];
-				if (line == 0)
+				if (block_signs[(bx * blocks + by) * blocks + bz])
+				{
+					bz++;
 					continue;
-				uint64_t* __restrict line_masks = masks + x * y_per_x8 + y * z_per_y8 + z_block * 4;
-				uint64_t local_masks[4] = { 0, 0, 0, 0 };
-				EDGE_LINE(0, 0, 0x1);
-				EDGE_LINE(0, 1, 0x2);
-
-				EDGE_LINE(0, 2, 0x4);
-				EDGE_LINE(0, 3, 0x8);
-				EDGE_LINE(0, 4, 0x10);
-				EDGE_LINE(0, 5, 0x20);
-				EDGE_LINE(0, 6, 0x40);
-				EDGE_LINE(0, 7, 0x80);
-				EDGE_LINE(1, 0, 0x100);
-				EDGE_LINE(1, 1, 0x200);
-				EDGE_LINE(1, 2, 0x400);
-				EDGE_LINE(1, 3, 0x800);
-				EDGE_LINE(1, 4, 0x1000);
-				EDGE_LINE(1, 5, 0x2000);
-				EDGE_LINE(1, 6, 0x4000);
-				EDGE_LINE(1, 7, 0x8000);
-				EDGE_LINE(2, 0, 0x10000);
-				EDGE_LINE(2, 1, 0x20000);
-				EDGE_LINE(2, 2, 0x40000);
-				EDGE_LINE(2, 3, 0x80000);
-				EDGE_LINE(2, 4, 0x100000);
-				EDGE_LINE(2, 5, 0x200000);
-				EDGE_LINE(2, 6, 0x400000);
-				EDGE_LINE(2, 7, 0x800000);
-				EDGE_LINE(3, 0, 0x1000000);
-				EDGE_LINE(3, 1, 0x2000000);
-				EDGE_LINE(3, 2, 0x4000000);
-				EDGE_LINE(3, 3, 0x8000000);
-				EDGE_LINE(3, 4, 0x10000000);
-				EDGE_LINE(3, 5, 0x20000000);
-				EDGE_LINE(3, 6, 0x40000000);
-				EDGE_LINE(3, 7, 0x80000000);
-
-				if (local_masks[0] != 0)
-					line_masks[0] |= local_masks[0];
-				if (local_masks[1] != 0)
-					line_masks[1] |= local_masks[1];
-				if (local_masks[2] != 0)
-					line_masks[2] |= local_masks[2];
-				if (local_masks[3] != 0)
-					line_masks[3] |= local_masks[3];
+				}
+				uint32_t run_start = bz;
+				while (bz < blocks && !block_signs[(bx * blocks + by) * blocks + bz])
+					bz++;
+
+				uint32_t z0 = run_start * step, sz = std::min((bz - run_start) * step, dim - 1 - z0) + 1;
+				float* out = noise_block->samples;
+				vec3 p = overlap_pos + vec3((float)x0, (float)y0, (float)z0) * scale;
+				sampler.block(res, p, ivec3(sx, sy, sz), scale, (void**)&out, &noise_block->vectorset, noise_block->dest_noise, 0, sizeof(float), properties);
+
+				for (uint32_t x = 0; x < sx; x++)
+					for (uint32_t y = 0; y < sy; y++)
+						memcpy(density + ((x0 + x) * dim + y0 + y) * dim + z0, out + (x * sy + y) * sz, sizeof(float) * sz);
 			}
 		}
 	}
+}
+
+// Transposes an 8x8 bit matrix stored one row per byte
+static __forceinline uint64_t transpose_8x8(uint64_t x)
+{
+	uint64_t t;
+	t = (x ^ (x >> 7)) & 0x00AA00AA00AA00AAull;
+	x = x ^ t ^ (t << 7);
+	t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCull;
+	x = x ^ t ^ (t << 14);
+	t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ull;
+	x = x ^ t ^ (t << 28);
+	return x;
+}
 
-	for (uint32_t x = 0; x < dim - 1; x++)
+// Cell corner masks, 8 cells per word with bit (dx * 4 + dy * 2 + dz) of cell z holding sample (x + dx, y + dy, z + dz).
+// Done a 32-cell block at a time: the 4 neighbouring lines give the dz = 0 corners as-is and the dz = 1 corners
+// shifted down by one, and each group of 8 cells is then a single 8x8 bit transpose.
+// Dim is the resolution when known at compile time, which fixes the word counts and unrolls the
+// z loops, or 0 to read it from runtime_dim.
+template<int Dim>
+static void label_corner_masks(const uint32_t* __restrict samples, uint64_t* __restrict masks, uint32_t runtime_dim)
+{
+	const uint32_t dim = (Dim > 0 ? (uint32_t)Dim : runtime_dim);
+	const uint32_t z_per_y = (dim + 31) / 32;
+	const uint32_t y_per_x = z_per_y * dim;
+	const uint32_t z_per_y8 = (dim + 7) / 8;
+	const uint32_t y_per_x8 = z_per_y8 * dim;
+	const uint32_t z_count = z_per_y;
+
+	for (uint32_t x = 0; x < dim; x++)
 	{
-		for (uint32_t y = 0; y < dim - 1; y++)
+		for (uint32_t y = 0; y < dim; y++)
 		{
-			const int m = 6;
+			// Lines at (x, y), (x, y + 1), (x + 1, y), (x + 1, y + 1), missing ones past the edge
+			const uint32_t* lines[4];
+			lines[0] = samples + x * y_per_x + y * z_per_y;
+			lines[1] = (y + 1 < dim ? lines[0] + z_per_y : 0);
+			lines[2] = (x + 1 < dim ? lines[0] + y_per_x : 0);
+			lines[3] = (lines[1] && lines[2] ? lines[2] + z_per_y : 0);
+			uint64_t* __restrict line_masks = masks + x * y_per_x8 + y * z_per_y8;
+
 			for (uint32_t z_block = 0; z_block < z_count; z_block++)
 			{
-				uint32_t line = samples[(x + 1) * y_per_x + (y + 1) * z_per_y + z_block];
-				if (line == 0)
+				// corners[l * 2] holds sample z of line l, corners[l * 2 + 1] sample z + 1
+				uint32_t corners[8];
+				uint32_t any = 0, all = 0xFFFFFFFF;
+				for (int l = 0; l < 4; l++)
+				{
+					uint32_t line = 0, next = 0;
+					if (lines[l])
+					{
+						line = lines[l][z_block];
+						if (z_block + 1 < z_count)
+							next = lines[l][z_block + 1] & 1;
+					}
+					corners[l * 2] = line;
+					corners[l * 2 + 1] = (line >> 1) | (next << 31);
+					any |= corners[l * 2] | corners[l * 2 + 1];
+					all &= corners[l * 2] & corners[l * 2 + 1];
+				}
+
+				uint32_t groups = z_per_y8 - z_block * 4;
+				if (groups > 4)
+					groups = 4;
+				uint64_t* __restrict group_masks = line_masks + z_block * 4;
+				if (!any)
+				{
+					for (uint32_t g = 0; g < groups; g++)
+						group_masks[g] = 0;
 					continue;
-				uint64_t* __restrict line_masks = masks + x * y_per_x8 + y * z_per_y8 + z_block * 4;
-				uint64_t local_masks[4] = { 0, 0, 0, 0 };
-				EDGE_LINE(0, 0, 0x1);
-				EDGE_LINE(0, 1, 0x2);
-
-				EDGE_LINE(0, 2, 0x4);
-				EDGE_LINE(0, 3, 0x8);
-				EDGE_LINE(0, 4, 0x10);
-				EDGE_LINE(0, 5, 0x20);
-				EDGE_LINE(0, 6, 0x40);
-				EDGE_LINE(0, 7, 0x80);
-				EDGE_LINE(1, 0, 0x100);
-				EDGE_LINE(1, 1, 0x200);
-				EDGE_LINE(1, 2, 0x400);
-				EDGE_LINE(1, 3, 0x800);
-				EDGE_LINE(1, 4, 0x1000);
-				EDGE_LINE(1, 5, 0x2000);
-				EDGE_LINE(1, 6, 0x4000);
-				EDGE_LINE(1, 7, 0x8000);
-				EDGE_LINE(2, 0, 0x10000);
-				EDGE_LINE(2, 1, 0x20000);
-				EDGE_LINE(2, 2, 0x40000);
-				EDGE_LINE(2, 3, 0x80000);
-				EDGE_LINE(2, 4, 0x100000);
-				EDGE_LINE(2, 5, 0x200000);
-				EDGE_LINE(2, 6, 0x400000);
-				EDGE_LINE(2, 7, 0x800000);
-				EDGE_LINE(3, 0, 0x1000000);
-				EDGE_LINE(3, 1, 0x2000000);
-				EDGE_LINE(3, 2, 0x4000000);
-				EDGE_LINE(3, 3, 0x8000000);
-				EDGE_LINE(3, 4, 0x10000000);
-				EDGE_LINE(3, 5, 0x20000000);
-				EDGE_LINE(3, 6, 0x40000000);
-				EDGE_LINE(3, 7, 0x80000000);
-
-				if (local_masks[0] != 0)
-					line_masks[0] |= local_masks[0];
-				if (local_masks[1] != 0)
-					line_masks[1] |= local_masks[1];
-				if (local_masks[2] != 0)
-					line_masks[2] |= local_masks[2];
-				if (local_masks[3] != 0)
-					line_masks[3] |= local_masks[3];
+				}
+
+				for (uint32_t g = 0; g < groups; g++)
+				{
+					// Most groups are entirely above or below the surface
+					uint32_t shift = g * 8;
+					if (((any >> shift) & 0xFF) == 0)
+					{
+						group_masks[g] = 0;
+						continue;
+					}
+					if (((all >> shift) & 0xFF) == 0xFF)
+					{
+						group_masks[g] = 0xFFFFFFFFFFFFFFFF;
+						continue;
+					}
+
+					uint64_t packed = 0;
+					for (int c = 0; c < 8; c++)
+						packed |= (uint64_t)((corners[c] >> shift) & 0xFF) << (c * 8);
+					group_masks[g] = transpose_8x8(packed);
+				}
 			}
 		}
 	}
+}
+
+void DMCChunk::label_edges(ResourceAllocator<VerticesIndicesBlock>* vi_allocator, ResourceAllocator<DMC_CellsBlock>* cell_allocator, ResourceAllocator<IndexesBlock>* inds_allocator, ResourceAllocator<DensityBlock>* density_allocator, ResourceAllocator<MasksBlock>* masks_allocator)
+{
+	if (!contains_mesh)
+		return;
+
+	if (!vi)
+	{
+		vi = vi_allocator->new_element();
+		vi->init();
+	}
+	if (!cell_block)
+	{
+		cell_block = cell_allocator->new_element();
+		cell_block->init();
+	}
+
+	uint32_t count = dim * dim * dim;
+	uint32_t z_per_y = (dim + 31) / 32;
+	uint32_t y_per_x = z_per_y * dim;
+
+	uint32_t z_per_y8 = (dim + 7) / 8;
+	uint32_t y_per_x8 = z_per_y8 * dim;
+	uint32_t count8 = y_per_x8 * dim;
+
+	//uint64_t* __restrict masks = (uint64_t*)malloc(sizeof(uint64_t) * count8);
+	//memset(masks, 0, sizeof(uint64_t) * count8);
+	MasksBlock* masks_block = masks_allocator->new_element();
+	masks_block->init(count8);
+	auto masks = masks_block->data;
+
+	// Compile time resolutions for the common sizes, the generic kernel for the rest
+	const uint32_t* samples = binary_block->data;
+	switch (dim)
+	{
+	case 16:
+		label_corner_masks<16>(samples, masks, dim);
+		break;
+	case 32:
+		label_corner_masks<32>(samples, masks, dim);
+		break;
+	case 64:
+		label_corner_masks<64>(samples, masks, dim);
+		break;
+	default:
+		label_corner_masks<0>(samples, masks, dim);
+		break;
+	}
 
 	indexes_block = inds_allocator->new_element();
-	indexes_block->init(dim * dim * dim);
+	indexes_block->init(dim);
 
 	auto& cells = cell_block->cells;
-	auto& inds = indexes_block->inds;
+	uint32_t words_per_row = indexes_block->words_per_row;
+	uint64_t* occupancy = indexes_block->occupancy;
+	uint32_t* offsets = indexes_block->offsets;
 
 	int local_dim = dim;
 
@@ -450,19 +511,27 @@ void DMCChunk::label_edges(ResourceAllocator<VerticesIndicesBlock>* vi_allocator
 	{
 		for (uint32_t y = 0; y < local_dim; y++)
 		{
+			uint64_t* row_occupancy = occupancy + (x * dim + y) * words_per_row;
+			uint32_t* row_offsets = offsets + (x * dim + y) * words_per_row;
 			for (uint32_t z = 0; z < local_dim; z += 8)
 			{
+				uint32_t word = z >> 6;
+				if ((z & 63) == 0)
+				{
+					row_occupancy[word] = 0;
+					row_offsets[word] = (uint32_t)cells.count;
+				}
+
 				uint64_t mask = masks[x * y_per_x8 + y * z_per_y8 + z / 8];
 				if (mask != 0 && mask != 0xFFFFFFFFFFFFFFFF)
 				{
 					for (int sub_z = 0; sub_z < 8 && z + sub_z < dim; sub_z++)
 					{
-						uint32_t index = x * dim * dim + y * dim + z + sub_z;
 						uint8_t sub_mask = (mask & 0xFF);
 						if (sub_mask != 0 && sub_mask != 255)
 						{
 							calculate_cell(x, y, z + sub_z, (uint32_t)vi->vertices.count, sub_mask, temp, local_dim);
-							inds[index] = (uint32_t)cells.count;
+							row_occupancy[word] |= 1ull << ((z + sub_z) & 63);
 							cells.push_back(temp);
 
 							if (temp.edges[0].grid_v1 != -1)
@@ -473,26 +542,9 @@ void DMCChunk::label_edges(ResourceAllocator<VerticesIndicesBlock>* vi_allocator
 								vi->vertices.push_back(calculate_dual_vertex(temp.edges[2].iso_vertex));
 
 						}
-						else if (z + sub_z < dim)
-							inds[index] = -1;
 						mask >>= 8;
 					}
 				}
-				else
-				{
-					inds[x * dim * dim + y * dim + z + 0] = -1;
-					if (z + 1 < dim)
-					{
-						inds[x * dim * dim + y * dim + z + 1] = -1;
-						inds[x * dim * dim + y * dim + z + 2] = -1;
-						inds[x * dim * dim + y * dim + z + 3] = -1;
-						inds[x * dim * dim + y * dim + z + 4] = -1;
-						inds[x * dim * dim + y * dim + z + 5] = -1;
-						inds[x * dim * dim + y * dim + z + 6] = -1;
-						if (z + 7 < dim)
-							inds[x * dim * dim + y * dim + z + 7] = -1;
-					}
-				}
 			}
 		}
 	}
@@ -534,7 +586,7 @@ void DMCChunk::polygonize()
 	}
 }
 
-void DMCChunk::polygonize_cell(DMC_Cell& _c, int x, int y, int z, int dim, SmartContainer<DualVertex>& verts, SmartContainer<uint32_t>& inds)
+void DMCChunk::polygonize_cell(DMC_Cell& _c, int x, int y, int z, int dim, DualVertexStore& verts, SmartContainer<uint32_t>& inds)
 {
 	DMC_ImmediateCell cell;
 	cell.mask = _c.mask;
@@ -570,7 +622,7 @@ void DMCChunk::polygonize_cell(DMC_Cell& _c, int x, int y, int z, int dim, Smart
 		if (e == -1)
 			break;
 		
-		verts[cell.iso_verts[e]].init_valence++;
+		verts.init_valence[cell.iso_verts[e]]++;
 		inds.push_back(cell.iso_verts[e]);
 	}
 }
@@ -581,7 +633,7 @@ void DMCChunk::copy_verts_and_inds(SmartContainer<DualVertex>& v_out, SmartConta
 		return;
 	mesh_offset = v_out.count;
 	size_t start = i_out.count;
-	v_out.push_back(vi->vertices);
+	vi->vertices.copy_to(v_out);
 	i_out.push_back(vi->mesh_indexes);
 
 	for (size_t i = start; i < i_out.count; i++)
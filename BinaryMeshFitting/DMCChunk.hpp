@@ -1,8 +1,5 @@
 #pragma once
 
-#include <gl/glew.h>
-#define GLFW_DLL
-#include <GLFW/glfw3.h>
 #define GLM_FORCE_NO_CTOR_INIT
 #define GLM_FORCE_INLINE
 #include <glm/glm.hpp>
@@ -30,12 +27,19 @@ public:
 	float snap_threshold;
 
 	bool contains_mesh;
+	bool uniform;	// All one sign according to the sampler's range query, never sampled
 	uint32_t mesh_offset;
 	uint64_t parent_code;
+	uint64_t params_key;	// Generator settings the mesh was built with, see MeshCache::make_params_key
+	uint32_t edit_serial;	// Latest brush edit composed into the chunk's samples, 0 when unedited
+	float overlap;
 
 	Sampler sampler;
 
 	VerticesIndicesBlock* vi;
+	// Set instead of vi when the mesh is read in place from a baked tile, see MeshTileReader
+	const class MeshArchive* baked_archive;
+	const struct MeshArchiveEntry* baked_entry;
 
 	DensityBlock* density_block;
 	BinaryBlock* binary_block;
@@ -65,14 +69,20 @@ public:
 
 	// Main pipeline
 	void init(glm::vec3 pos, float size, int level, Sampler& sampler, uint64_t parent_code);
-	void label_grid(ResourceAllocator<BinaryBlock>* binary_allocator, ResourceAllocator<DensityBlock>* density_allocator, ResourceAllocator<NoiseBlock>* noise_allocator, float overlap, NoiseSamplers::NoiseSamplerProperties properties);
+	void set_bounds(float overlap);
+	// What set_bounds would set overlap_pos and scale to, without touching the chunk
+	void get_bounds(float overlap, glm::vec3& out_overlap_pos, float& out_scale) const;
+	void label_grid(ResourceAllocator<BinaryBlock>* binary_allocator, ResourceAllocator<DensityBlock>* density_allocator, ResourceAllocator<NoiseBlock>* noise_allocator, float overlap, NoiseSamplers::NoiseSamplerProperties properties, class HeightfieldCache* heightfield_cache, const std::vector<struct BrushEdit>* edits, class SlabStore* slabs, uint64_t sample_key);
+	void apply_edits(ResourceAllocator<BinaryBlock>* binary_allocator, const std::vector<struct BrushEdit>& edits);
 	void label_edges(ResourceAllocator<VerticesIndicesBlock>* vi_allocator, ResourceAllocator<DMC_CellsBlock>* cell_allocator, ResourceAllocator<IndexesBlock>* inds_allocator, ResourceAllocator<DensityBlock>* density_allocator, ResourceAllocator<MasksBlock>* masks_allocator);
 	void snap_verts();
 	void polygonize();
-	void polygonize_cell(DMC_Cell& _c, int x, int y, int z, int dim, SmartContainer<DualVertex>& verts, SmartContainer<uint32_t>& inds);
+	void polygonize_cell(DMC_Cell& _c, int x, int y, int z, int dim, DualVertexStore& verts, SmartContainer<uint32_t>& inds);
 	void copy_verts_and_inds(SmartContainer<DualVertex>& v_out, SmartContainer<uint32_t>& i_out);
 
 	// Sub procedures
+	void sample_hierarchical(struct NoiseBlock* noise_block, float lipschitz, SamplerProperties* properties);
+	void sample_volume(ResourceAllocator<DensityBlock>* density_allocator, struct NoiseBlock* noise_block, class SlabStore* slabs, uint64_t sample_key, SamplerProperties* properties);
 	void calculate_cell(int x, int y, int z, uint32_t next_v_index, uint8_t mask, DMC_Cell& dest, int dim);
 	void calculate_isovertex(int x0, int y0, int z0, int x1, int y1, int z1, int index, int dim, DMC_Isovertex& out);
 	DualVertex calculate_dual_vertex(DMC_Isovertex& in);
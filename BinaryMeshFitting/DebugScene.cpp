@@ -58,6 +58,8 @@ DebugScene::DebugScene(RenderInput* render_input)
 	this->update_focus = true;
 	this->line_width = 1.0f;
 	this->specular_power = SPECULAR_POWER;
+	this->brush_radius = 4.0f;
+	this->brush_distance = 12.0f;
 
 	this->fill_color[0] = 0.85f;
 	this->fill_color[1] = 0.85f;
@@ -108,6 +110,8 @@ DebugScene::DebugScene(RenderInput* render_input)
 	this->outline_shader_mul_clr = glGetUniformLocation(this->outline_sp, "mul_color");
 	this->outline_shader_camera_pos = glGetUniformLocation(this->outline_sp, "camera_pos");
 	this->outline_shader_chunk_pos = glGetUniformLocation(this->outline_sp, "chunk_pos");
+	this->outline_shader_chunk_box_min = glGetUniformLocation(this->outline_sp, "chunk_box_min");
+	this->outline_shader_chunk_box_size = glGetUniformLocation(this->outline_sp, "chunk_box_size");
 
 	this->camera.init(render_input->width, render_input->height, render_input);
 	this->camera.set_shader(this->shader_projection, this->shader_view);
@@ -118,17 +122,13 @@ DebugScene::DebugScene(RenderInput* render_input)
 	ImGui::GetStyle().Colors[ImGuiCol_WindowBg].w = 0.85f;
 	printf("Done.\n");
 
-	dmc_chunk = 0;
-
 	init_world();
-	//init_dmc_chunk();
 }
 
 DebugScene::~DebugScene()
 {
 	world.watcher.stop();
 
-	delete dmc_chunk;
 	ImGui_ImplGlfwGL3_Shutdown();
 }
 
@@ -214,6 +214,7 @@ void DebugScene::load_main_shader()
 
 	glBindAttribLocation(this->shader_program, 0, "vertex_position");
 	glBindAttribLocation(this->shader_program, 1, "vertex_normal");
+	glBindAttribLocation(this->shader_program, 2, "vertex_color");
 
 	glLinkProgram(this->shader_program);
 	LINKER_ERROR_CHECK(this->shader_program, "regular shader");
@@ -226,77 +227,19 @@ void DebugScene::load_main_shader()
 	this->shader_camera_pos = glGetUniformLocation(this->shader_program, "camera_pos");
 	this->shader_chunk_pos = glGetUniformLocation(this->shader_program, "chunk_pos");
 	this->shader_chunk_depth = glGetUniformLocation(this->shader_program, "chunk_depth");
+	this->shader_chunk_box_min = glGetUniformLocation(this->shader_program, "chunk_box_min");
+	this->shader_chunk_box_size = glGetUniformLocation(this->shader_program, "chunk_box_size");
 	this->shader_rock_texture = glGetUniformLocation(this->shader_program, "rock_texture");
 	this->shader_rock2_texture = glGetUniformLocation(this->shader_program, "rock2_texture");
 	this->shader_grass_texture = glGetUniformLocation(this->shader_program, "grass_texture");
 	this->shader_noise_texture = glGetUniformLocation(this->shader_program, "noise_texture");
 }
 
-void DebugScene::init_dmc_chunk()
-{
-	using namespace std;
-	const int test_size = 256;
-	//Sampler sampler = ImplicitFunctions::create_sampler(ImplicitFunctions::plane_y);
-	//sampler.block = ImplicitFunctions::torus_z_block;
-	Sampler sampler;
-	NoiseSamplers::create_sampler_terrain_pert_3d(&sampler);
-	cout << "Noise SIMD instruction set: " << get_simd_text() << endl;
-	sampler.world_size = 256;
-
-	SmartContainer<DualVertex> v_out(0);
-	SmartContainer<uint32_t> i_out(262144);
-
-	dmc_chunk = new DMCChunk(vec3(-test_size, -test_size, -test_size) * 0.5f, (float)test_size, 0, sampler, 1);
-	double extract_time = dmc_chunk->extract(v_out, i_out, false);
-
-	/*cout << "Processing...";
-	int iters = 15;
-	if (iters > 0 || !QUADS)
-	{
-		Processing::MeshProcessor<4> mp(true, SMOOTH_NORMALS);
-		mp.init(v_out, i_out, sampler);
-		if (iters > 0)
-			mp.collapse_bad_quads();
-		if (!QUADS)
-		{
-			v_out.count = 0;
-			i_out.count = 0;
-			mp.flush_to_tris(v_out, i_out);
-			Processing::MeshProcessor<3> nmp = Processing::MeshProcessor<3>(true, SMOOTH_NORMALS);
-			if (iters > 0)
-			{
-				nmp.init(v_out, i_out, sampler);
-				nmp.optimize_dual_grid(iters);
-				nmp.optimize_primal_grid(false, false);
-				v_out.count = 0;
-				i_out.count = 0;
-				nmp.flush(v_out, i_out);
-			}
-		}
-		else
-		{
-			mp.optimize_dual_grid(iters);
-			mp.optimize_primal_grid(false, false);
-			v_out.count = 0;
-			i_out.count = 0;
-			mp.flush(v_out, i_out);
-		}
-	}*/
-
-	gl_chunk.format_data(v_out, i_out, flat_quads, smooth_shading);
-
-	cout << endl << "Full extraction took " << (int)((extract_time) / (double)CLOCKS_PER_SEC * 1000.0) << "ms" << endl;
-
-	gl_chunk.init(true, true);
-	gl_chunk.format_data(v_out, i_out, false, smooth_shading);
-	gl_chunk.set_data(gl_chunk.p_data, gl_chunk.c_data, &i_out);
-
-	for(int i = 0; i < 8; i++)
-		delete sampler.noise_samplers[i];
-}
-
 void DebugScene::init_world()
 {
+	using namespace std::placeholders;
+	stitch_chunk.init(false, false, false);
+	world.watcher.release_callback = std::bind(&DebugScene::release_node, this, _1);
 	world.init(256);
 	world.init_updates(camera.v_position);
 	/*world.split_leaves();
@@ -348,17 +291,16 @@ int DebugScene::render(RenderInput* input)
 	return 0;
 }
 
-void DebugScene::render_dmc_chunk()
-{
-}
-
 void DebugScene::render_world()
 {
 	std::unique_lock<std::mutex> draw_lock(world.watcher.renderables_mutex);
 	if (!world.watcher.renderables_head)
 		return;
 
-	world.process_from_render_thread();
+	{
+		using namespace std::placeholders;
+		world.process_from_render_thread(std::bind(&DebugScene::upload_node, this, _1), std::bind(&DebugScene::upload_stitches, this, _1));
+	}
 
 	if (!world_visible)
 		return;
@@ -403,9 +345,11 @@ void DebugScene::render_world()
 				{
 					glUniform4f(shader_chunk_pos, n->chunk->overlap_pos.x, n->chunk->overlap_pos.y, n->chunk->overlap_pos.z, n->chunk->scale);
 					glUniform1f(shader_chunk_depth, n->level);
+					glUniform3f(shader_chunk_box_min, n->gl_chunk->box_min.x, n->gl_chunk->box_min.y, n->gl_chunk->box_min.z);
+					glUniform3f(shader_chunk_box_size, n->gl_chunk->box_size.x, n->gl_chunk->box_size.y, n->gl_chunk->box_size.z);
 					glBindVertexArray(n->gl_chunk->vao);
 					if (!flat_quads || !QUADS)
-						glDrawElements((QUADS ? GL_QUADS : GL_TRIANGLES), n->gl_chunk->p_count, GL_UNSIGNED_INT, 0);
+						glDrawElements((QUADS ? GL_QUADS : GL_TRIANGLES), n->gl_chunk->p_count, n->gl_chunk->index_type, 0);
 					else
 						glDrawArrays(GL_QUADS, 0, n->gl_chunk->p_count);
 				}
@@ -415,8 +359,10 @@ void DebugScene::render_world()
 
 		if (world.properties.enable_stitching)
 		{
-			glBindVertexArray(world.watcher.generator.stitcher.gl_chunk.vao);
-			glDrawArrays(GL_TRIANGLES, 0, world.watcher.generator.stitcher.gl_chunk.v_count);
+			glUniform3f(shader_chunk_box_min, stitch_chunk.box_min.x, stitch_chunk.box_min.y, stitch_chunk.box_min.z);
+			glUniform3f(shader_chunk_box_size, stitch_chunk.box_size.x, stitch_chunk.box_size.y, stitch_chunk.box_size.z);
+			glBindVertexArray(stitch_chunk.vao);
+			glDrawArrays(GL_TRIANGLES, 0, stitch_chunk.v_count);
 		}
 
 		glActiveTexture(GL_TEXTURE0);
@@ -455,9 +401,11 @@ void DebugScene::render_world()
 				if (n->gl_chunk && n->gl_chunk->p_count != 0 && frustum.CubeInFrustum(n->chunk->bound_start.x, n->chunk->bound_start.y, n->chunk->bound_start.z, n->chunk->bound_size))
 				{
 					glUniform4f(outline_shader_chunk_pos, n->chunk->overlap_pos.x, n->chunk->overlap_pos.y, n->chunk->overlap_pos.z, n->chunk->scale);
+					glUniform3f(outline_shader_chunk_box_min, n->gl_chunk->box_min.x, n->gl_chunk->box_min.y, n->gl_chunk->box_min.z);
+					glUniform3f(outline_shader_chunk_box_size, n->gl_chunk->box_size.x, n->gl_chunk->box_size.y, n->gl_chunk->box_size.z);
 					glBindVertexArray(n->gl_chunk->vao);
 					if (!flat_quads || !QUADS)
-						glDrawElements((QUADS ? GL_QUADS : GL_TRIANGLES), n->gl_chunk->p_count, GL_UNSIGNED_INT, 0);
+						glDrawElements((QUADS ? GL_QUADS : GL_TRIANGLES), n->gl_chunk->p_count, n->gl_chunk->index_type, 0);
 					else
 						glDrawArrays(GL_QUADS, 0, n->gl_chunk->p_count);
 				}
@@ -467,8 +415,10 @@ void DebugScene::render_world()
 
 		if (world.properties.enable_stitching)
 		{
-			glBindVertexArray(world.watcher.generator.stitcher.gl_chunk.vao);
-			glDrawArrays(GL_TRIANGLES, 0, world.watcher.generator.stitcher.gl_chunk.v_count);
+			glUniform3f(outline_shader_chunk_box_min, stitch_chunk.box_min.x, stitch_chunk.box_min.y, stitch_chunk.box_min.z);
+			glUniform3f(outline_shader_chunk_box_size, stitch_chunk.box_size.x, stitch_chunk.box_size.y, stitch_chunk.box_size.z);
+			glBindVertexArray(stitch_chunk.vao);
+			glDrawArrays(GL_TRIANGLES, 0, stitch_chunk.v_count);
 		}
 	}
 
@@ -485,13 +435,41 @@ void DebugScene::render_world()
 		glUniform1f(shader_smooth_shading, 0);
 		glUniform1f(shader_specular_power, 0);*/
 		glUniform3f(outline_shader_mul_clr, line_color[0], line_color[1], line_color[2]);
+		glUniform3f(outline_shader_chunk_box_min, 0.0f, 0.0f, 0.0f);
+		glUniform3f(outline_shader_chunk_box_size, 1.0f, 1.0f, 1.0f);
 
-		glBindVertexArray(world.outline_chunk.vao);
-		glDrawElements(GL_LINES, world.outline_chunk.p_count, GL_UNSIGNED_INT, 0);
+		glBindVertexArray(outline_chunk.vao);
+		glDrawElements(GL_LINES, outline_chunk.p_count, GL_UNSIGNED_INT, 0);
 		glBindVertexArray(0);
 	}
 }
 
+void DebugScene::upload_node(WorldOctreeNode* n)
+{
+	if (!n->chunk || !n->chunk->contains_mesh || !n->mesh)
+		return;
+
+	if (!n->gl_chunk)
+	{
+		n->gl_chunk = gl_allocator.new_element();
+		if (!n->gl_chunk)
+			return;
+	}
+	n->gl_chunk->init(false, false);
+	n->gl_chunk->set_data(*n->mesh, n->chunk->vi ? &n->chunk->vi->mesh_indexes : 0);
+}
+
+void DebugScene::upload_stitches(ChunkMesh& stitches)
+{
+	stitch_chunk.set_data(stitches, 0);
+}
+
+void DebugScene::release_node(WorldOctreeNode* n)
+{
+	gl_allocator.free_element(n->gl_chunk);
+	n->gl_chunk = 0;
+}
+
 void DebugScene::key_callback(int key, int scancode, int action, int mods)
 {
 	if (action == GLFW_PRESS)
@@ -529,6 +507,14 @@ void DebugScene::key_callback(int key, int scancode, int action, int mods)
 		{
 			update_focus = !update_focus;
 		}
+		if (key == GLFW_KEY_E)
+		{
+			place_brush(BRUSH_OPS_SUBTRACT, (mods & GLFW_MOD_SHIFT) != 0);
+		}
+		if (key == GLFW_KEY_Q)
+		{
+			place_brush(BRUSH_OPS_ADD, (mods & GLFW_MOD_SHIFT) != 0);
+		}
 
 		if (key == GLFW_KEY_PAGE_UP)
 		{
@@ -555,6 +541,13 @@ void DebugScene::key_callback(int key, int scancode, int action, int mods)
 	}
 }
 
+void DebugScene::place_brush(int op, bool box)
+{
+	vec3 forward = vec3(camera.mat_rotation * vec4(0, 0, 1, 0));
+	vec3 center = camera.v_position + forward * brush_distance;
+	world.edits.add((box ? BRUSH_SHAPES_BOX : BRUSH_SHAPES_SPHERE), op, center, vec3(brush_radius, brush_radius, brush_radius));
+}
+
 void DebugScene::render_gui()
 {
 	ImGui_ImplGlfwGL3_NewFrame();
@@ -576,6 +569,20 @@ void DebugScene::render_gui()
 	ImGui::Text("Vertices: %i", v_count);
 	ImGui::Text("Prims: %i", p_count / (QUADS ? 4 : 3));
 	ImGui::Text("Leaves: %i", world.leaf_count);
+	MeshLRUStats lru = world.watcher.generator.mesh_lru.stats();
+	ImGui::Text("Mesh LRU: %i hits, %i misses, %i evicted (%i KB)", (int)lru.hits, (int)lru.misses, (int)lru.evictions, (int)(lru.bytes / 1024));
+	BlockLRUStats blocks = world.watcher.generator.block_lru.stats();
+	ImGui::Text("Block LRU: %i hits, %i misses, %i evicted (%i KB)", (int)blocks.hits, (int)blocks.misses, (int)blocks.evictions, (int)(blocks.bytes / 1024));
+	SlabStoreStats slabs = world.watcher.generator.slab_store.stats();
+	ImGui::Text("Face slabs: %i shared, %i stored, %i evicted (%i KB)", (int)slabs.hits, (int)slabs.inserts, (int)slabs.evictions, (int)(slabs.bytes / 1024));
+	HeightfieldCacheStats hf = world.watcher.generator.heightfield_cache.stats();
+	ImGui::Text("Heightfields: %i hits, %i misses, %i prefetched, %i tiles, %i chunks skipped", (int)hf.hits, (int)hf.misses, (int)hf.prefetched, (int)hf.tiles, (int)hf.skipped_chunks);
+	if (world.watcher.generator.baked_tiles.is_enabled())
+	{
+		MeshTileReaderStats baked = world.watcher.generator.baked_tiles.stats();
+		ImGui::Text("Baked tiles: %i hits, %i misses, %i mapped", (int)baked.hits, (int)baked.misses, (int)baked.open_tiles);
+	}
+	ImGui::Text("Edits: %i (E digs, Q adds, shift for a box)", (int)world.edits.count());
 
 	ImGui::Separator();
 
@@ -594,6 +601,16 @@ void DebugScene::render_gui()
 	ImGui::SliderFloat("##lbl_sensitivity", &camera.rot_sensitivity, 0.0001f, 0.01f);
 	ImGui::NextColumn();
 
+	ImGui::Text("Brush radius:");
+	ImGui::NextColumn();
+	ImGui::SliderFloat("##lbl_brush_radius", &brush_radius, 0.5f, 32.0f);
+	ImGui::NextColumn();
+
+	ImGui::Text("Brush distance:");
+	ImGui::NextColumn();
+	ImGui::SliderFloat("##lbl_brush_distance", &brush_distance, 0.0f, 64.0f);
+	ImGui::NextColumn();
+
 	ImGui::Columns(1);
 
 	DMCChunk* in_chunk = world.get_chunk_id_at(camera.v_position);
@@ -696,6 +713,17 @@ void DebugScene::render_gui()
 	world.properties.chunk_resolution = (int)pow(2.0f, (float)(mul + 4));
 	ImGui::NextColumn();
 
+	// Every level but the two finest, 0 keeps the resolution above
+	int far_resolution = world.properties.level_resolutions[0];
+	ImGui::Text("Far resolution: %i", (far_resolution ? far_resolution : world.properties.chunk_resolution));
+	ImGui::NextColumn();
+	int far_mul = (far_resolution ? (int)log2((float)far_resolution) - 3 : 0);
+	ImGui::SliderInt("##lbl_far_resolution", &far_mul, 0, 4, 0);
+	far_resolution = (far_mul ? (int)pow(2.0f, (float)(far_mul + 3)) : 0);
+	for (int i = 0; i < WORLD_MAX_LEVELS; i++)
+		world.properties.level_resolutions[i] = (i < world.properties.max_level - 1 ? far_resolution : 0);
+	ImGui::NextColumn();
+
 	ImGui::Text("Overlap:");
 	ImGui::NextColumn();
 	ImGui::SliderFloat("##lbl_overlap", &world.properties.overlap, 0.0f, 0.1f);
@@ -709,6 +737,7 @@ void DebugScene::render_gui()
 	//ImGui::Checkbox("Flat quads", &flat_quads);
 	ImGui::Checkbox("Smooth shading", &smooth_shading);
 	ImGui::Checkbox("Stitching", &world.properties.enable_stitching);
+	ImGui::Checkbox("Retain all sampled blocks", &world.properties.retain_all_blocks);
 	ImGui::Checkbox("Update focus point", &update_focus);
 
 	ImGui::Separator();
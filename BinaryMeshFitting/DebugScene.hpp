@@ -8,6 +8,7 @@
 #include "WorldOctree.hpp"
 #include "Frustum.hpp"
 #include "Texture.hpp"
+#include "ResourceAllocator.hpp"
 
 #include <thread>
 #include <mutex>
@@ -29,6 +30,8 @@ class DebugScene
 	float fill_color[4];
 	float clear_color[4];
 	float specular_power;
+	float brush_radius;
+	float brush_distance;
 	GLuint points_vbo;
 	GLuint colors_vbo;
 	GLuint vao;
@@ -51,6 +54,8 @@ class DebugScene
 	GLint shader_camera_pos;
 	GLint shader_chunk_pos;
 	GLint shader_chunk_depth;
+	GLint shader_chunk_box_min;
+	GLint shader_chunk_box_size;
 
 	GLint shader_rock_texture;
 	GLint shader_rock2_texture;
@@ -62,14 +67,16 @@ class DebugScene
 	GLint outline_shader_mul_clr;
 	GLint outline_shader_camera_pos;
 	GLint outline_shader_chunk_pos;
+	GLint outline_shader_chunk_box_min;
+	GLint outline_shader_chunk_box_size;
 
 	class FPSCamera camera;
 	Frustum frustum;
-	GLChunk gl_chunk;
+	GLChunk stitch_chunk;
+	GLChunk outline_chunk;
+	ResourceAllocator<GLChunk> gl_allocator;
 	WorldOctree world;
 
-	class DMCChunk* dmc_chunk;
-
 	std::mutex gl_mutex;
 	clock_t last_extraction;
 
@@ -88,15 +95,17 @@ public:
 
 	void load_main_shader();
 
-	void init_dmc_chunk();
 	void init_world();
 	int update(struct RenderInput* input);
 	int render(struct RenderInput* input);
 
-	void render_dmc_chunk();
 	void render_world();
+	void upload_node(class WorldOctreeNode* n);
+	void upload_stitches(class ChunkMesh& stitches);
+	void release_node(class WorldOctreeNode* n);
 
 	void key_callback(int key, int scancode, int action, int mods);
+	void place_brush(int op, bool box);
 	void render_gui();
 	void reload_shaders();
 };
\ No newline at end of file
@@ -0,0 +1,191 @@
+#include "PCH.h"
+#include "EditLayer.hpp"
+#include "Tables.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace glm;
+
+static inline bool boxes_overlap(const vec3& a_min, const vec3& a_max, const vec3& b_min, const vec3& b_max)
+{
+	return a_min.x <= b_max.x && a_min.y <= b_max.y && a_min.z <= b_max.z &&
+		b_min.x <= a_max.x && b_min.y <= a_max.y && b_min.z <= a_max.z;
+}
+
+float BrushEdit::density(const vec3& p) const
+{
+	vec3 local = p - center;
+	if (shape == BRUSH_SHAPES_BOX)
+	{
+		vec3 d(fabsf(local.x) - half_size.x, fabsf(local.y) - half_size.y, fabsf(local.z) - half_size.z);
+		float outside = length(vec3(fmaxf(d.x, 0.0f), fmaxf(d.y, 0.0f), fmaxf(d.z, 0.0f)));
+		float inside = fminf(fmaxf(d.x, fmaxf(d.y, d.z)), 0.0f);
+		return -(outside + inside);
+	}
+	return half_size.x - length(local);
+}
+
+void BrushEdit::apply(float* data, const vec3& origin, uint32_t dim, float scale) const
+{
+	vec3 lo = (get_min() - origin) / scale - 1.0f;
+	vec3 hi = (get_max() - origin) / scale + 1.0f;
+	int x0 = std::max(0, (int)ceilf(lo.x)), x1 = std::min((int)dim - 1, (int)floorf(hi.x));
+	int y0 = std::max(0, (int)ceilf(lo.y)), y1 = std::min((int)dim - 1, (int)floorf(hi.y));
+	int z0 = std::max(0, (int)ceilf(lo.z)), z1 = std::min((int)dim - 1, (int)floorf(hi.z));
+
+	vec3 p;
+	for (int x = x0; x <= x1; x++)
+	{
+		p.x = origin.x + (float)x * scale;
+		for (int y = y0; y <= y1; y++)
+		{
+			p.y = origin.y + (float)y * scale;
+			float* row = data + ((uint32_t)x * dim + (uint32_t)y) * dim;
+			for (int z = z0; z <= z1; z++)
+			{
+				p.z = origin.z + (float)z * scale;
+				float b = density(p);
+				row[z] = (op == BRUSH_OPS_ADD ? fmaxf(row[z], b) : fminf(row[z], -b));
+			}
+		}
+	}
+}
+
+EditLayer::EditLayer()
+{
+	init(vec3(0, 0, 0), 0.0f);
+}
+
+EditLayer::~EditLayer()
+{
+}
+
+void EditLayer::init(const vec3& pos, float size)
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	nodes.clear();
+	edits.clear();
+	pending.clear();
+	new_node(pos, size);
+}
+
+void EditLayer::clear()
+{
+	vec3 pos;
+	float size;
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		pos = nodes[0].pos;
+		size = nodes[0].size;
+	}
+	init(pos, size);
+}
+
+int EditLayer::new_node(const vec3& pos, float size)
+{
+	Node n;
+	n.pos = pos;
+	n.size = size;
+	for (int i = 0; i < 8; i++)
+		n.children[i] = -1;
+	nodes.push_back(n);
+	return (int)nodes.size() - 1;
+}
+
+uint32_t EditLayer::add(int shape, int op, const vec3& center, const vec3& half_size)
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	BrushEdit e;
+	e.shape = shape;
+	e.op = op;
+	e.center = center;
+	e.half_size = (shape == BRUSH_SHAPES_SPHERE ? vec3(half_size.x, half_size.x, half_size.x) : half_size);
+	e.serial = (uint32_t)edits.size() + 1;
+	edits.push_back(e);
+	pending.push_back(e.serial);
+
+	// Down to the smallest node that holds the whole brush, brushes outside the world stay at the root
+	vec3 e_min = e.get_min(), e_max = e.get_max();
+	vec3 root_max = nodes[0].pos + nodes[0].size;
+	bool inside = e_min.x >= nodes[0].pos.x && e_min.y >= nodes[0].pos.y && e_min.z >= nodes[0].pos.z &&
+		e_max.x <= root_max.x && e_max.y <= root_max.y && e_max.z <= root_max.z;
+	int node = 0;
+	for (int depth = 0; depth < EDIT_LAYER_MAX_DEPTH && inside; depth++)
+	{
+		float c_size = nodes[node].size * 0.5f;
+		vec3 mid = nodes[node].pos + c_size;
+		int dx = (e_min.x >= mid.x ? 1 : (e_max.x < mid.x ? 0 : -1));
+		int dy = (e_min.y >= mid.y ? 1 : (e_max.y < mid.y ? 0 : -1));
+		int dz = (e_min.z >= mid.z ? 1 : (e_max.z < mid.z ? 0 : -1));
+		if (dx < 0 || dy < 0 || dz < 0)
+			break;
+
+		int i = 0;
+		while (Tables::MCDX[i] != (uint32_t)dx || Tables::MCDY[i] != (uint32_t)dy || Tables::MCDZ[i] != (uint32_t)dz)
+			i++;
+		if (nodes[node].children[i] < 0)
+		{
+			int c = new_node(nodes[node].pos + vec3((float)dx, (float)dy, (float)dz) * c_size, c_size);
+			nodes[node].children[i] = c;
+		}
+		node = nodes[node].children[i];
+	}
+	nodes[node].edits.push_back(e.serial - 1);
+
+	return e.serial;
+}
+
+void EditLayer::gather(int node, const vec3& min, const vec3& max, uint32_t after, std::vector<BrushEdit>& out)
+{
+	const Node& n = nodes[node];
+	for (uint32_t index : n.edits)
+	{
+		const BrushEdit& e = edits[index];
+		if (e.serial > after && boxes_overlap(min, max, e.get_min(), e.get_max()))
+			out.push_back(e);
+	}
+
+	for (int i = 0; i < 8; i++)
+	{
+		int c = n.children[i];
+		if (c >= 0 && boxes_overlap(min, max, nodes[c].pos, nodes[c].pos + nodes[c].size))
+			gather(c, min, max, after, out);
+	}
+}
+
+void EditLayer::query(const vec3& min, const vec3& max, uint32_t after, std::vector<BrushEdit>& out)
+{
+	size_t start = out.size();
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		if (edits.empty())
+			return;
+		gather(0, min, max, after, out);
+	}
+
+	// CSG operations don't commute
+	std::sort(out.begin() + start, out.end(), [](const BrushEdit& a, const BrushEdit& b) { return a.serial < b.serial; });
+}
+
+bool EditLayer::intersects(const vec3& min, const vec3& max)
+{
+	std::vector<BrushEdit> found;
+	query(min, max, 0, found);
+	return !found.empty();
+}
+
+void EditLayer::take_pending(std::vector<BrushEdit>& out)
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	for (uint32_t serial : pending)
+		out.push_back(edits[serial - 1]);
+	pending.clear();
+}
+
+uint32_t EditLayer::count()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	return (uint32_t)edits.size();
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <mutex>
+#include <glm/glm.hpp>
+
+// Deepest level an edit is stored at, its node is the smallest one containing the whole brush
+#define EDIT_LAYER_MAX_DEPTH 16
+
+enum BRUSH_SHAPES
+{
+	BRUSH_SHAPES_SPHERE = 0,
+	BRUSH_SHAPES_BOX = 1
+};
+
+enum BRUSH_OPS
+{
+	BRUSH_OPS_ADD = 0,
+	BRUSH_OPS_SUBTRACT = 1
+};
+
+// A CSG brush. Densities follow the samplers, positive inside.
+struct BrushEdit
+{
+	int shape;
+	int op;
+	glm::vec3 center;
+	glm::vec3 half_size;	// Spheres use x as the radius
+	uint32_t serial;		// Edits apply in the order they were made, starting at 1
+
+	inline glm::vec3 get_min() const { return center - half_size; }
+	inline glm::vec3 get_max() const { return center + half_size; }
+
+	float density(const glm::vec3& p) const;
+	// Composes the brush into a dim^3 grid of samples spaced scale apart starting at origin, laid out
+	// like a chunk's density block. Samples up to one cell outside the brush are included too so
+	// edges crossing its surface interpolate between real values.
+	void apply(float* data, const glm::vec3& origin, uint32_t dim, float scale) const;
+};
+
+// Sparse layer of brush edits composed over the sampler output. Edits live in an octree with the
+// same root and subdivision as the WorldOctree, so a chunk's query only visits the nodes along its
+// own branch. Edits are only ever added; the watcher picks up new ones through take_pending.
+class EditLayer
+{
+public:
+	EditLayer();
+	~EditLayer();
+
+	void init(const glm::vec3& pos, float size);
+	void clear();
+
+	// Returns the serial of the new edit
+	uint32_t add(int shape, int op, const glm::vec3& center, const glm::vec3& half_size);
+	// Appends the edits overlapping [min, max] made after serial `after`, oldest first
+	void query(const glm::vec3& min, const glm::vec3& max, uint32_t after, std::vector<BrushEdit>& out);
+	bool intersects(const glm::vec3& min, const glm::vec3& max);
+	// Moves the edits added since the last call into out
+	void take_pending(std::vector<BrushEdit>& out);
+
+	uint32_t count();
+
+private:
+	struct Node
+	{
+		glm::vec3 pos;
+		float size;
+		int children[8];
+		std::vector<uint32_t> edits;
+	};
+
+	std::mutex _mutex;
+	std::vector<Node> nodes;
+	std::vector<BrushEdit> edits;
+	std::vector<uint32_t> pending;
+
+	int new_node(const glm::vec3& pos, float size);
+	void gather(int node, const glm::vec3& min, const glm::vec3& max, uint32_t after, std::vector<BrushEdit>& out);
+};
@@ -1,6 +1,8 @@
 #include "PCH.h"
 #include "GLChunk.hpp"
 #include "SmartContainer.hpp"
+#include "ChunkMesh.hpp"
+#include <cstddef>
 
 GLChunk::GLChunk()
 {
@@ -10,12 +12,16 @@ GLChunk::GLChunk()
 	vao = 0;
 	v_vbo = 0;
 	n_vbo = 0;
+	c_vbo = 0;
 	ibo = 0;
 
 	v_count = 0;
 	p_count = 0;
 	vbo_size = 0;
 	ibo_size = 0;
+	index_type = GL_UNSIGNED_INT;
+	box_min = glm::vec3(0, 0, 0);
+	box_size = glm::vec3(1, 1, 1);
 }
 
 GLChunk::~GLChunk()
@@ -56,16 +62,6 @@ void GLChunk::destroy()
 	initialized = 0;
 }
 
-bool GLChunk::set_data(bool unwind)
-{
-	return set_data(p_data, n_data, c_data, 0, unwind);
-}
-
-bool GLChunk::set_data(SmartContainer<uint32_t>* index_data, bool unwind_verts)
-{
-	return set_data(p_data, n_data, c_data, index_data, unwind_verts);
-}
-
 bool GLChunk::set_data(SmartContainer<glm::vec3>& pos_data, SmartContainer<uint32_t>& index_data)
 {
 	if (!pos_data.count || !index_data.count)
@@ -254,132 +250,56 @@ bool GLChunk::set_data(SmartContainer<glm::vec3>& pos_data, SmartContainer<glm::
 	return true;
 }
 
-bool GLChunk::format_data_tris(SmartContainer<DualVertex>& vert_data)
+bool GLChunk::set_data(ChunkMesh& mesh, SmartContainer<uint32_t>* index_data)
 {
-	p_data.count = 0;
-	n_data.count = 0;
-	c_data.count = 0;
-
-	p_data.prepare_exact(vert_data.count);
-	n_data.prepare_exact(vert_data.count);
-	c_data.prepare_exact(vert_data.count);
-
-	size_t count = vert_data.count;
-	for (size_t i = 0; i < count; i++)
+	bool own_indexes = mesh.indexes && mesh.index_count;
+	bool has_indexes = own_indexes || (index_data && index_data->count);
+	if (!mesh.vertex_count || (index_data && !has_indexes))
 	{
-		p_data.push_back(vert_data[i].p);
-		n_data.push_back(vert_data[i].n);
-		c_data.push_back(vert_data[i].color);
+		v_count = 0;
+		p_count = 0;
+		return false;
 	}
 
-	return true;
-}
+	vbo_size = (uint32_t)mesh.vertex_count;
+	glBindBuffer(GL_ARRAY_BUFFER, v_vbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(PackedVertex) * mesh.vertex_count, mesh.vertices, GL_STATIC_DRAW);
 
-bool GLChunk::format_data(SmartContainer<DualVertex>& vert_data, SmartContainer<uint32_t>& index_data, bool unwind_verts, bool smooth_normals)
-{
-	p_data.count = 0;
-	n_data.count = 0;
-	c_data.count = 0;
-	using namespace glm;
-	if (!unwind_verts)
+	if (has_indexes)
 	{
-		p_data.prepare_exact(vert_data.count);
-		n_data.prepare_exact(vert_data.count);
-		c_data.prepare_exact(vert_data.count);
-
-		size_t count = vert_data.count;
-		for (size_t i = 0; i < count; i++)
+		if (own_indexes)
 		{
-			p_data.push_back(vert_data[i].p);
-			n_data.push_back(vert_data[i].n);
-			c_data.push_back(vert_data[i].color);
+			ibo_size = (uint32_t)mesh.index_count;
+			index_type = (mesh.index_size == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT);
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)mesh.index_size * ibo_size, mesh.indexes, GL_STATIC_DRAW);
 		}
-	}
-	else
-	{
-		p_data.prepare_exact(vert_data.count * 4);
-		n_data.prepare_exact(vert_data.count * 4);
-		c_data.prepare_exact(vert_data.count * 4);
-
-		size_t count = index_data.count;
-		for (size_t i = 0; i < count; i += 4)
+		else
 		{
-			vec3 p[4] = { vert_data[index_data[i]].p, vert_data[index_data[i + 1]].p, vert_data[index_data[i + 2]].p, vert_data[index_data[i + 3]].p };
-			vec3 c[4] = { vert_data[index_data[i]].color, vert_data[index_data[i + 1]].color, vert_data[index_data[i + 2]].color, vert_data[index_data[i + 3]].color };
-			p_data.push_back(p, 4);
-			c_data.push_back(c, 4);
-
-			vec3 n;
-			if (smooth_normals)
-			{
-				n = (vert_data[index_data[i]].n + vert_data[index_data[i + 1]].n + vert_data[index_data[i + 2]].n + vert_data[index_data[i + 3]].n) * 0.25f;
-			}
-			else
-			{
-				vec3 n0 = cross(normalize(vert_data[index_data[i]].p - vert_data[index_data[i + 1]].p), normalize(vert_data[index_data[i]].p - vert_data[index_data[i + 2]].p));
-				vec3 n1 = cross(normalize(vert_data[index_data[i + 2]].p - vert_data[index_data[i + 3]].p), normalize(vert_data[index_data[i + 2]].p - vert_data[index_data[i]].p));
-				if (isnan(n0.x))
-					n0 = n1;
-				if (isnan(n1.x))
-					n1 = n0;
-				n = -normalize((n0 + n1) * 0.5f);
-			}
-			n_data.push_back(n);
-			n_data.push_back(n);
-			n_data.push_back(n);
-			n_data.push_back(n);
+			ibo_size = index_data->count;
+			index_type = GL_UNSIGNED_INT;
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint32_t) * ibo_size, index_data->elements, GL_STATIC_DRAW);
 		}
 	}
 
-	return true;
-}
-
-bool GLChunk::format_data(SmartContainer<DualVertex>& vert_data, bool smooth_normals)
-{
-	p_data.count = 0;
-	n_data.count = 0;
-	c_data.count = 0;
-	using namespace glm;
-
-	p_data.prepare_exact(vert_data.count * 4);
-	n_data.prepare_exact(vert_data.count * 4);
-	c_data.prepare_exact(vert_data.count * 4);
-
-	size_t count = vert_data.count;
-	for (size_t i = 0; i < count; i += 4)
-	{
-		vec3 p[4] = { vert_data[i].p, vert_data[i + 1].p, vert_data[i + 2].p, vert_data[i + 3].p };
-		vec3 c[4] = { vert_data[i].color, vert_data[i + 1].color, vert_data[i + 2].color, vert_data[i + 3].color };
-		p_data.push_back(p, 4);
-		c_data.push_back(c, 4);
+	// 0: position, 3 x unorm16. 1: octahedral normal, 2 x unorm8. 2: color, 3 x unorm8.
+	glBindVertexArray(vao);
+	glBindBuffer(GL_ARRAY_BUFFER, v_vbo);
+	glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, p));
+	glVertexAttribPointer(1, 2, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, n));
+	glVertexAttribPointer(2, 3, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, c));
+	if (has_indexes)
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+	glEnableVertexAttribArray(0);
+	glEnableVertexAttribArray(1);
+	glEnableVertexAttribArray(2);
+	glBindVertexArray(0);
 
-		vec3 n;
-		if (smooth_normals)
-		{
-			n = (vert_data[i].n + vert_data[i + 1].n + vert_data[i + 2].n + vert_data[i + 3].n) * 0.25f;
-		}
-		else
-		{
-			vec3 n0 = cross(normalize(vert_data[i].p - vert_data[i + 1].p), normalize(vert_data[i].p - vert_data[i + 2].p));
-			vec3 n1 = cross(normalize(vert_data[i + 2].p - vert_data[i + 3].p), normalize(vert_data[i + 2].p - vert_data[i].p));
-			if (isnan(n0.x))
-				n0 = n1;
-			if (isnan(n1.x))
-				n1 = n0;
-			n = -normalize((n0 + n1) * 0.5f);
-		}
-		n_data.push_back(n);
-		n_data.push_back(n);
-		n_data.push_back(n);
-		n_data.push_back(n);
-	}
+	box_min = mesh.box_min;
+	box_size = mesh.box_size;
+	v_count = (uint32_t)mesh.vertex_count;
+	p_count = (has_indexes ? ibo_size : v_count);
 
 	return true;
 }
-
-void GLChunk::reset_data()
-{
-	p_data.reset();
-	n_data.reset();
-	c_data.reset();
-}
@@ -5,7 +5,6 @@
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 #include "SmartContainer.hpp"
-#include "Vertices.hpp"
 #include "LinkedNode.hpp"
 
 class GLChunk : public LinkedNode<GLChunk>
@@ -27,22 +26,18 @@ public:
 	uint32_t p_count;
 	uint32_t vbo_size;
 	uint32_t ibo_size;
-
-	SmartContainer<glm::vec3> p_data;
-	SmartContainer<glm::vec3> n_data;
-	SmartContainer<glm::vec3> c_data;
+	GLenum index_type;		// For glDrawElements
+	glm::vec3 box_min;		// Dequantizes packed positions, see ChunkMesh
+	glm::vec3 box_size;
 
 	GLChunk();
 	~GLChunk();
 	void init(bool _normals, bool _colors, bool _indexed = true);
 	void destroy();
-	bool set_data(bool unwind = true);
-	bool set_data(SmartContainer<uint32_t>* index_data, bool unwind_verts);
 	bool set_data(SmartContainer<glm::vec3>& pos_data, SmartContainer<uint32_t>& index_data);
 	bool set_data(SmartContainer<glm::vec3>& pos_data, SmartContainer<glm::vec3>& color_data, SmartContainer<uint32_t>* index_data);
 	bool set_data(SmartContainer<glm::vec3>& pos_data, SmartContainer<glm::vec3>& norm_data, SmartContainer<glm::vec3>& color_data, SmartContainer<uint32_t>* index_data, bool unwind_verts);
-	bool format_data_tris(SmartContainer<DualVertex>& vert_data);
-	bool format_data(SmartContainer<DualVertex>& vert_data, SmartContainer<uint32_t>& index_data, bool unwind_verts, bool smooth_normals);
-	bool format_data(SmartContainer<DualVertex>& vert_data, bool smooth_normals);
-	void reset_data();
+	// Uploads the mesh's packed vertices interleaved in a single buffer, with the mesh's own indexes
+	// when it has them and index_data otherwise. Without either they're drawn as a triangle list.
+	bool set_data(class ChunkMesh& mesh, SmartContainer<uint32_t>* index_data);
 };
\ No newline at end of file
@@ -0,0 +1,245 @@
+#include "PCH.h"
+#include "HeightfieldCache.hpp"
+
+#include <cstring>
+
+static inline uint64_t hash_combine(uint64_t h, const void* data, size_t size)
+{
+	const uint8_t* p = (const uint8_t*)data;
+	for (size_t i = 0; i < size; i++)
+	{
+		h ^= p[i];
+		h *= 0x100000001B3ull;
+	}
+	return h;
+}
+
+template <class T>
+static inline uint64_t hash_combine(uint64_t h, const T& value)
+{
+	return hash_combine(h, &value, sizeof(T));
+}
+
+size_t HeightfieldCache::KeyHash::operator()(const Key& k) const
+{
+	uint64_t h = k.properties_hash;
+	h = hash_combine(h, k.x);
+	h = hash_combine(h, k.z);
+	h = hash_combine(h, k.scale);
+	h = hash_combine(h, k.dim);
+	return (size_t)h;
+}
+
+HeightfieldCache::HeightfieldCache() : max_tiles(HEIGHTFIELD_CACHE_MAX_TILES), hits(0), misses(0), evictions(0), skipped_chunks(0), prefetched(0)
+{
+}
+
+HeightfieldCache::~HeightfieldCache()
+{
+	clear();
+}
+
+void HeightfieldCache::init(size_t _max_tiles)
+{
+	clear();
+	std::unique_lock<std::mutex> lock(_mutex);
+	max_tiles = _max_tiles;
+}
+
+void HeightfieldCache::clear()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	// Referenced tiles stay alive until they are released
+	for (Entry* e : unused)
+	{
+		lookup.erase(e->key);
+		destroy(e);
+	}
+	unused.clear();
+}
+
+uint64_t HeightfieldCache::hash_properties(const Sampler& sampler, const NoiseSamplers::NoiseSamplerProperties* properties)
+{
+	// Field by field so padding and the vtable pointer never end up in the key
+	uint64_t h = 0xCBF29CE484222325ull;
+	h = hash_combine(h, sampler.world_size);
+	h = hash_combine(h, sampler.type);
+	if (!properties)
+		return h;
+	h = hash_combine(h, properties->g_scale);
+	h = hash_combine(h, properties->height);
+	h = hash_combine(h, properties->octaves);
+	h = hash_combine(h, properties->amp);
+	h = hash_combine(h, properties->frequency);
+	h = hash_combine(h, properties->gain);
+	h = hash_combine(h, (int)properties->noise_type);
+	h = hash_combine(h, (int)properties->fractal_type);
+	return h;
+}
+
+HeightfieldCache::Key HeightfieldCache::make_key(const Sampler& sampler, const glm::vec3& p, uint32_t dim, float scale, const NoiseSamplers::NoiseSamplerProperties* properties)
+{
+	Key key;
+	key.properties_hash = hash_properties(sampler, properties);
+	key.x = p.x;
+	key.z = p.z;
+	key.scale = scale;
+	key.dim = dim;
+	return key;
+}
+
+HeightfieldCache::Entry* HeightfieldCache::create(const Key& key, const float* columns, uint32_t dim, float y_scale)
+{
+	Entry* e = new Entry();
+	e->key = key;
+	e->refs = 0;
+	e->dim = dim;
+	e->y_scale = y_scale;
+	e->columns = (float*)_aligned_malloc(sizeof(float) * dim * dim, 16);
+	memcpy(e->columns, columns, sizeof(float) * dim * dim);
+	e->min = e->columns[0];
+	e->max = e->columns[0];
+	for (uint32_t i = 1; i < dim * dim; i++)
+	{
+		e->min = (e->columns[i] < e->min ? e->columns[i] : e->min);
+		e->max = (e->columns[i] > e->max ? e->columns[i] : e->max);
+	}
+	return e;
+}
+
+const HeightfieldTile* HeightfieldCache::acquire(const Sampler& sampler, const glm::vec3& p, uint32_t dim, float scale, float* temp_columns, NoiseVectorSet* vectorset, NoiseSamplers::NoiseSamplerProperties* properties)
+{
+	Key key = make_key(sampler, p, dim, scale, properties);
+
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		auto search = lookup.find(key);
+		if (search != lookup.end())
+		{
+			Entry* e = search->second;
+			if (e->refs++ == 0)
+				unused.erase(e->unused_it);
+			hits++;
+			return e;
+		}
+		misses++;
+	}
+
+	// Sampled outside the lock; if another thread gets there first its tile wins
+	float y_scale = sampler.heightfield(sampler.world_size, p, glm::ivec3(dim, dim, dim), scale, temp_columns, vectorset, properties);
+
+	Entry* e = create(key, temp_columns, dim, y_scale);
+	e->refs = 1;
+
+	std::unique_lock<std::mutex> lock(_mutex);
+	auto inserted = lookup.insert(std::make_pair(key, e));
+	if (!inserted.second)
+	{
+		destroy(e);
+		e = inserted.first->second;
+		if (e->refs++ == 0)
+			unused.erase(e->unused_it);
+	}
+	return e;
+}
+
+void HeightfieldCache::release(const HeightfieldTile* tile)
+{
+	if (!tile)
+		return;
+	Entry* e = (Entry*)static_cast<const Entry*>(tile);
+
+	std::unique_lock<std::mutex> lock(_mutex);
+	if (--e->refs == 0)
+	{
+		unused.push_front(e);
+		e->unused_it = unused.begin();
+		evict();
+	}
+}
+
+void HeightfieldCache::filter_missing(const Sampler& sampler, std::vector<HeightfieldFootprint>& footprints, const NoiseSamplers::NoiseSamplerProperties* properties)
+{
+	std::unordered_map<Key, int, KeyHash> seen;
+	size_t kept = 0;
+	std::unique_lock<std::mutex> lock(_mutex);
+	for (size_t i = 0; i < footprints.size(); i++)
+	{
+		Key key = make_key(sampler, footprints[i].pos, footprints[i].dim, footprints[i].scale, properties);
+		if (lookup.count(key) || !seen.insert(std::make_pair(key, 0)).second)
+			continue;
+		footprints[kept++] = footprints[i];
+	}
+	footprints.resize(kept);
+}
+
+void HeightfieldCache::prefetch(const Sampler& sampler, const HeightfieldFootprint* footprints, int count, NoiseSamplers::NoiseSamplerProperties* properties)
+{
+	if (!sampler.heightfield_batch || count <= 0)
+		return;
+
+	uint32_t dim = footprints[0].dim;
+	std::vector<glm::vec3> p(count);
+	std::vector<float> scale(count);
+	for (int i = 0; i < count; i++)
+	{
+		assert(footprints[i].dim == dim);
+		p[i] = footprints[i].pos;
+		scale[i] = footprints[i].scale;
+	}
+
+	float* columns = (float*)_aligned_malloc(sizeof(float) * dim * dim * count, 16);
+	NoiseVectorSet vectorset;
+	float y_scale = sampler.heightfield_batch(sampler.world_size, p.data(), scale.data(), count, glm::ivec3(dim, dim, dim), columns, &vectorset, properties);
+
+	std::vector<Entry*> created(count);
+	for (int i = 0; i < count; i++)
+		created[i] = create(make_key(sampler, p[i], dim, scale[i], properties), columns + i * dim * dim, dim, y_scale);
+	_aligned_free(columns);
+
+	std::unique_lock<std::mutex> lock(_mutex);
+	for (Entry* e : created)
+	{
+		// A chunk that didn't wait for the prefetch may have sampled the tile already
+		if (!lookup.insert(std::make_pair(e->key, e)).second)
+		{
+			destroy(e);
+			continue;
+		}
+		unused.push_front(e);
+		e->unused_it = unused.begin();
+		prefetched++;
+	}
+	evict();
+}
+
+HeightfieldCacheStats HeightfieldCache::stats()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	HeightfieldCacheStats s;
+	s.hits = hits;
+	s.misses = misses;
+	s.evictions = evictions;
+	s.skipped_chunks = skipped_chunks;
+	s.prefetched = prefetched;
+	s.tiles = lookup.size();
+	return s;
+}
+
+void HeightfieldCache::evict()
+{
+	while (lookup.size() > max_tiles && !unused.empty())
+	{
+		Entry* e = unused.back();
+		unused.pop_back();
+		lookup.erase(e->key);
+		destroy(e);
+		evictions++;
+	}
+}
+
+void HeightfieldCache::destroy(Entry* e)
+{
+	_aligned_free(e->columns);
+	delete e;
+}
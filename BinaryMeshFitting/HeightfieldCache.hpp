@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+#include <mutex>
+#include "NoiseSampler.hpp"
+
+#define HEIGHTFIELD_CACHE_MAX_TILES 1024
+
+struct HeightfieldCacheStats
+{
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+	uint64_t skipped_chunks;
+	uint64_t prefetched;
+	size_t tiles;
+};
+
+// Where a chunk samples its columns: the x and z of its overlapped position, its cell size and resolution
+struct HeightfieldFootprint
+{
+	glm::vec3 pos;
+	float scale;
+	uint32_t dim;
+};
+
+// The columns of a heightfield sampler for one chunk footprint, see SamplerHeightfieldFunction
+struct HeightfieldTile
+{
+	float* columns;
+	uint32_t dim;
+	float y_scale;
+	float min;
+	float max;
+};
+
+// Every chunk stacked in the same x/z column at the same level samples the same heightfield.
+// Tiles are keyed by that footprint (position, cell size and resolution) plus the sampler's
+// type, world size and noise settings, and shared between threads: acquire hands out a
+// referenced tile, generating it on a miss, and release drops the reference. Only unreferenced
+// tiles are evicted, oldest first, once there are more than max_tiles.
+class HeightfieldCache
+{
+public:
+	HeightfieldCache();
+	~HeightfieldCache();
+
+	void init(size_t max_tiles);
+	void clear();
+
+	// The tile for a chunk at p (x and z used) with the given cell size, never 0
+	const HeightfieldTile* acquire(const Sampler& sampler, const glm::vec3& p, uint32_t dim, float scale, float* temp_columns, NoiseVectorSet* vectorset, NoiseSamplers::NoiseSamplerProperties* properties);
+	void release(const HeightfieldTile* tile);
+	// Drops the footprints that already have a tile, and repeats, leaving what prefetch should sample
+	void filter_missing(const Sampler& sampler, std::vector<HeightfieldFootprint>& footprints, const NoiseSamplers::NoiseSamplerProperties* properties);
+	// Samples the tiles of count footprints, all of the same dim, in one sampler.heightfield_batch call
+	// and keeps them unreferenced for the chunks that acquire them next
+	void prefetch(const Sampler& sampler, const HeightfieldFootprint* footprints, int count, NoiseSamplers::NoiseSamplerProperties* properties);
+	inline void count_skipped() { std::unique_lock<std::mutex> lock(_mutex); skipped_chunks++; }
+
+	HeightfieldCacheStats stats();
+
+private:
+	struct Key
+	{
+		uint64_t properties_hash;
+		float x;
+		float z;
+		float scale;
+		uint32_t dim;
+
+		inline bool operator==(const Key& other) const { return properties_hash == other.properties_hash && x == other.x && z == other.z && scale == other.scale && dim == other.dim; }
+	};
+
+	struct KeyHash
+	{
+		size_t operator()(const Key& k) const;
+	};
+
+	struct Entry : public HeightfieldTile
+	{
+		Key key;
+		int refs;
+		std::list<Entry*>::iterator unused_it;	// Valid while refs == 0
+	};
+
+	std::mutex _mutex;
+	size_t max_tiles;
+	std::unordered_map<Key, Entry*, KeyHash> lookup;
+	std::list<Entry*> unused;	// Unreferenced tiles, most recently released first
+
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+	uint64_t skipped_chunks;
+	uint64_t prefetched;
+
+	static uint64_t hash_properties(const Sampler& sampler, const NoiseSamplers::NoiseSamplerProperties* properties);
+	static Key make_key(const Sampler& sampler, const glm::vec3& p, uint32_t dim, float scale, const NoiseSamplers::NoiseSamplerProperties* properties);
+	static Entry* create(const Key& key, const float* columns, uint32_t dim, float y_scale);
+	void evict();
+	void destroy(Entry* e);
+};
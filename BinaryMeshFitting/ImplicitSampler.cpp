@@ -33,12 +33,12 @@ namespace ImplicitFunctions
 		return -(len - r2);
 	}
 
-	const void torus_z_block(const float resolution, const glm::vec3& p, const glm::ivec3& size, const float scale, void** out, FastNoiseVectorSet* vectorset_out, float* dest_noise, int offset, int stride, SamplerProperties* properties)
+	const void torus_z_block(const float resolution, const glm::vec3& p, const glm::ivec3& size, const float scale, void** out, NoiseVectorSet* vectorset_out, float* dest_noise, int offset, int stride, SamplerProperties* properties)
 	{
 		BLOCK(torus_z);
 	}
 
-	const void cuboid_block(const float resolution, const glm::vec3& p, const glm::ivec3& size, const float scale, void** out, FastNoiseVectorSet* vectorset_out, float* dest_noise, int offset, int stride, SamplerProperties* properties)
+	const void cuboid_block(const float resolution, const glm::vec3& p, const glm::ivec3& size, const float scale, void** out, NoiseVectorSet* vectorset_out, float* dest_noise, int offset, int stride, SamplerProperties* properties)
 	{
 		BLOCK(cuboid);
 	}
@@ -5,13 +5,13 @@
 namespace ImplicitFunctions
 {
 	const float torus_z(const float resolution, const glm::vec3& p);
-	const void torus_z_block(const float resolution, const glm::vec3& p, const glm::ivec3& size, const float scale, void** out, FastNoiseVectorSet* vectorset_out, float* dest_noise, int offset, int stride, SamplerProperties* properties);
+	const void torus_z_block(const float resolution, const glm::vec3& p, const glm::ivec3& size, const float scale, void** out, NoiseVectorSet* vectorset_out, float* dest_noise, int offset, int stride, SamplerProperties* properties);
 	const float sphere(const float resolution, const glm::vec3& p);
 	const float cuboid(const float resolution, const glm::vec3& p);
-	const void cuboid_block(const float resolution, const glm::vec3& p, const glm::ivec3& size, const float scale, void** out, FastNoiseVectorSet* vectorset_out, float* dest_noise, int offset, int stride, SamplerProperties* properties);
+	const void cuboid_block(const float resolution, const glm::vec3& p, const glm::ivec3& size, const float scale, void** out, NoiseVectorSet* vectorset_out, float* dest_noise, int offset, int stride, SamplerProperties* properties);
 	const float plane_y(const float resolution, const glm::vec3& p);
 
-	inline void implicit_block(const SamplerValueFunction& f, const float resolution, const glm::vec3& p, const glm::ivec3& size, const float scale, void** out, FastNoiseVectorSet* vectorset_out, float* dest_noise, int offset, int stride)
+	inline void implicit_block(const SamplerValueFunction& f, const float resolution, const glm::vec3& p, const glm::ivec3& size, const float scale, void** out, NoiseVectorSet* vectorset_out, float* dest_noise, int offset, int stride)
 	{
 		if (!out)
 			return;
@@ -48,6 +48,24 @@ namespace ImplicitFunctions
 		return vec3(dxp - dxm, dyp - dym, dzp - dzm);
 	}
 
+	// All the functions here change by at most the distance moved (1-Lipschitz), so over a box
+	// they stay within half its diagonal of the value at the center
+	inline bool implicit_range(SamplerValueFunction f, const float resolution, const glm::vec3& min, const glm::vec3& max, float& out_min, float& out_max, SamplerProperties* properties)
+	{
+		glm::vec3 center = (min + max) * 0.5f;
+		glm::vec3 half = (max - min) * 0.5f;
+		float h = sqrtf(half.x * half.x + half.y * half.y + half.z * half.z) * 1.001f + 0.001f;
+		float v = f(resolution, center);
+		out_min = v - h;
+		out_max = v + h;
+		return true;
+	}
+
+	inline float implicit_lipschitz(const float resolution, SamplerProperties* properties)
+	{
+		return 1.0f;
+	}
+
 	inline Sampler create_sampler(const SamplerValueFunction& f)
 	{
 		using namespace std::placeholders;
@@ -55,6 +73,8 @@ namespace ImplicitFunctions
 		s.value = f;
 		s.block = std::bind(implicit_block, f, _1, _2, _3, _4, _5, _6, _7, _8, _9);
 		s.gradient = std::bind(implicit_gradient, f, _1, _2, _3);
+		s.range = std::bind(implicit_range, f, _1, _2, _3, _4, _5, _6);
+		s.lipschitz = implicit_lipschitz;
 		return s;
 	}
 
@@ -0,0 +1,155 @@
+#include "PCH.h"
+#include "JobSystem.hpp"
+#include <omp.h>
+
+static thread_local int current_worker = -1;
+static thread_local std::vector<std::unique_ptr<FastNoiseSIMD>>* current_noise = 0;
+
+JobGroup::JobGroup() : pending(0)
+{
+}
+
+void JobGroup::wait()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	_cv.wait(lock, [this] { return pending.load() == 0; });
+}
+
+void JobGroup::finish()
+{
+	// wait() can only see zero once this lock is released, after which the group isn't touched
+	std::unique_lock<std::mutex> lock(_mutex);
+	if (pending.fetch_sub(1) == 1)
+		_cv.notify_all();
+}
+
+JobSystem::JobSystem() : queued(0), stopping(false), next_worker(0)
+{
+}
+
+JobSystem::~JobSystem()
+{
+	shutdown();
+}
+
+void JobSystem::init(int thread_count)
+{
+	shutdown();
+	if (thread_count < 1)
+		thread_count = 1;
+
+	stopping = false;
+	for (int i = 0; i < thread_count; i++)
+		workers.emplace_back(new Worker());
+	for (int i = 0; i < thread_count; i++)
+		threads.emplace_back(&JobSystem::worker_loop, this, i);
+}
+
+void JobSystem::shutdown()
+{
+	{
+		std::unique_lock<std::mutex> lock(sleep_mutex);
+		stopping = true;
+	}
+	sleep_cv.notify_all();
+	for (auto& t : threads)
+		t.join();
+	threads.clear();
+	workers.clear();
+	queued = 0;
+}
+
+int JobSystem::get_worker_index()
+{
+	return current_worker;
+}
+
+FastNoiseSIMD* JobSystem::get_noise(uint32_t noise_id)
+{
+	static thread_local NoiseGenerators thread_noise;
+	NoiseGenerators& noise = (current_noise ? *current_noise : thread_noise);
+	if (noise_id >= noise.size())
+		noise.resize(noise_id + 1);
+	if (!noise[noise_id])
+		noise[noise_id].reset(FastNoiseSIMD::NewFastNoiseSIMD());
+	return noise[noise_id].get();
+}
+
+void JobSystem::submit(JobFunction f, JobGroup* group, int priority)
+{
+	if (group)
+		group->pending++;
+
+	int index = current_worker;
+	if (index < 0 || index >= (int)workers.size())
+		index = (int)(next_worker++ % (uint32_t)workers.size());
+
+	{
+		Worker& w = *workers[index];
+		std::unique_lock<std::mutex> lock(w._mutex);
+		w.queues[priority].push_back({ std::move(f), group });
+	}
+	{
+		std::unique_lock<std::mutex> lock(sleep_mutex);
+		queued++;
+	}
+	sleep_cv.notify_one();
+}
+
+bool JobSystem::take(int index, Job& out)
+{
+	int count = (int)workers.size();
+	for (int p = 0; p < JOB_PRIORITIES_COUNT; p++)
+	{
+		// Own work first, newest first so a chunk's next stage runs while its data is still in cache
+		{
+			Worker& w = *workers[index];
+			std::unique_lock<std::mutex> lock(w._mutex);
+			if (!w.queues[p].empty())
+			{
+				out = std::move(w.queues[p].back());
+				w.queues[p].pop_back();
+				return true;
+			}
+		}
+		for (int k = 1; k < count; k++)
+		{
+			Worker& w = *workers[(index + k) % count];
+			std::unique_lock<std::mutex> lock(w._mutex);
+			if (!w.queues[p].empty())
+			{
+				out = std::move(w.queues[p].front());
+				w.queues[p].pop_front();
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+void JobSystem::worker_loop(int index)
+{
+	current_worker = index;
+	current_noise = &workers[index]->noise;
+	// Jobs already run in parallel with each other, keep any omp loops inside them on this thread
+	omp_set_num_threads(1);
+
+	Job job;
+	for (;;)
+	{
+		if (take(index, job))
+		{
+			queued--;
+			job.f();
+			if (job.group)
+				job.group->finish();
+			job.f = nullptr;
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleep_mutex);
+		sleep_cv.wait(lock, [this] { return stopping || queued.load() > 0; });
+		if (stopping && queued.load() == 0)
+			return;
+	}
+}
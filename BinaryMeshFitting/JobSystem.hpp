@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <thread>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <FastNoiseSIMD.h>
+
+enum JOB_PRIORITIES
+{
+	JOB_PRIORITIES_HIGH = 0,
+	JOB_PRIORITIES_NORMAL = 1,
+	JOB_PRIORITIES_LOW = 2,
+	JOB_PRIORITIES_COUNT = 3
+};
+
+// A set of jobs that can be waited on together. The count only reaches zero under the
+// group's lock, so the group can live on the waiter's stack.
+class JobGroup
+{
+public:
+	JobGroup();
+
+	void wait();
+
+private:
+	friend class JobSystem;
+
+	std::atomic<int> pending;
+	std::mutex _mutex;
+	std::condition_variable _cv;
+
+	void finish();
+};
+
+typedef std::function<void()> JobFunction;
+
+// Work-stealing job system. Every worker owns one deque per priority; jobs submitted
+// from a worker go to its own deque and are popped LIFO, idle workers steal FIFO from
+// the others. Higher priorities are always drained first, across all workers.
+class JobSystem
+{
+public:
+	JobSystem();
+	~JobSystem();
+
+	void init(int thread_count);
+	void shutdown();
+	inline int get_thread_count() const { return (int)threads.size(); }
+
+	void submit(JobFunction f, JobGroup* group, int priority = JOB_PRIORITIES_NORMAL);
+
+	// Index of the calling worker in [0, thread count), or -1 on any other thread
+	static int get_worker_index();
+
+	// The calling thread's noise generator for one sampler, see Sampler::noise_id. Samplers set
+	// up theirs before every fill but not every setting, so each gets its own. A worker's are
+	// kept with the worker and freed when the workers are, any other thread's when it exits.
+	static FastNoiseSIMD* get_noise(uint32_t noise_id);
+
+private:
+	struct Job
+	{
+		JobFunction f;
+		JobGroup* group;
+	};
+
+	typedef std::vector<std::unique_ptr<FastNoiseSIMD>> NoiseGenerators;
+
+	struct Worker
+	{
+		std::mutex _mutex;
+		std::deque<Job> queues[JOB_PRIORITIES_COUNT];
+		NoiseGenerators noise;	// Only touched by the worker's thread
+	};
+
+	std::vector<std::unique_ptr<Worker>> workers;
+	std::vector<std::thread> threads;
+	std::mutex sleep_mutex;
+	std::condition_variable sleep_cv;
+	std::atomic<int> queued;
+	std::atomic<bool> stopping;
+	std::atomic<uint32_t> next_worker;
+
+	bool take(int index, Job& out);
+	void worker_loop(int index);
+};
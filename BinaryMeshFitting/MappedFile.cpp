@@ -0,0 +1,64 @@
+#include "PCH.h"
+#include "MappedFile.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& path) : data(0), size(0)
+{
+#ifdef _WIN32
+	file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+	mapping = 0;
+	if (file == INVALID_HANDLE_VALUE)
+		return;
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0)
+		return;
+	mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+	if (!mapping)
+		return;
+	data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (data)
+		size = (size_t)file_size.QuadPart;
+#else
+	fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return;
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0)
+		return;
+	void* p = mmap(0, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (p == MAP_FAILED)
+		return;
+	data = (const char*)p;
+	size = (size_t)st.st_size;
+	// The mapping outlives the descriptor, many archives can stay mapped without running out of them
+	close(fd);
+	fd = -1;
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+#ifdef _WIN32
+	if (data)
+		UnmapViewOfFile(data);
+	if (mapping)
+		CloseHandle(mapping);
+	if (file != INVALID_HANDLE_VALUE)
+		CloseHandle(file);
+#else
+	if (data)
+		munmap((void*)data, size);
+	if (fd >= 0)
+		close(fd);
+#endif
+}
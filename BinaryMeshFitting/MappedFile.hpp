@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Read-only view of a whole file, mapped for as long as the object lives. data stays 0 if the
+// file is missing, empty or can't be mapped.
+class MappedFile
+{
+public:
+	const char* data;
+	size_t size;
+
+	MappedFile(const std::string& path);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+private:
+#ifdef _WIN32
+	void* file;
+	void* mapping;
+#else
+	int fd;
+#endif
+};
@@ -0,0 +1,284 @@
+#include "PCH.h"
+#include "MeshArchive.hpp"
+#include "MappedFile.hpp"
+#include "DMCChunk.hpp"
+
+#include <cstring>
+#include <algorithm>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+static inline uint64_t get_payload_size(const MeshArchiveEntry& e)
+{
+	return (uint64_t)e.vertex_count * sizeof(PackedVertex) + (uint64_t)e.index_count * e.index_size;
+}
+
+MeshArchiveWriter::MeshArchiveWriter() : file(0), offset(0), failed(false)
+{
+}
+
+MeshArchiveWriter::~MeshArchiveWriter()
+{
+	close();
+}
+
+bool MeshArchiveWriter::open(const std::string& _path)
+{
+	close();
+	path = _path;
+	temp_path = path + ".tmp";
+	entries.clear();
+	offset = 0;
+	failed = false;
+	file = fopen(temp_path.c_str(), "wb");
+	if (!file)
+		return false;
+
+	// Rewritten with the real counts on close
+	MeshArchiveHeader header;
+	memset(&header, 0, sizeof(MeshArchiveHeader));
+	return write(&header, sizeof(MeshArchiveHeader)) && pad();
+}
+
+bool MeshArchiveWriter::add(DMCChunk* chunk)
+{
+	if (!file || failed)
+		return false;
+
+	MeshArchiveEntry e;
+	memset(&e, 0, sizeof(MeshArchiveEntry));
+	e.morton_code = chunk->parent_code;
+	e.params_key = chunk->params_key;
+	e.payload_offset = offset;
+	e.overlap = chunk->overlap;
+	e.level = (uint32_t)chunk->level;
+	e.index_size = 2;
+	if (chunk->baked_entry)
+	{
+		// Read in place from another archive, the payload is copied as it is
+		const MeshArchiveEntry* baked = chunk->baked_entry;
+		memcpy(e.box_min, baked->box_min, sizeof(e.box_min));
+		memcpy(e.box_max, baked->box_max, sizeof(e.box_max));
+		e.vertex_count = baked->vertex_count;
+		e.index_count = baked->index_count;
+		e.index_size = baked->index_size;
+		const MeshArchive* archive = chunk->baked_archive;
+		bool ok = write(archive->get_vertices(baked), (size_t)get_payload_size(*baked)) && pad();
+		if (!ok)
+			return false;
+		entries.push_back(e);
+		return true;
+	}
+	if (!chunk->contains_mesh || !chunk->vi || !chunk->vi->vertices.count || !chunk->vi->mesh_indexes.count)
+	{
+		entries.push_back(e);
+		return true;
+	}
+
+	using namespace glm;
+	DualVertexStore& verts = chunk->vi->vertices;
+	SmartContainer<uint32_t>& inds = chunk->vi->mesh_indexes;
+	size_t v_count = verts.count;
+	size_t i_count = inds.count;
+
+	vec3 box_min = chunk->overlap_pos + verts.p[0] * chunk->scale;
+	vec3 box_max = box_min;
+	for (size_t i = 1; i < v_count; i++)
+	{
+		vec3 p = chunk->overlap_pos + verts.p[i] * chunk->scale;
+		box_min = min(box_min, p);
+		box_max = max(box_max, p);
+	}
+	vec3 extent = box_max - box_min;
+	vec3 inv_extent = vec3(extent.x > 0.0f ? 1.0f / extent.x : 0.0f, extent.y > 0.0f ? 1.0f / extent.y : 0.0f, extent.z > 0.0f ? 1.0f / extent.z : 0.0f);
+
+	vertices.resize(v_count);
+	for (size_t i = 0; i < v_count; i++)
+		vertices[i] = pack_vertex(chunk->overlap_pos + verts.p[i] * chunk->scale, verts.n[i], verts.color[i], box_min, inv_extent);
+
+	for (int k = 0; k < 3; k++)
+	{
+		e.box_min[k] = box_min[k];
+		e.box_max[k] = box_max[k];
+	}
+	e.vertex_count = (uint32_t)v_count;
+	e.index_count = (uint32_t)i_count;
+	e.index_size = (v_count <= 65536 ? 2 : 4);
+
+	bool ok = write(vertices.data(), v_count * sizeof(PackedVertex));
+	if (e.index_size == 2)
+	{
+		short_indexes.resize(i_count);
+		for (size_t i = 0; i < i_count; i++)
+			short_indexes[i] = (uint16_t)inds.elements[i];
+		ok = ok && write(short_indexes.data(), i_count * sizeof(uint16_t));
+	}
+	else
+		ok = ok && write(inds.elements, i_count * sizeof(uint32_t));
+	ok = ok && pad();
+	if (!ok)
+		return false;
+
+	entries.push_back(e);
+	return true;
+}
+
+bool MeshArchiveWriter::close()
+{
+	if (!file)
+		return true;
+
+	bool ok = !failed;
+	if (ok && !entries.empty())
+	{
+		std::sort(entries.begin(), entries.end(), [](const MeshArchiveEntry& a, const MeshArchiveEntry& b) { return a.morton_code < b.morton_code; });
+
+		MeshArchiveHeader header;
+		memset(&header, 0, sizeof(MeshArchiveHeader));
+		header.magic = MESH_ARCHIVE_MAGIC;
+		header.version = MESH_ARCHIVE_VERSION;
+		header.chunk_count = (uint32_t)entries.size();
+		header.vertex_size = sizeof(PackedVertex);
+		header.index_offset = offset;
+		ok = write(entries.data(), entries.size() * sizeof(MeshArchiveEntry));
+		ok = ok && fseek(file, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(MeshArchiveHeader), 1, file) == 1;
+	}
+	ok = (fclose(file) == 0) && ok;
+	file = 0;
+
+	if (ok && !entries.empty())
+	{
+#ifdef _WIN32
+		ok = MoveFileExA(temp_path.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+		ok = rename(temp_path.c_str(), path.c_str()) == 0;
+#endif
+	}
+	if (!ok || entries.empty())
+		remove(temp_path.c_str());
+	return ok;
+}
+
+bool MeshArchiveWriter::write(const void* data, size_t size)
+{
+	if (failed)
+		return false;
+	if (size && fwrite(data, 1, size, file) != size)
+	{
+		failed = true;
+		return false;
+	}
+	offset += size;
+	return true;
+}
+
+bool MeshArchiveWriter::pad()
+{
+	static const char zeros[MESH_ARCHIVE_ALIGNMENT] = { 0 };
+	size_t padding = (size_t)((MESH_ARCHIVE_ALIGNMENT - offset % MESH_ARCHIVE_ALIGNMENT) % MESH_ARCHIVE_ALIGNMENT);
+	return write(zeros, padding);
+}
+
+MeshArchive::MeshArchive() : file(0), entries(0), chunk_count(0)
+{
+}
+
+MeshArchive::~MeshArchive()
+{
+	close();
+}
+
+bool MeshArchive::open(const std::string& path)
+{
+	close();
+	file = new MappedFile(path);
+	const char* data = file->data;
+	size_t size = file->size;
+	if (!data || size < sizeof(MeshArchiveHeader))
+	{
+		close();
+		return false;
+	}
+
+	MeshArchiveHeader header;
+	memcpy(&header, data, sizeof(MeshArchiveHeader));
+	uint64_t index_bytes = (uint64_t)header.chunk_count * sizeof(MeshArchiveEntry);
+	if (header.magic != MESH_ARCHIVE_MAGIC || header.version != MESH_ARCHIVE_VERSION || header.vertex_size != sizeof(PackedVertex) ||
+		header.index_offset % MESH_ARCHIVE_ALIGNMENT != 0 || header.index_offset > size || index_bytes > size - header.index_offset)
+	{
+		close();
+		return false;
+	}
+
+	// A corrupt entry must never send a reader outside the mapping
+	const MeshArchiveEntry* e = (const MeshArchiveEntry*)(data + header.index_offset);
+	for (uint32_t i = 0; i < header.chunk_count; i++)
+	{
+		bool valid = (e[i].index_size == 2 || e[i].index_size == 4) && e[i].payload_offset % MESH_ARCHIVE_ALIGNMENT == 0 &&
+			e[i].payload_offset <= header.index_offset && get_payload_size(e[i]) <= header.index_offset - e[i].payload_offset &&
+			(i == 0 || e[i - 1].morton_code < e[i].morton_code);
+		if (!valid)
+		{
+			close();
+			return false;
+		}
+	}
+
+	entries = e;
+	chunk_count = header.chunk_count;
+	return true;
+}
+
+void MeshArchive::close()
+{
+	delete file;
+	file = 0;
+	entries = 0;
+	chunk_count = 0;
+}
+
+const MeshArchiveEntry* MeshArchive::find(uint64_t morton_code) const
+{
+	const MeshArchiveEntry* end = entries + chunk_count;
+	const MeshArchiveEntry* it = std::lower_bound(entries, end, morton_code, [](const MeshArchiveEntry& e, uint64_t code) { return e.morton_code < code; });
+	return (it != end && it->morton_code == morton_code ? it : 0);
+}
+
+const PackedVertex* MeshArchive::get_vertices(const MeshArchiveEntry* e) const
+{
+	return (const PackedVertex*)(file->data + e->payload_offset);
+}
+
+const void* MeshArchive::get_indexes(const MeshArchiveEntry* e) const
+{
+	return file->data + e->payload_offset + (uint64_t)e->vertex_count * sizeof(PackedVertex);
+}
+
+bool MeshArchive::check_indexes(const MeshArchiveEntry* e) const
+{
+	// Open doesn't read the payloads, so this is the first time they're looked at
+	const void* indexes = get_indexes(e);
+	if (e->index_size == 4)
+	{
+		const uint32_t* long_indexes = (const uint32_t*)indexes;
+		for (uint32_t i = 0; i < e->index_count; i++)
+		{
+			if (long_indexes[i] >= e->vertex_count)
+				return false;
+		}
+	}
+	else
+	{
+		const uint16_t* short_indexes = (const uint16_t*)indexes;
+		for (uint32_t i = 0; i < e->index_count; i++)
+		{
+			if (short_indexes[i] >= e->vertex_count)
+				return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "PackedVertex.hpp"
+
+#define MESH_ARCHIVE_MAGIC 0x41464D42 // "BMFA"
+#define MESH_ARCHIVE_VERSION 1
+#define MESH_ARCHIVE_ALIGNMENT 16
+
+// Archive layout: this header, the chunk payloads, then the index of chunk_count entries sorted by
+// Morton code. Payloads start MESH_ARCHIVE_ALIGNMENT aligned: vertex_count PackedVertex, then
+// index_count indexes of index_size bytes. Everything is little endian, as written.
+struct MeshArchiveHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t chunk_count;
+	uint32_t vertex_size;	// sizeof(PackedVertex)
+	uint64_t index_offset;
+	uint64_t reserved;
+};
+
+struct MeshArchiveEntry
+{
+	uint64_t morton_code;
+	uint64_t params_key;	// Generator settings the mesh was built with, see MeshCache::make_params_key
+	uint64_t payload_offset;
+	float box_min[3];		// World space bounds of the vertices, positions are quantized to them
+	float box_max[3];
+	float overlap;
+	uint32_t level;
+	uint32_t vertex_count;
+	uint32_t index_count;
+	uint32_t index_size;	// 2 when every index fits, otherwise 4
+	uint32_t reserved;
+};
+
+// Writes an archive front to back, only the index is kept in memory until close. Written next
+// to the final path and renamed on close, so an archive that exists is complete.
+class MeshArchiveWriter
+{
+public:
+	MeshArchiveWriter();
+	~MeshArchiveWriter();
+
+	bool open(const std::string& path);
+	inline bool is_open() const { return file != 0; }
+	// Appends the chunk's mesh, keyed by its Morton code. Chunks without one get an entry
+	// without vertices, so they load as empty instead of being generated.
+	bool add(class DMCChunk* chunk);
+	// Keeps nothing if no chunk was added
+	bool close();
+
+	inline uint32_t get_chunk_count() const { return (uint32_t)entries.size(); }
+	inline uint64_t get_bytes() const { return offset; }
+
+private:
+	FILE* file;
+	std::string path;
+	std::string temp_path;
+	std::vector<MeshArchiveEntry> entries;
+	std::vector<PackedVertex> vertices;
+	std::vector<uint16_t> short_indexes;
+	uint64_t offset;
+	bool failed;
+
+	bool write(const void* data, size_t size);
+	bool pad();
+};
+
+// Read-only, memory mapped archive. Vertices and indexes are handed out as pointers into the
+// mapping, ready to be copied straight into an upload buffer. Safe to read from any thread.
+class MeshArchive
+{
+public:
+	MeshArchive();
+	~MeshArchive();
+
+	// Validates the header and every entry, false for anything that isn't a complete archive
+	bool open(const std::string& path);
+	void close();
+	inline bool is_open() const { return file != 0; }
+
+	inline uint32_t get_chunk_count() const { return chunk_count; }
+	inline const MeshArchiveEntry* get_entries() const { return entries; }
+	const MeshArchiveEntry* find(uint64_t morton_code) const;
+
+	// Valid while the archive is open. Indexes aren't checked against vertex_count, see check_indexes.
+	const PackedVertex* get_vertices(const MeshArchiveEntry* e) const;
+	const void* get_indexes(const MeshArchiveEntry* e) const;
+
+	// False for an entry with an index outside its vertices
+	bool check_indexes(const MeshArchiveEntry* e) const;
+
+private:
+	class MappedFile* file;
+	const MeshArchiveEntry* entries;
+	uint32_t chunk_count;
+};
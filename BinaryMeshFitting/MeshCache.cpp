@@ -0,0 +1,263 @@
+#include "PCH.h"
+#include "MeshCache.hpp"
+#include "DMCChunk.hpp"
+#include "MappedFile.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+static inline uint64_t fnv1a(uint64_t h, const void* data, size_t size)
+{
+	const uint8_t* p = (const uint8_t*)data;
+	for (size_t i = 0; i < size; i++)
+	{
+		h ^= p[i];
+		h *= 0x100000001B3ull;
+	}
+	return h;
+}
+
+template <class T>
+static inline uint64_t fnv1a(uint64_t h, const T& value)
+{
+	return fnv1a(h, &value, sizeof(T));
+}
+
+MeshCache::MeshCache() : enabled(false), stopping(false), hits(0), misses(0), writes(0), bytes_written(0), dropped_writes(0)
+{
+}
+
+MeshCache::~MeshCache()
+{
+	shutdown();
+}
+
+bool MeshCache::init(const std::string& _directory)
+{
+	shutdown();
+	directory = _directory;
+	if (directory.empty())
+		return false;
+	if (directory.back() != '/' && directory.back() != '\\')
+		directory += '/';
+
+#ifdef _WIN32
+	_mkdir(directory.c_str());
+#else
+	mkdir(directory.c_str(), 0755);
+#endif
+
+	stopping = false;
+	writer = std::thread(&MeshCache::writer_loop, this);
+	enabled = true;
+	return true;
+}
+
+void MeshCache::shutdown()
+{
+	if (!writer.joinable())
+		return;
+	enabled = false;
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		stopping = true;
+	}
+	_cv.notify_all();
+	writer.join();
+}
+
+uint64_t MeshCache::make_params_key(int resolution, int process_iters, int max_level, float base_overlap, bool boundary_processing, float world_size, uint32_t sampler_type, const NoiseSamplers::NoiseSamplerProperties& noise_properties)
+{
+	// Field by field so padding and the vtable pointer never end up in the key
+	uint64_t h = 0xCBF29CE484222325ull;
+	h = fnv1a(h, (uint32_t)MESH_CACHE_VERSION);
+	h = fnv1a(h, resolution);
+	h = fnv1a(h, process_iters);
+	h = fnv1a(h, max_level);
+	h = fnv1a(h, base_overlap);
+	h = fnv1a(h, (uint8_t)boundary_processing);
+	h = fnv1a(h, world_size);
+	h = fnv1a(h, sampler_type);
+	h = fnv1a(h, noise_properties.level);
+	h = fnv1a(h, noise_properties.g_scale);
+	h = fnv1a(h, noise_properties.height);
+	h = fnv1a(h, noise_properties.octaves);
+	h = fnv1a(h, noise_properties.amp);
+	h = fnv1a(h, noise_properties.frequency);
+	h = fnv1a(h, noise_properties.gain);
+	h = fnv1a(h, (int)noise_properties.noise_type);
+	h = fnv1a(h, (int)noise_properties.fractal_type);
+	return h;
+}
+
+std::string MeshCache::get_path(uint64_t params_key, uint64_t morton_code)
+{
+	char name[48];
+	snprintf(name, sizeof(name), "%016llx_%016llx.bmc", (unsigned long long)params_key, (unsigned long long)morton_code);
+	return directory + name;
+}
+
+bool MeshCache::load(uint64_t params_key, uint64_t morton_code, float overlap, DMCChunk* chunk, ResourceAllocator<VerticesIndicesBlock>* vi_allocator)
+{
+	if (!enabled)
+		return false;
+
+	MappedFile file(get_path(params_key, morton_code));
+	if (!file.data || file.size < sizeof(MeshCacheHeader))
+	{
+		misses++;
+		return false;
+	}
+
+	MeshCacheHeader header;
+	memcpy(&header, file.data, sizeof(MeshCacheHeader));
+	size_t v_bytes = (size_t)header.vertex_count * sizeof(glm::vec3);
+	size_t expected = sizeof(MeshCacheHeader) + v_bytes * 3 + (size_t)header.index_count * sizeof(uint32_t);
+	if (header.magic != MESH_CACHE_MAGIC || header.version != MESH_CACHE_VERSION || header.params_key != params_key ||
+		header.morton_code != morton_code || header.overlap != overlap || file.size != expected)
+	{
+		misses++;
+		return false;
+	}
+
+	chunk->set_bounds(overlap);
+	chunk->contains_mesh = header.contains_mesh != 0;
+	if (chunk->contains_mesh)
+	{
+		if (!chunk->vi)
+			chunk->vi = vi_allocator->new_element();
+		VerticesIndicesBlock* vi = chunk->vi;
+		vi->init();
+
+		DualVertexStore& verts = vi->vertices;
+		if (!verts.prepare(header.vertex_count) || !vi->mesh_indexes.prepare(header.index_count))
+		{
+			misses++;
+			return false;
+		}
+
+		const char* p = file.data + sizeof(MeshCacheHeader);
+		memcpy(verts.p, p, v_bytes);
+		p += v_bytes;
+		memcpy(verts.n, p, v_bytes);
+		p += v_bytes;
+		memcpy(verts.color, p, v_bytes);
+		p += v_bytes;
+		verts.clear_topology(0, header.vertex_count);
+		verts.count = header.vertex_count;
+		vi->mesh_indexes.push_back((const uint32_t*)p, header.index_count);
+	}
+
+	hits++;
+	return true;
+}
+
+void MeshCache::store(uint64_t params_key, uint64_t morton_code, float overlap, DMCChunk* chunk)
+{
+	if (!enabled)
+		return;
+
+	MeshCacheHeader header;
+	memset(&header, 0, sizeof(MeshCacheHeader));
+	header.magic = MESH_CACHE_MAGIC;
+	header.version = MESH_CACHE_VERSION;
+	header.params_key = params_key;
+	header.morton_code = morton_code;
+	header.overlap = overlap;
+	header.contains_mesh = (chunk->contains_mesh && chunk->vi ? 1 : 0);
+	if (header.contains_mesh)
+	{
+		header.vertex_count = (uint32_t)chunk->vi->vertices.count;
+		header.index_count = (uint32_t)chunk->vi->mesh_indexes.count;
+	}
+
+	WriteJob job;
+	job.path = get_path(params_key, morton_code);
+	size_t v_bytes = (size_t)header.vertex_count * sizeof(glm::vec3);
+	job.data.resize(sizeof(MeshCacheHeader) + v_bytes * 3 + (size_t)header.index_count * sizeof(uint32_t));
+	char* p = job.data.data();
+	memcpy(p, &header, sizeof(MeshCacheHeader));
+	p += sizeof(MeshCacheHeader);
+	if (header.contains_mesh)
+	{
+		DualVertexStore& verts = chunk->vi->vertices;
+		memcpy(p, verts.p, v_bytes);
+		p += v_bytes;
+		memcpy(p, verts.n, v_bytes);
+		p += v_bytes;
+		memcpy(p, verts.color, v_bytes);
+		p += v_bytes;
+		memcpy(p, chunk->vi->mesh_indexes.elements, (size_t)header.index_count * sizeof(uint32_t));
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		if (pending.size() >= MESH_CACHE_MAX_PENDING_WRITES)
+		{
+			dropped_writes++;
+			return;
+		}
+		pending.push_back(std::move(job));
+	}
+	_cv.notify_one();
+}
+
+MeshCacheStats MeshCache::stats()
+{
+	MeshCacheStats s;
+	s.hits = hits;
+	s.misses = misses;
+	s.writes = writes;
+	s.bytes_written = bytes_written;
+	s.dropped_writes = dropped_writes;
+	return s;
+}
+
+void MeshCache::writer_loop()
+{
+	for (;;)
+	{
+		WriteJob job;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_cv.wait(lock, [this] { return stopping || !pending.empty(); });
+			// Drain the queue before stopping so nothing generated is lost
+			if (pending.empty())
+				return;
+			job = std::move(pending.front());
+			pending.pop_front();
+		}
+
+		// Write next to the target and rename, so a reader never maps a partial file
+		std::string temp_path = job.path + ".tmp";
+		FILE* f = fopen(temp_path.c_str(), "wb");
+		if (!f)
+			continue;
+		bool ok = fwrite(job.data.data(), 1, job.data.size(), f) == job.data.size();
+		ok = (fclose(f) == 0) && ok;
+		if (ok)
+		{
+#ifdef _WIN32
+			ok = MoveFileExA(temp_path.c_str(), job.path.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+			ok = rename(temp_path.c_str(), job.path.c_str()) == 0;
+#endif
+		}
+		if (!ok)
+		{
+			remove(temp_path.c_str());
+			continue;
+		}
+		writes++;
+		bytes_written += job.data.size();
+	}
+}
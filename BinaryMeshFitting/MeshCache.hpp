@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include "ResourceAllocator.hpp"
+#include "ChunkBlocks.hpp"
+#include "NoiseSampler.hpp"
+
+#define MESH_CACHE_MAGIC 0x43464D42 // "BMFC"
+#define MESH_CACHE_VERSION 1
+#define MESH_CACHE_MAX_PENDING_WRITES 512
+
+// One file per chunk: the header, then vertex_count positions, normals and colors
+// (3 floats each) and index_count indexes.
+struct MeshCacheHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t params_key;
+	uint64_t morton_code;
+	float overlap;
+	uint32_t contains_mesh;
+	uint32_t vertex_count;
+	uint32_t index_count;
+};
+
+struct MeshCacheStats
+{
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t writes;
+	uint64_t bytes_written;
+	uint64_t dropped_writes;
+};
+
+// Disk cache of finished chunk meshes, keyed by Morton code plus a hash of everything
+// that changes what the generator outputs for it. Reads map the file and copy straight
+// into the chunk's VerticesIndicesBlock; writes are serialized by the caller and handed
+// to a background thread. The cache is best effort, any failure is treated as a miss.
+class MeshCache
+{
+public:
+	MeshCache();
+	~MeshCache();
+
+	bool init(const std::string& directory);
+	void shutdown();
+	inline bool is_enabled() const { return enabled; }
+
+	static uint64_t make_params_key(int resolution, int process_iters, int max_level, float base_overlap, bool boundary_processing, float world_size, uint32_t sampler_type, const NoiseSamplers::NoiseSamplerProperties& noise_properties);
+
+	// On a hit, sets up chunk->vi (allocated from vi_allocator), contains_mesh and the chunk bounds
+	bool load(uint64_t params_key, uint64_t morton_code, float overlap, class DMCChunk* chunk, ResourceAllocator<VerticesIndicesBlock>* vi_allocator);
+	void store(uint64_t params_key, uint64_t morton_code, float overlap, class DMCChunk* chunk);
+
+	MeshCacheStats stats();
+
+private:
+	struct WriteJob
+	{
+		std::string path;
+		std::vector<char> data;
+	};
+
+	bool enabled;
+	std::string directory;
+
+	std::thread writer;
+	std::mutex _mutex;
+	std::condition_variable _cv;
+	std::deque<WriteJob> pending;
+	bool stopping;
+
+	std::atomic<uint64_t> hits;
+	std::atomic<uint64_t> misses;
+	std::atomic<uint64_t> writes;
+	std::atomic<uint64_t> bytes_written;
+	std::atomic<uint64_t> dropped_writes;
+
+	std::string get_path(uint64_t params_key, uint64_t morton_code);
+	void writer_loop();
+};
@@ -0,0 +1,132 @@
+#include "PCH.h"
+#include "MeshLRU.hpp"
+#include "DMCChunk.hpp"
+
+MeshLRU::MeshLRU() : max_bytes(0), bytes(0), vi_allocator(0), hits(0), misses(0), inserts(0), evictions(0)
+{
+}
+
+MeshLRU::~MeshLRU()
+{
+	clear();
+}
+
+void MeshLRU::init(size_t _max_bytes, ResourceAllocator<VerticesIndicesBlock>* _vi_allocator)
+{
+	clear();
+	std::unique_lock<std::mutex> lock(_mutex);
+	max_bytes = _max_bytes;
+	vi_allocator = _vi_allocator;
+}
+
+void MeshLRU::put(uint64_t params_key, uint64_t morton_code, float overlap, bool contains_mesh, VerticesIndicesBlock* vi)
+{
+	if (!max_bytes)
+	{
+		if (vi && vi_allocator)
+			vi_allocator->free_element(vi);
+		return;
+	}
+
+	Entry e;
+	e.key.params_key = params_key;
+	e.key.morton_code = morton_code;
+	e.overlap = overlap;
+	e.contains_mesh = contains_mesh;
+	e.vi = vi;
+	e.bytes = sizeof(Entry);
+	if (vi)
+		e.bytes += vi->vertices.bytes() + vi->mesh_indexes.size * sizeof(uint32_t);
+
+	std::unique_lock<std::mutex> lock(_mutex);
+	auto search = lookup.find(e.key);
+	if (search != lookup.end())
+		erase(search->second);
+
+	entries.push_front(e);
+	lookup[e.key] = entries.begin();
+	bytes += e.bytes;
+	inserts++;
+
+	while (bytes > max_bytes && !entries.empty())
+	{
+		erase(std::prev(entries.end()));
+		evictions++;
+	}
+}
+
+bool MeshLRU::contains(uint64_t params_key, uint64_t morton_code, float overlap)
+{
+	if (!max_bytes)
+		return false;
+
+	Key key;
+	key.params_key = params_key;
+	key.morton_code = morton_code;
+
+	std::unique_lock<std::mutex> lock(_mutex);
+	auto search = lookup.find(key);
+	return search != lookup.end() && search->second->overlap == overlap;
+}
+
+bool MeshLRU::take(uint64_t params_key, uint64_t morton_code, float overlap, DMCChunk* chunk)
+{
+	if (!max_bytes)
+		return false;
+
+	Key key;
+	key.params_key = params_key;
+	key.morton_code = morton_code;
+
+	Entry e;
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		auto search = lookup.find(key);
+		if (search == lookup.end() || search->second->overlap != overlap)
+		{
+			misses++;
+			return false;
+		}
+		e = *search->second;
+		bytes -= e.bytes;
+		entries.erase(search->second);
+		lookup.erase(search);
+		hits++;
+	}
+
+	if (chunk->vi && vi_allocator)
+		vi_allocator->free_element(chunk->vi);
+	chunk->vi = e.vi;
+	chunk->contains_mesh = e.contains_mesh;
+	chunk->set_bounds(overlap);
+	return true;
+}
+
+void MeshLRU::clear()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	while (!entries.empty())
+		erase(entries.begin());
+}
+
+MeshLRUStats MeshLRU::stats()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	MeshLRUStats s;
+	s.hits = hits;
+	s.misses = misses;
+	s.inserts = inserts;
+	s.evictions = evictions;
+	s.entries = entries.size();
+	s.bytes = bytes;
+	return s;
+}
+
+void MeshLRU::erase(std::list<Entry>::iterator it)
+{
+	if (it->vi && vi_allocator)
+		vi_allocator->free_element(it->vi);
+	bytes -= it->bytes;
+	lookup.erase(it->key);
+	entries.erase(it);
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include "ResourceAllocator.hpp"
+#include "ChunkBlocks.hpp"
+
+struct MeshLRUStats
+{
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t inserts;
+	uint64_t evictions;
+	size_t entries;
+	size_t bytes;
+};
+
+// Keeps the meshes of chunks that were recently retired (uploaded and released, or
+// grouped away) so splitting back into the same area can reuse them instead of sampling
+// again. Bounded by bytes; the least recently retired entries are freed first.
+// Entries are keyed like the disk cache, by Morton code and generator params key.
+class MeshLRU
+{
+public:
+	MeshLRU();
+	~MeshLRU();
+
+	void init(size_t max_bytes, ResourceAllocator<VerticesIndicesBlock>* vi_allocator);
+	inline bool is_enabled() const { return max_bytes > 0; }
+
+	// Takes ownership of vi, which is 0 for chunks without a mesh
+	void put(uint64_t params_key, uint64_t morton_code, float overlap, bool contains_mesh, VerticesIndicesBlock* vi);
+	// On a hit, moves the entry into the chunk (vi, contains_mesh and bounds)
+	bool take(uint64_t params_key, uint64_t morton_code, float overlap, class DMCChunk* chunk);
+	// Whether take would hit, without counting towards the stats
+	bool contains(uint64_t params_key, uint64_t morton_code, float overlap);
+	void clear();
+
+	MeshLRUStats stats();
+
+private:
+	struct Key
+	{
+		uint64_t params_key;
+		uint64_t morton_code;
+
+		inline bool operator==(const Key& other) const { return params_key == other.params_key && morton_code == other.morton_code; }
+	};
+
+	struct KeyHash
+	{
+		inline size_t operator()(const Key& k) const { return (size_t)(k.morton_code * 0x9E3779B97F4A7C15ull ^ k.params_key); }
+	};
+
+	struct Entry
+	{
+		Key key;
+		float overlap;
+		bool contains_mesh;
+		VerticesIndicesBlock* vi;
+		size_t bytes;
+	};
+
+	std::mutex _mutex;
+	size_t max_bytes;
+	size_t bytes;
+	ResourceAllocator<VerticesIndicesBlock>* vi_allocator;
+	std::list<Entry> entries;	// Most recent first
+	std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> lookup;
+
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t inserts;
+	uint64_t evictions;
+
+	void erase(std::list<Entry>::iterator it);
+};
@@ -23,20 +23,26 @@ Processing::MeshProcessor<N>::~MeshProcessor()
 }
 
 template<int N>
-bool Processing::MeshProcessor<N>::init(SmartContainer<DualVertex>& vertices, SmartContainer<uint32_t>& inds, Sampler& sampler)
+bool Processing::MeshProcessor<N>::init(DualVertexStore& vertices, SmartContainer<uint32_t>& inds, Sampler& sampler)
 {
 	if (vertices.count == 0 || inds.count < N)
 		return true;
 	this->sampler = sampler;
 
+	this->vertices.count = 0;
+	if (!this->vertices.push_back(vertices))
+		return false;
+
 	uint32_t a_count = 0;
-	uint32_t count = vertices.count;
+	uint32_t count = (uint32_t)this->vertices.count;
+	uint32_t* adj_offset = this->vertices.adj_offset;
+	uint8_t* adj_next = this->vertices.adj_next;
+	uint8_t* init_valence = this->vertices.init_valence;
 	for (uint32_t i = 0; i < count; i++)
 	{
-		vertices[i].adj_offset = a_count;
-		vertices[i].adj_next = 0;
-		vertices[i].valence = vertices[i].init_valence;
-		a_count += vertices[i].init_valence;
+		adj_offset[i] = a_count;
+		adj_next[i] = 0;
+		a_count += init_valence[i];
 	}
 	if (!a_count)
 		return false;
@@ -46,7 +52,6 @@ bool Processing::MeshProcessor<N>::init(SmartContainer<DualVertex>& vertices, Sm
 	if (!adj_block.elements)
 		return false;
 
-	this->vertices.push_back(vertices);
 	prims = (Primitive<N>*)malloc(inds.count / N * sizeof(Primitive<N>));
 	prim_count = inds.count / N;
 	init_primitives(inds);
@@ -54,11 +59,32 @@ bool Processing::MeshProcessor<N>::init(SmartContainer<DualVertex>& vertices, Sm
 	return true;
 }
 
+template<int N>
+bool Processing::MeshProcessor<N>::init(SmartContainer<DualVertex>& vertices, SmartContainer<uint32_t>& inds, Sampler& sampler)
+{
+	DualVertexStore store;
+	if (!store.push_back(vertices))
+		return false;
+	return init(store, inds, sampler);
+}
+
 template <int N>
-void Processing::MeshProcessor<N>::flush(SmartContainer<DualVertex>& v_out, SmartContainer<uint32_t>& inds)
+void Processing::MeshProcessor<N>::flush(DualVertexStore& v_out, SmartContainer<uint32_t>& inds)
 {
 	v_out.push_back(vertices);
+	flush_prims(inds);
+}
 
+template <int N>
+void Processing::MeshProcessor<N>::flush(SmartContainer<DualVertex>& v_out, SmartContainer<uint32_t>& inds)
+{
+	vertices.copy_to(v_out);
+	flush_prims(inds);
+}
+
+template <int N>
+void Processing::MeshProcessor<N>::flush_prims(SmartContainer<uint32_t>& inds)
+{
 	for (uint32_t i = 0; i < prim_count; i++)
 	{
 		Primitive<N>& t = prims[i];
@@ -73,7 +99,7 @@ void Processing::MeshProcessor<N>::flush(SmartContainer<DualVertex>& v_out, Smar
 template<int N>
 void Processing::MeshProcessor<N>::flush_to_tris(SmartContainer<DualVertex>& v_out, SmartContainer<uint32_t>& inds)
 {
-	v_out.push_back(vertices);
+	vertices.copy_to(v_out);
 
 	for (uint32_t i = 0; i < prim_count; i++)
 	{
@@ -121,7 +147,7 @@ void Processing::MeshProcessor<N>::init_primitives(SmartContainer<uint32_t>& ind
 		//adj_block[vs[0]->adj_offset + vs[0]->adj_next++] = i;
 		//adj_block[vs[1]->adj_offset + vs[1]->adj_next++] = i;
 		//adj_block[vs[2]->adj_offset + vs[2]->adj_next++] = i;
-		set_adj adj_op(&adj_block, t.v, vertices.elements, i, &t.boundary);
+		set_adj adj_op(&adj_block, t.v, &vertices, i, &t.boundary);
 		recursive_unroll<set_adj, N>::result(adj_op);
 		adj_block.count += N;
 	}
@@ -146,14 +172,14 @@ void Processing::MeshProcessor<N>::optimize_dual_grid(int iterations, bool proce
 				continue;
 
 			//float weight = (vertices[t.v[0]].s + vertices[t.v[1]].s + vertices[t.v[2]].s) / 3.0f;
-			average_vertex avg_op(t.v, vertices.elements);
+			average_vertex avg_op(t.v, vertices.p);
 			recursive_unroll<average_vertex, N>::result(avg_op);
 			t.dual_p = avg_op.p / (float)N;
 
-			average_color avg_opc(t.v, vertices.elements);
+			average_color avg_opc(t.v, vertices.color);
 			recursive_unroll<average_color, N>::result(avg_opc);
 			t.dual_c = avg_opc.c / (float)N;
-			//t.dual_p = (vertices[t.v[0]].p + vertices[t.v[1]].p + vertices[t.v[2]].p) / 3.0f;
+			//t.dual_p = (vertices.p[t.v[0]] + vertices.p[t.v[1]] + vertices.p[t.v[2]]) / 3.0f;
 			//t.dual_n = (vertices[t.v[0]].n + vertices[t.v[1]].n + vertices[t.v[2]].n) / 3.0f;
 
 			if (smooth_normals)
@@ -165,20 +191,20 @@ void Processing::MeshProcessor<N>::optimize_dual_grid(int iterations, bool proce
 						vec3 a, b;
 						if (t.v[0] != t.v[1] && t.v[1] != t.v[2] && t.v[0] != t.v[2])
 						{
-							a = vertices[t.v[0]].p - vertices[t.v[1]].p;
-							b = vertices[t.v[0]].p - vertices[t.v[2]].p;
+							a = vertices.p[t.v[0]] - vertices.p[t.v[1]];
+							b = vertices.p[t.v[0]] - vertices.p[t.v[2]];
 						}
 						else if (N == 4)
 						{
 							if (t.v[0] != t.v[1] && t.v[1] != t.v[3] && t.v[0] != t.v[3])
 							{
-								a = vertices[t.v[0]].p - vertices[t.v[1]].p;
-								b = vertices[t.v[0]].p - vertices[t.v[3]].p;
+								a = vertices.p[t.v[0]] - vertices.p[t.v[1]];
+								b = vertices.p[t.v[0]] - vertices.p[t.v[3]];
 							}
 							else if (t.v[0] != t.v[2] && t.v[2] != t.v[3] && t.v[0] != t.v[3])
 							{
-								a = vertices[t.v[0]].p - vertices[t.v[2]].p;
-								b = vertices[t.v[0]].p - vertices[t.v[3]].p;
+								a = vertices.p[t.v[0]] - vertices.p[t.v[2]];
+								b = vertices.p[t.v[0]] - vertices.p[t.v[3]];
 							}
 						}
 						t.dual_n = -cross(normalize(a), normalize(b));
@@ -187,11 +213,11 @@ void Processing::MeshProcessor<N>::optimize_dual_grid(int iterations, bool proce
 					{
 						vec3 n1, n2;
 						vec3 a, b;
-						a = vertices[t.v[0]].p - vertices[t.v[1]].p;
-						b = vertices[t.v[0]].p - vertices[t.v[2]].p;
+						a = vertices.p[t.v[0]] - vertices.p[t.v[1]];
+						b = vertices.p[t.v[0]] - vertices.p[t.v[2]];
 						n1 = cross(normalize(a), normalize(b));
-						a = vertices[t.v[2]].p - vertices[t.v[3]].p;
-						b = vertices[t.v[2]].p - vertices[t.v[0]].p;
+						a = vertices.p[t.v[2]] - vertices.p[t.v[3]];
+						b = vertices.p[t.v[2]] - vertices.p[t.v[0]];
 						n2 = cross(normalize(a), normalize(b));
 
 						if (isnan(n1.x))
@@ -208,7 +234,7 @@ void Processing::MeshProcessor<N>::optimize_dual_grid(int iterations, bool proce
 				}
 				else
 				{
-					average_normal avg_opn(t.v, vertices.elements);
+					average_normal avg_opn(t.v, vertices.n);
 					recursive_unroll<average_normal, N>::result(avg_opn);
 					t.dual_n = avg_opn.n;
 					//t.s = weight;
@@ -239,20 +265,26 @@ template <int N>
 void Processing::MeshProcessor<N>::optimize_primal_grid(bool qef, bool set_colors, bool process_boundary)
 {
 	int v_count = (int)vertices.count;
+	const uint8_t* adj_next = vertices.adj_next;
+	const uint8_t* boundary = vertices.boundary;
+	const uint32_t* adj_offset = vertices.adj_offset;
+	vec3* v_p = vertices.p;
+	vec3* v_n = vertices.n;
+	vec3* v_c = vertices.color;
+	float* v_s = vertices.s;
 	int i;
 #pragma omp parallel for
 	for (i = 0; i < v_count; i++)
 	{
-		DualVertex& v = vertices[i];
-		if (v.adj_next == 0 || (!process_boundary && v.boundary))
+		if (adj_next[i] == 0 || (!process_boundary && boundary[i]))
 			continue;
 		vec3 p(0, 0, 0);
 		vec3 n(0, 0, 0);
 		vec3 c(0, 0, 0);
 		float s = 0;
-		uint32_t* adj = adj_block.elements + v.adj_offset;
+		uint32_t* adj = adj_block.elements + adj_offset[i];
 		int count = 0;
-		for (int k = 0; k < v.adj_next; k++)
+		for (int k = 0; k < adj_next[i]; k++)
 		{
 			if (*adj == (uint32_t)(-1))
 			{
@@ -280,11 +312,11 @@ void Processing::MeshProcessor<N>::optimize_primal_grid(bool qef, bool set_color
 
 		if (set_colors)
 			n = normalize(n);
-		v.s = s;
-		v.p = p;
-		v.color = c;
+		v_s[i] = s;
+		v_p[i] = p;
+		v_c[i] = c;
 		if (n.y != 0)
-			v.n = n;
+			v_n[i] = n;
 
 		/*if (set_colors)
 		{
@@ -321,16 +353,17 @@ void Processing::MeshProcessor<N>::collapse_bad_quads()
 		int next = 0;
 		for (int k = 0; k < 4; k++)
 		{
-			DualVertex& dv = vertices[p.v[k]];
-			if (dv.adj_next == 3)
+			uint32_t dv = p.v[k];
+			if (vertices.adj_next[dv] == 3)
 			{
+				uint32_t adj_offset = vertices.adj_offset[dv];
 				pair[next++] = k;
-				if (adj_block[dv.adj_offset + 0] != -1 && adj_block[dv.adj_offset + 0] != i)
-					p_out[next_p++] = adj_block[dv.adj_offset + 0];
-				if (adj_block[dv.adj_offset + 1] != -1 && adj_block[dv.adj_offset + 1] != i)
-					p_out[next_p++] = adj_block[dv.adj_offset + 1];
-				if (adj_block[dv.adj_offset + 2] != -1 && adj_block[dv.adj_offset + 2] != i)
-					p_out[next_p++] = adj_block[dv.adj_offset + 2];
+				if (adj_block[adj_offset + 0] != -1 && adj_block[adj_offset + 0] != i)
+					p_out[next_p++] = adj_block[adj_offset + 0];
+				if (adj_block[adj_offset + 1] != -1 && adj_block[adj_offset + 1] != i)
+					p_out[next_p++] = adj_block[adj_offset + 1];
+				if (adj_block[adj_offset + 2] != -1 && adj_block[adj_offset + 2] != i)
+					p_out[next_p++] = adj_block[adj_offset + 2];
 				//if (next == 2)
 				//	break;
 			}
@@ -356,14 +389,14 @@ void Processing::MeshProcessor<N>::collapse_bad_quads()
 
 		vec3 new_p(0, 0, 0);
 		uint32_t new_index = p.v[pair[0]];
-		int old_adj = vertices[new_index].adj_next;
+		int old_adj = vertices.adj_next[new_index];
 		for (int k = 0; k < 4; k++)
 		{
-			new_p += vertices[p.v[k]].p;
+			new_p += vertices.p[p.v[k]];
 		}
 		new_p *= 0.25f;
-		vertices[new_index].p = new_p;
-		vertices[new_index].adj_next = 4;
+		vertices.p[new_index] = new_p;
+		vertices.adj_next[new_index] = 4;
 
 		uint32_t p_other = p.v[pair[1]];
 
@@ -382,7 +415,7 @@ void Processing::MeshProcessor<N>::collapse_bad_quads()
 			}
 		}
 
-		vertices[new_index].adj_offset = adj_block.count;
+		vertices.adj_offset[new_index] = (uint32_t)adj_block.count;
 		for (int k = 0; k < 4; k++)
 		{
 			adj_block.push_back(p_out[k]);
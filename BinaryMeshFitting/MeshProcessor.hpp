@@ -57,7 +57,7 @@ namespace Processing
 	{
 		uint32_t prim_count;
 		Sampler sampler;
-		SmartContainer<DualVertex> vertices;
+		DualVertexStore vertices;
 		SmartContainer<uint32_t> adj_block;
 		Primitive<N>* prims;
 		bool smooth_normals;
@@ -65,11 +65,14 @@ namespace Processing
 	public:
 		MeshProcessor(bool simple_quality, bool smooth_normals);
 		~MeshProcessor();
+		bool init(DualVertexStore& vertices, SmartContainer<uint32_t>& inds, Sampler& sampler);
 		bool init(SmartContainer<DualVertex>& vertices, SmartContainer<uint32_t>& inds, Sampler& sampler);
+		void flush(DualVertexStore& v_out, SmartContainer<uint32_t>& inds);
 		void flush(SmartContainer<DualVertex>& v_out, SmartContainer<uint32_t>& inds);
 		void flush_to_tris(SmartContainer<DualVertex>& v_out, SmartContainer<uint32_t>& inds);
 		void flush(SmartContainer<glm::vec3>& v_pos, SmartContainer <glm::vec3>& v_norm, SmartContainer<uint32_t>& inds);
 		void init_primitives(SmartContainer<uint32_t>& inds);
+		void flush_prims(SmartContainer<uint32_t>& inds);
 		void optimize_dual_grid(int iterations, bool process_boundary = true);
 		void optimize_primal_grid(bool qef, bool set_colors, bool process_boundary = true);
 
@@ -22,13 +22,13 @@ struct average_vertex
 {
 	glm::vec3 p;
 	uint32_t* inds;
-	DualVertex* verts;
+	glm::vec3* values;
 
-	inline average_vertex(uint32_t* v_inds, DualVertex* vertices) : inds(v_inds), verts(vertices), p(0, 0, 0) {}
+	inline average_vertex(uint32_t* v_inds, glm::vec3* _values) : inds(v_inds), values(_values), p(0, 0, 0) {}
 
 	__forceinline void operator()()
 	{
-		p += verts[*(inds++)].p;
+		p += values[*(inds++)];
 	}
 };
 
@@ -36,13 +36,13 @@ struct average_normal
 {
 	glm::vec3 n;
 	uint32_t* inds;
-	DualVertex* verts;
+	glm::vec3* values;
 
-	inline average_normal(uint32_t* v_inds, DualVertex* vertices) : inds(v_inds), verts(vertices), n(0, 0, 0) {}
+	inline average_normal(uint32_t* v_inds, glm::vec3* _values) : inds(v_inds), values(_values), n(0, 0, 0) {}
 
 	__forceinline void operator()()
 	{
-		n += verts[*(inds++)].n;
+		n += values[*(inds++)];
 	}
 };
 
@@ -50,13 +50,13 @@ struct average_color
 {
 	glm::vec3 c;
 	uint32_t* inds;
-	DualVertex* verts;
+	glm::vec3* values;
 
-	inline average_color(uint32_t* v_inds, DualVertex* vertices) : inds(v_inds), verts(vertices), c(0, 0, 0) {}
+	inline average_color(uint32_t* v_inds, glm::vec3* _values) : inds(v_inds), values(_values), c(0, 0, 0) {}
 
 	__forceinline void operator()()
 	{
-		c += verts[*(inds++)].color;
+		c += values[*(inds++)];
 	}
 };
 
@@ -77,16 +77,16 @@ struct set_adj
 {
 	SmartContainer<uint32_t>* adj;
 	uint32_t* inds;
-	DualVertex* verts;
+	DualVertexStore* verts;
 	uint32_t p_index;
 	bool* boundary;
 
-	inline set_adj(SmartContainer<uint32_t>* adj_block, uint32_t* p_inds, DualVertex* vertices, uint32_t prim_index, bool* _boundary) : adj(adj_block), inds(p_inds), verts(vertices), p_index(prim_index), boundary(_boundary) {}
+	inline set_adj(SmartContainer<uint32_t>* adj_block, uint32_t* p_inds, DualVertexStore* vertices, uint32_t prim_index, bool* _boundary) : adj(adj_block), inds(p_inds), verts(vertices), p_index(prim_index), boundary(_boundary) {}
 
 	__forceinline void operator()()
 	{
-		(*adj)[verts[*inds].adj_offset + verts[*inds].adj_next++] = p_index;
-		if (verts[*inds].boundary)
+		(*adj)[verts->adj_offset[*inds] + verts->adj_next[*inds]++] = p_index;
+		if (verts->boundary[*inds])
 			*boundary = true;
 		inds++;
 	}
@@ -0,0 +1,178 @@
+#include "PCH.h"
+#include "MeshTiles.hpp"
+#include "DMCChunk.hpp"
+
+#include <cstdio>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+static std::string get_tile_path(const std::string& directory, uint64_t tile_code)
+{
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.bma", (unsigned long long)tile_code);
+	return directory + name;
+}
+
+static std::string with_separator(const std::string& directory)
+{
+	if (!directory.empty() && directory.back() != '/' && directory.back() != '\\')
+		return directory + '/';
+	return directory;
+}
+
+MeshTileWriter::MeshTileWriter() : tiles_written(0), chunks_written(0), bytes_written(0), tile_code(0)
+{
+}
+
+MeshTileWriter::~MeshTileWriter()
+{
+	close();
+}
+
+bool MeshTileWriter::init(const std::string& _directory)
+{
+	close();
+	directory = with_separator(_directory);
+	if (directory.empty())
+		return false;
+
+#ifdef _WIN32
+	_mkdir(directory.c_str());
+#else
+	mkdir(directory.c_str(), 0755);
+#endif
+	return true;
+}
+
+std::string MeshTileWriter::get_path(uint64_t code) const
+{
+	return get_tile_path(directory, code);
+}
+
+bool MeshTileWriter::open(uint64_t code)
+{
+	close();
+	tile_code = code;
+	return archive.open(get_path(code));
+}
+
+bool MeshTileWriter::add(DMCChunk* chunk)
+{
+	return archive.add(chunk);
+}
+
+bool MeshTileWriter::close()
+{
+	if (!archive.is_open())
+		return true;
+
+	uint32_t chunks = archive.get_chunk_count();
+	uint64_t bytes = archive.get_bytes();
+	if (!archive.close())
+		return false;
+	if (chunks)
+	{
+		tiles_written++;
+		chunks_written += chunks;
+		bytes_written += bytes;
+	}
+	return true;
+}
+
+MeshTileReader::MeshTileReader() : enabled(false), hits(0), misses(0)
+{
+}
+
+MeshTileReader::~MeshTileReader()
+{
+}
+
+bool MeshTileReader::init(const std::string& _directory)
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	tiles.clear();
+	missing.clear();
+	directory = with_separator(_directory);
+	enabled = !directory.empty();
+	return enabled;
+}
+
+const MeshArchive* MeshTileReader::get_tile(uint64_t tile_code)
+{
+	auto search = tiles.find(tile_code);
+	if (search != tiles.end())
+		return search->second.get();
+	if (missing.count(tile_code))
+		return 0;
+
+	std::unique_ptr<MeshArchive> archive(new MeshArchive());
+	if (!archive->open(get_tile_path(directory, tile_code)))
+	{
+		// Every ancestor of every chunk is probed, so the codes without a file are only remembered
+		// for a while. Looking one up again costs a failed open.
+		if (missing.size() >= MESH_TILES_MAX_MISSING)
+			missing.clear();
+		missing.insert(tile_code);
+		return 0;
+	}
+	const MeshArchive* result = archive.get();
+	tiles[tile_code] = std::move(archive);
+	return result;
+}
+
+bool MeshTileReader::load(uint64_t params_key, uint64_t morton_code, float overlap, DMCChunk* chunk)
+{
+	if (!enabled)
+		return false;
+
+	// Archives are never closed while the reader lives, entries can be read after the lock
+	const MeshArchive* archive = 0;
+	const MeshArchiveEntry* e = 0;
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		for (uint64_t code = morton_code; code && !e; code >>= 3)
+		{
+			archive = get_tile(code);
+			e = (archive ? archive->find(morton_code) : 0);
+		}
+		if (!e || e->params_key != params_key || e->overlap != overlap)
+		{
+			misses++;
+			return false;
+		}
+	}
+	bool valid = archive->check_indexes(e);
+
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		if (valid)
+			hits++;
+		else
+			misses++;
+	}
+	if (!valid)
+		return false;
+
+	chunk->set_bounds(e->overlap);
+	chunk->contains_mesh = (e->vertex_count > 0);
+	if (chunk->contains_mesh)
+	{
+		chunk->baked_archive = archive;
+		chunk->baked_entry = e;
+	}
+	return true;
+}
+
+MeshTileReaderStats MeshTileReader::stats()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	MeshTileReaderStats s;
+	s.hits = hits;
+	s.misses = misses;
+	s.open_tiles = tiles.size();
+	return s;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <mutex>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include "MeshArchive.hpp"
+
+#define MESH_TILES_MAX_MISSING 4096
+
+// A directory of baked tiles (see WorldBaker), each a MeshArchive named after its Morton code. A tile
+// holds the meshes of every chunk below one octree node, or of a single chunk coarser than that.
+
+// Streams chunks into one tile at a time, without keeping them in memory
+class MeshTileWriter
+{
+public:
+	MeshTileWriter();
+	~MeshTileWriter();
+
+	bool init(const std::string& directory);
+	std::string get_path(uint64_t tile_code) const;
+	inline bool is_open() const { return archive.is_open(); }
+	inline uint64_t get_tile_code() const { return tile_code; }
+
+	bool open(uint64_t tile_code);
+	// Appends the chunk's mesh, or an empty entry for a chunk without one
+	bool add(class DMCChunk* chunk);
+	// Tiles nothing was added to aren't kept. Chunks found in no tile are generated as usual.
+	bool close();
+
+	uint64_t tiles_written;
+	uint64_t chunks_written;
+	uint64_t bytes_written;
+
+private:
+	std::string directory;
+	MeshArchiveWriter archive;
+	uint64_t tile_code;
+};
+
+struct MeshTileReaderStats
+{
+	uint64_t hits;
+	uint64_t misses;
+	size_t open_tiles;
+};
+
+// Finds chunk meshes in a tile directory. The tile of a chunk is the closest of its ancestors (or
+// itself) with a file, which is looked for once and then stays mapped; the baked tile level
+// doesn't need to be known. Shared between threads.
+class MeshTileReader
+{
+public:
+	MeshTileReader();
+	~MeshTileReader();
+
+	bool init(const std::string& directory);
+	inline bool is_enabled() const { return enabled; }
+
+	// On a hit, sets contains_mesh and the chunk bounds, and points chunk->baked_entry at the mesh
+	// so it's uploaded straight from the mapping. chunk->vi is left alone.
+	bool load(uint64_t params_key, uint64_t morton_code, float overlap, class DMCChunk* chunk);
+
+	MeshTileReaderStats stats();
+
+private:
+	bool enabled;
+	std::string directory;
+	std::mutex _mutex;
+	std::unordered_map<uint64_t, std::unique_ptr<MeshArchive>> tiles;
+	std::unordered_set<uint64_t> missing;	// Codes without a file, forgotten every MESH_TILES_MAX_MISSING
+	uint64_t hits;
+	uint64_t misses;
+
+	const MeshArchive* get_tile(uint64_t tile_code);
+};
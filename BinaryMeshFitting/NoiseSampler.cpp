@@ -1,18 +1,18 @@
 #include "PCH.h"
 #include "NoiseSampler.hpp"
+#include "JobSystem.hpp"
 
 #define SET_OUT(_off, _val) \
 char* f_out = ((char*)((*out))) + offset + (_off) * stride; \
 *((float*)f_out) = (_val); \
 
-void NOISE_BLOCK(uint32_t size_x, uint32_t size_y, uint32_t size_z, float p_x, float p_y, float p_z, float scale, float** out, FastNoiseVectorSet* vectorset_out)
+void NOISE_BLOCK(uint32_t size_x, uint32_t size_y, uint32_t size_z, float p_x, float p_y, float p_z, float scale, float** out, NoiseVectorSet* vectorset_out)
 {
 	if (!out)
 		return;
 	//if (!(*out))
 	//	*out = FastNoiseSIMD::GetEmptySet(size_x, size_y, size_z);
-	//if (vectorset_out->sampleSizeX != size_x || vectorset_out->sampleSizeY != size_y || vectorset_out->sampleSizeZ != size_z)
-	//	vectorset_out->SetSize(size_x * size_y * size_z);
+	vectorset_out->prepare((int)(size_x * size_y * size_z));
 	vectorset_out->sampleScale = 0;
 	int index = 0;
 	float dx, dy, dz;
@@ -34,13 +34,13 @@ void NOISE_BLOCK(uint32_t size_x, uint32_t size_y, uint32_t size_z, float p_x, f
 	}
 }
 
-void NOISE_BLOCK_OFFSET_XZ(uint32_t size_x, uint32_t size_y, uint32_t size_z, float p_x, float p_y, float p_z, float scale, float** out, FastNoiseVectorSet* vectorset_out, float* off_x, float* off_z, float off_x_scale, float off_z_scale)
+void NOISE_BLOCK_OFFSET_XZ(uint32_t size_x, uint32_t size_y, uint32_t size_z, float p_x, float p_y, float p_z, float scale, float** out, NoiseVectorSet* vectorset_out, float* off_x, float* off_z, float off_x_scale, float off_z_scale)
 {
 	if (!out)
 		return;
 	//if (!(*out))
 	//	*out = FastNoiseSIMD::GetEmptySet(size_x, size_y, size_z);
-	//vectorset_out->SetSize(size_x * size_y * size_z);
+	vectorset_out->prepare((int)(size_x * size_y * size_z));
 	vectorset_out->sampleScale = 0;
 	int index = 0;
 	float dx, dy, dz;
@@ -64,13 +64,13 @@ void NOISE_BLOCK_OFFSET_XZ(uint32_t size_x, uint32_t size_y, uint32_t size_z, fl
 	}
 }
 
-void NOISE_BLOCK_OFFSET_XYZ(uint32_t size_x, uint32_t size_y, uint32_t size_z, float p_x, float p_y, float p_z, float scale, float** out, FastNoiseVectorSet* vectorset_out, float* off_x, float* off_y, float* off_z, float off_x_scale, float off_y_scale, float off_z_scale)
+void NOISE_BLOCK_OFFSET_XYZ(uint32_t size_x, uint32_t size_y, uint32_t size_z, float p_x, float p_y, float p_z, float scale, float** out, NoiseVectorSet* vectorset_out, float* off_x, float* off_y, float* off_z, float off_x_scale, float off_y_scale, float off_z_scale)
 {
 	if (!out)
 		return;
 	if (!(*out))
 		*out = FastNoiseSIMD::GetEmptySet(size_x, size_y, size_z);
-	vectorset_out->SetSize(size_x * size_y * size_z);
+	vectorset_out->prepare((int)(size_x * size_y * size_z));
 	vectorset_out->sampleScale = 0;
 	int index = 0;
 	float dx, dy, dz;
@@ -95,34 +95,192 @@ void NOISE_BLOCK_OFFSET_XYZ(uint32_t size_x, uint32_t size_y, uint32_t size_z, f
 	}
 }
 
+// Columns (y = 0) of one footprint, written to the vector set from index first on
+static void NOISE_COLUMNS(uint32_t size_x, uint32_t size_z, float p_x, float p_z, float scale, NoiseVectorSet* vectorset_out, uint32_t first)
+{
+	vectorset_out->sampleScale = 0;
+	uint32_t index = first;
+	for (uint32_t ix = 0; ix < size_x; ix++)
+	{
+		float dx = (float)ix * scale + p_x;
+		for (uint32_t iz = 0; iz < size_z; iz++)
+		{
+			vectorset_out->xSet[index] = dx;
+			vectorset_out->ySet[index] = 0.0f;
+			vectorset_out->zSet[index] = (float)iz * scale + p_z;
+			index++;
+		}
+	}
+}
+
+// Room for count footprints, see SamplerHeightfieldBatchFunction
+static void NOISE_COLUMNS_BATCH(const glm::vec3* p, const float* scale, int count, const glm::ivec3& size, float g_scale, NoiseVectorSet* vectorset_out)
+{
+	uint32_t footprint = size.x * size.z;
+	vectorset_out->prepare((int)(footprint * count));
+	for (int i = 0; i < count; i++)
+		NOISE_COLUMNS(size.x, size.z, p[i].x * g_scale, p[i].z * g_scale, scale[i] * g_scale, vectorset_out, i * footprint);
+}
+
+static void setup_terrain2d(FastNoiseSIMD* noise)
+{
+	noise->SetNoiseType(FastNoiseSIMD::NoiseType::ValueFractal);
+	noise->SetFractalOctaves(12);
+	noise->SetFractalGain(0.5f);
+	noise->SetFractalLacunarity(2.0f);
+	noise->SetFractalType(FastNoiseSIMD::FractalType::FBM);
+}
+
+static void setup_terrain2d_pert(FastNoiseSIMD* noise, SamplerProperties* properties)
+{
+	int octaves = properties ? ((NoiseSamplers::NoiseSamplerProperties*)properties)->octaves : 20;
+	float amp = properties ? ((NoiseSamplers::NoiseSamplerProperties*)properties)->amp : 1.0f;
+	float freq = properties ? ((NoiseSamplers::NoiseSamplerProperties*)properties)->frequency : 0.5f;
+	float gain = properties ? ((NoiseSamplers::NoiseSamplerProperties*)properties)->gain : 0.5f;
+
+	noise->SetNoiseType(FastNoiseSIMD::NoiseType::ValueFractal);
+	noise->SetPerturbType(FastNoiseSIMD::PerturbType::GradientFractal);
+	noise->SetPerturbFractalOctaves(octaves);
+	noise->SetPerturbAmp(amp);
+	noise->SetPerturbFrequency(freq);
+	noise->SetPerturbFractalGain(gain);
+	noise->SetFractalType(FastNoiseSIMD::FractalType::FBM);
+}
+
+// All the fractal noise used here is normalized to [-1, 1]; the margin covers the odd
+// overshoot of simplex noise and rounding in the samplers
+#define NOISE_RANGE_MARGIN 1.05f
+
+// Density of the form -y * y_scale - n with |n| <= noise_bound
+static inline bool plane_range(float y_min, float y_max, float y_scale, float noise_bound, float& out_min, float& out_max)
+{
+	float bound = noise_bound * NOISE_RANGE_MARGIN;
+	out_min = -y_max * y_scale - bound;
+	out_max = -y_min * y_scale + bound;
+	return true;
+}
 
 const float NoiseSamplers::noise3d(const float resolution, const glm::vec3& p)
 {
 	return 0;
 }
 
-const void NoiseSamplers::noise3d_block(const Sampler& sampler, const float resolution, const glm::vec3& p, const glm::ivec3& size, const float scale, void** out, FastNoiseVectorSet* vectorset_out, float* dest_noise, int offset, int stride, SamplerProperties* properties)
+const void NoiseSamplers::noise3d_block(const Sampler& sampler, const float resolution, const glm::vec3& p, const glm::ivec3& size, const float scale, void** out, NoiseVectorSet* vectorset_out, float* dest_noise, int offset, int stride, SamplerProperties* properties)
 {
 	/*NOISE_BLOCK(size.x, size.y, size.z, p.x, p.y, p.z, scale, out, vectorset_out);
 
-	sampler.noise_samplers[thread_index]->SetNoiseType(FastNoiseSIMD::NoiseType::ValueFractal);
-	sampler.noise_samplers[thread_index]->SetFractalOctaves(3);
-	sampler.noise_samplers[thread_index]->FillNoiseSet(*out, vectorset_out);*/
+	noise->SetNoiseType(FastNoiseSIMD::NoiseType::ValueFractal);
+	noise->SetFractalOctaves(3);
+	noise->FillNoiseSet(*out, vectorset_out);*/
+}
+
+const float NoiseSamplers::terrain2d_columns(const Sampler& sampler, const float resolution, const glm::vec3& p, const glm::ivec3& size, const float scale, float* columns, NoiseVectorSet* vectorset_out, SamplerProperties* properties)
+{
+	const float g_scale = 1.0f;
+	const float nm = 64.0f;
+	FastNoiseSIMD* noise = JobSystem::get_noise(sampler.noise_id);
+	NOISE_BLOCK(size.x, 1, size.z, p.x * g_scale, 0, p.z * g_scale, scale * g_scale, &columns, vectorset_out);
+
+	setup_terrain2d(noise);
+	noise->FillNoiseSet(columns, vectorset_out);
+
+	int count = size.x * size.z;
+	for (int i = 0; i < count; i++)
+		columns[i] = -columns[i] * nm;
+	return g_scale;
 }
 
-const void NoiseSamplers::terrain2d_block(const Sampler & sampler, const float resolution, const glm::vec3& p, const glm::ivec3& size, const float scale, void ** out, FastNoiseVectorSet * vectorset_out, float* dest_noise, int offset, int stride, SamplerProperties* properties)
+const float NoiseSamplers::terrain2d_columns_batch(const Sampler& sampler, const float resolution, const glm::vec3* p, const float* scale, int count, const glm::ivec3& size, float* columns, NoiseVectorSet* vectorset_out, SamplerProperties* properties)
 {
 	const float g_scale = 1.0f;
 	const float nm = 64.0f;
-	int thread_index = (properties ? properties->thread_id : 0);
-	NOISE_BLOCK(size.x, 1, size.z, p.x * g_scale, 0, p.z * g_scale, scale * g_scale, &dest_noise, vectorset_out);
+	FastNoiseSIMD* noise = JobSystem::get_noise(sampler.noise_id);
+	NOISE_COLUMNS_BATCH(p, scale, count, size, g_scale, vectorset_out);
+
+	setup_terrain2d(noise);
+	noise->FillNoiseSet(columns, vectorset_out);
+
+	int total = size.x * size.z * count;
+	for (int i = 0; i < total; i++)
+		columns[i] = -columns[i] * nm;
+	return g_scale;
+}
+
+const float NoiseSamplers::terrain2d_pert_columns(const Sampler& sampler, const float resolution, const glm::vec3& p, const glm::ivec3& size, const float scale, float* columns, NoiseVectorSet* vectorset_out, SamplerProperties* properties)
+{
+	const float g_scale = properties ? ((NoiseSamplerProperties*)properties)->g_scale : 0.25f;
+	const float nm = properties ? ((NoiseSamplerProperties*)properties)->height : 64.0f;
+	NOISE_BLOCK(size.x, 1, size.z, p.x * g_scale, 0, p.z * g_scale, scale * g_scale, &columns, vectorset_out);
+
+	FastNoiseSIMD* noise = JobSystem::get_noise(sampler.noise_id);
+	setup_terrain2d_pert(noise, properties);
+	noise->FillNoiseSet(columns, vectorset_out);
+
+	int count = size.x * size.z;
+	for (int i = 0; i < count; i++)
+		columns[i] = -columns[i] * nm;
+	return g_scale;
+}
+
+const float NoiseSamplers::terrain2d_pert_columns_batch(const Sampler& sampler, const float resolution, const glm::vec3* p, const float* scale, int count, const glm::ivec3& size, float* columns, NoiseVectorSet* vectorset_out, SamplerProperties* properties)
+{
+	const float g_scale = properties ? ((NoiseSamplerProperties*)properties)->g_scale : 0.25f;
+	const float nm = properties ? ((NoiseSamplerProperties*)properties)->height : 64.0f;
+	NOISE_COLUMNS_BATCH(p, scale, count, size, g_scale, vectorset_out);
+
+	FastNoiseSIMD* noise = JobSystem::get_noise(sampler.noise_id);
+	setup_terrain2d_pert(noise, properties);
+	noise->FillNoiseSet(columns, vectorset_out);
+
+	int total = size.x * size.z * count;
+	for (int i = 0; i < total; i++)
+		columns[i] = -columns[i] * nm;
+	return g_scale;
+}
+
+const bool NoiseSamplers::terrain2d_range(const float resolution, const glm::vec3& min, const glm::vec3& max, float& out_min, float& out_max, SamplerProperties* properties)
+{
+	return plane_range(min.y, max.y, 1.0f, 64.0f, out_min, out_max);
+}
+
+const bool NoiseSamplers::terrain2d_pert_range(const float resolution, const glm::vec3& min, const glm::vec3& max, float& out_min, float& out_max, SamplerProperties* properties)
+{
+	const float g_scale = properties ? ((NoiseSamplerProperties*)properties)->g_scale : 0.25f;
+	const float nm = properties ? ((NoiseSamplerProperties*)properties)->height : 64.0f;
+	return plane_range(min.y, max.y, g_scale, nm, out_min, out_max);
+}
+
+const bool NoiseSamplers::terrain3d_range(const float resolution, const glm::vec3& min, const glm::vec3& max, float& out_min, float& out_max, SamplerProperties* properties)
+{
+	return plane_range(min.y, max.y, 0.15f * 0.5f, 1.0f, out_min, out_max);
+}
+
+const float NoiseSamplers::terrain3d_lipschitz(const float resolution, SamplerProperties* properties)
+{
+	// Value noise with quintic interpolation moves at most 2 * 15/8 per lattice unit along
+	// each axis. The fractal sums 4 octaves at FastNoiseSIMD's default lacunarity 2 and gain 0.5,
+	// normalized by 1 / 1.875, on coordinates scaled by g_scale and the default frequency 0.01.
+	// The y term adds g_scale * ym. Doubled to stay on the safe side of all of that.
+	const float g_scale = 0.15f;
+	const float ym = 0.5f;
+	const float base = 2.0f * 1.875f * sqrtf(3.0f);
+	const float fractal = 4.0f / 1.875f;
+	return 2.0f * (base * fractal * g_scale * 0.01f + g_scale * ym);
+}
+
+const bool NoiseSamplers::terrain3d_pert_range(const float resolution, const glm::vec3& min, const glm::vec3& max, float& out_min, float& out_max, SamplerProperties* properties)
+{
+	return plane_range(min.y, max.y, 0.15f, 48.0f, out_min, out_max);
+}
 
-	sampler.noise_samplers[thread_index]->SetNoiseType(FastNoiseSIMD::NoiseType::ValueFractal);
-	sampler.noise_samplers[thread_index]->SetFractalOctaves(12);
-	sampler.noise_samplers[thread_index]->SetFractalGain(0.5f);
-	sampler.noise_samplers[thread_index]->SetFractalLacunarity(2.0f);
-	sampler.noise_samplers[thread_index]->SetFractalType(FastNoiseSIMD::FractalType::FBM);
-	sampler.noise_samplers[thread_index]->FillNoiseSet(dest_noise, vectorset_out);
+const bool NoiseSamplers::windy3d_range(const float resolution, const glm::vec3& min, const glm::vec3& max, float& out_min, float& out_max, SamplerProperties* properties)
+{
+	return plane_range(min.y, max.y, 0.25f * 0.5f, resolution * 0.5f, out_min, out_max);
+}
+
+const void NoiseSamplers::terrain2d_block(const Sampler & sampler, const float resolution, const glm::vec3& p, const glm::ivec3& size, const float scale, void ** out, NoiseVectorSet * vectorset_out, float* dest_noise, int offset, int stride, SamplerProperties* properties)
+{
+	float y_scale = terrain2d_columns(sampler, resolution, p, size, scale, dest_noise, vectorset_out, properties);
 
 	if (!(*out))
 		*out = (float*)_aligned_malloc(sizeof(float) * size.x * size.y * size.z, 16);
@@ -132,39 +290,19 @@ const void NoiseSamplers::terrain2d_block(const Sampler & sampler, const float r
 	{
 		for (int iy = 0; iy < size.y; iy++)
 		{
-			dy = ((float)iy * scale + p.y) * g_scale;
+			dy = ((float)iy * scale + p.y) * y_scale;
 			for (int iz = 0; iz < size.z; iz++)
 			{
-				float n = dest_noise[ix * size.z + iz];
-				//(*out)[ix * size.y * size.z + iy * size.z + iz] = -dy - n * nm;
-				SET_OUT(ix * size.y * size.z + iy * size.z + iz, -dy - n * nm);
+				float c = dest_noise[ix * size.z + iz];
+				SET_OUT(ix * size.y * size.z + iy * size.z + iz, c - dy);
 			}
 		}
 	}
-
-	//_aligned_free(dest_noise);
 }
 
-const void NoiseSamplers::terrain2d_pert_block(const Sampler& sampler, const float resolution, const glm::vec3& p, const glm::ivec3& size, const float scale, void ** out, FastNoiseVectorSet * vectorset_out, float* dest_noise, int offset, int stride, SamplerProperties* properties)
+const void NoiseSamplers::terrain2d_pert_block(const Sampler& sampler, const float resolution, const glm::vec3& p, const glm::ivec3& size, const float scale, void ** out, NoiseVectorSet * vectorset_out, float* dest_noise, int offset, int stride, SamplerProperties* properties)
 {
-	const float g_scale = properties ? ((NoiseSamplerProperties*)properties)->g_scale : 0.25f;
-	const float nm = properties ? ((NoiseSamplerProperties*)properties)->height : 64.0f;
-	NOISE_BLOCK(size.x, 1, size.z, p.x * g_scale, 0, p.z * g_scale, scale * g_scale, &dest_noise, vectorset_out);
-
-	int thread_index = (properties ? properties->thread_id : 0);
-	int octaves = properties ? ((NoiseSamplerProperties*)properties)->octaves : 20;
-	float amp = properties ? ((NoiseSamplerProperties*)properties)->amp : 1.0f;
-	float freq = properties ? ((NoiseSamplerProperties*)properties)->frequency : 0.5f;
-	float gain = properties ? ((NoiseSamplerProperties*)properties)->gain : 0.5f;
-
-	sampler.noise_samplers[thread_index]->SetNoiseType(FastNoiseSIMD::NoiseType::ValueFractal);
-	sampler.noise_samplers[thread_index]->SetPerturbType(FastNoiseSIMD::PerturbType::GradientFractal);
-	sampler.noise_samplers[thread_index]->SetPerturbFractalOctaves(octaves);
-	sampler.noise_samplers[thread_index]->SetPerturbAmp(amp);
-	sampler.noise_samplers[thread_index]->SetPerturbFrequency(freq);
-	sampler.noise_samplers[thread_index]->SetPerturbFractalGain(gain);
-	sampler.noise_samplers[thread_index]->SetFractalType(FastNoiseSIMD::FractalType::FBM);
-	sampler.noise_samplers[thread_index]->FillNoiseSet(dest_noise, vectorset_out);
+	float y_scale = terrain2d_pert_columns(sampler, resolution, p, size, scale, dest_noise, vectorset_out, properties);
 
 	if (!(*out))
 		*out = (float*)_aligned_malloc(sizeof(float) * size.x * size.y * size.z, 16);
@@ -177,33 +315,27 @@ const void NoiseSamplers::terrain2d_pert_block(const Sampler& sampler, const flo
 	{
 		for (int iy = 0; iy < size.y; iy++)
 		{
-			dy = ((float)iy * scale + p.y) * g_scale;
+			dy = ((float)iy * scale + p.y) * y_scale;
 			for (int iz = 0; iz < size.z; iz++)
 			{
-				float n = dest_noise[ix * size.z + iz];
-				//dy = roundf(dy * 4.0f) / 4.0f;
-				//(*out)[ix * size.y * size.z + iy * size.z + iz] = -dy - n * nm;
-				//SET_OUT(ind, -dy - n * nm);
-				f_out[ind] = -dy - n * nm;
+				f_out[ind] = dest_noise[ix * size.z + iz] - dy;
 				ind++;
 			}
 		}
 	}
-
-	//_aligned_free(dest_noise);
 }
 
-const void NoiseSamplers::terrain3d_block(const Sampler & sampler, const float resolution, const glm::vec3 & p, const glm::ivec3 & size, const float scale, void ** out, FastNoiseVectorSet * vectorset_out, float* dest_noise, int offset, int stride, SamplerProperties* properties)
+const void NoiseSamplers::terrain3d_block(const Sampler & sampler, const float resolution, const glm::vec3 & p, const glm::ivec3 & size, const float scale, void ** out, NoiseVectorSet * vectorset_out, float* dest_noise, int offset, int stride, SamplerProperties* properties)
 {
 	const float g_scale = 0.15f;
 	const float ym = 0.5f;
-	int thread_index = (properties ? properties->thread_id : 0);
+	FastNoiseSIMD* noise = JobSystem::get_noise(sampler.noise_id);
 	NOISE_BLOCK(size.x, size.y, size.z, p.x * g_scale, p.y * g_scale, p.z * g_scale, scale * g_scale, &dest_noise, vectorset_out);
 
-	sampler.noise_samplers[thread_index]->SetNoiseType(FastNoiseSIMD::NoiseType::ValueFractal);
-	sampler.noise_samplers[thread_index]->SetFractalOctaves(4);
-	sampler.noise_samplers[thread_index]->SetFractalType(FastNoiseSIMD::FractalType::RigidMulti);
-	sampler.noise_samplers[thread_index]->FillNoiseSet(dest_noise, vectorset_out);
+	noise->SetNoiseType(FastNoiseSIMD::NoiseType::ValueFractal);
+	noise->SetFractalOctaves(4);
+	noise->SetFractalType(FastNoiseSIMD::FractalType::RigidMulti);
+	noise->FillNoiseSet(dest_noise, vectorset_out);
 
 	if (!(*out))
 		*out = (float*)_aligned_malloc(sizeof(float) * size.x * size.y * size.z, 16);
@@ -226,20 +358,20 @@ const void NoiseSamplers::terrain3d_block(const Sampler & sampler, const float r
 	//_aligned_free(dest_noise);
 }
 
-const void NoiseSamplers::terrain3d_pert_block(const Sampler & sampler, const float resolution, const glm::vec3 & p, const glm::ivec3 & size, const float scale, void ** out, FastNoiseVectorSet* vectorset_out, float* dest_noise, int offset, int stride, SamplerProperties* properties)
+const void NoiseSamplers::terrain3d_pert_block(const Sampler & sampler, const float resolution, const glm::vec3 & p, const glm::ivec3 & size, const float scale, void ** out, NoiseVectorSet* vectorset_out, float* dest_noise, int offset, int stride, SamplerProperties* properties)
 {
 	const float g_scale = 0.15f;
 	const float nm = 48.0f;
-	int thread_index = (properties ? properties->thread_id : 0);
+	FastNoiseSIMD* noise = JobSystem::get_noise(sampler.noise_id);
 	NOISE_BLOCK(size.x, size.y, size.z, p.x * g_scale, p.y * g_scale, p.z * g_scale, scale * g_scale, &dest_noise, vectorset_out);
 
-	sampler.noise_samplers[thread_index]->SetNoiseType(FastNoiseSIMD::NoiseType::SimplexFractal);
-	sampler.noise_samplers[thread_index]->SetPerturbType(FastNoiseSIMD::PerturbType::GradientFractal);
-	sampler.noise_samplers[thread_index]->SetFractalOctaves(8);
-	sampler.noise_samplers[thread_index]->SetPerturbAmp(1.0f);
-	sampler.noise_samplers[thread_index]->SetPerturbFrequency(0.05f);
-	sampler.noise_samplers[thread_index]->SetFractalType(FastNoiseSIMD::FractalType::RigidMulti);
-	sampler.noise_samplers[thread_index]->FillNoiseSet(dest_noise, vectorset_out);
+	noise->SetNoiseType(FastNoiseSIMD::NoiseType::SimplexFractal);
+	noise->SetPerturbType(FastNoiseSIMD::PerturbType::GradientFractal);
+	noise->SetFractalOctaves(8);
+	noise->SetPerturbAmp(1.0f);
+	noise->SetPerturbFrequency(0.05f);
+	noise->SetFractalType(FastNoiseSIMD::FractalType::RigidMulti);
+	noise->FillNoiseSet(dest_noise, vectorset_out);
 
 	if (!(*out))
 		*out = (float*)_aligned_malloc(sizeof(float) * size.x * size.y * size.z, 16);
@@ -262,35 +394,35 @@ const void NoiseSamplers::terrain3d_pert_block(const Sampler & sampler, const fl
 	//_aligned_free(dest_noise);
 }
 
-const void NoiseSamplers::windy3d_block(const Sampler & sampler, const float resolution, const glm::vec3& p, const glm::ivec3 & size, const float scale, void ** out, FastNoiseVectorSet* vectorset_out, float* dest_noise, int offset, int stride, SamplerProperties* properties)
+const void NoiseSamplers::windy3d_block(const Sampler & sampler, const float resolution, const glm::vec3& p, const glm::ivec3 & size, const float scale, void ** out, NoiseVectorSet* vectorset_out, float* dest_noise, int offset, int stride, SamplerProperties* properties)
 {
 	const float g_scale = 0.25f;
 	const float ym = 0.5f;
 	const int wind_octaves = 1;
 	const float wind_scale = 0.01f;
 	const float wind_perc = 1.0f;
-	int thread_index = (properties ? properties->thread_id : 0);
+	FastNoiseSIMD* noise = JobSystem::get_noise(sampler.noise_id);
 
 	float* noise_offset_x = 0;
 	float* noise_offset_y = 0;
 	float* final_noise = 0;
-	FastNoiseVectorSet x_vectorset;
-	FastNoiseVectorSet y_vectorset;
+	NoiseVectorSet x_vectorset;
+	NoiseVectorSet y_vectorset;
 	NOISE_BLOCK(size.x, size.y, size.z, p.x * wind_scale, p.y * wind_scale, p.z * wind_scale, scale * wind_scale, &noise_offset_x, &x_vectorset);
-	sampler.noise_samplers[thread_index]->SetNoiseType(FastNoiseSIMD::NoiseType::SimplexFractal);
-	sampler.noise_samplers[thread_index]->SetFractalOctaves(wind_octaves);
-	sampler.noise_samplers[thread_index]->FillNoiseSet(noise_offset_x, &x_vectorset);
+	noise->SetNoiseType(FastNoiseSIMD::NoiseType::SimplexFractal);
+	noise->SetFractalOctaves(wind_octaves);
+	noise->FillNoiseSet(noise_offset_x, &x_vectorset);
 
 	NOISE_BLOCK(size.x, size.y, size.z, p.x * wind_scale, p.y * wind_scale, p.z * wind_scale, scale * wind_scale, &noise_offset_y, &y_vectorset);
-	sampler.noise_samplers[thread_index]->SetNoiseType(FastNoiseSIMD::NoiseType::SimplexFractal);
-	sampler.noise_samplers[thread_index]->SetFractalOctaves(wind_octaves);
-	sampler.noise_samplers[thread_index]->FillNoiseSet(noise_offset_y, &y_vectorset);
+	noise->SetNoiseType(FastNoiseSIMD::NoiseType::SimplexFractal);
+	noise->SetFractalOctaves(wind_octaves);
+	noise->FillNoiseSet(noise_offset_y, &y_vectorset);
 
 	NOISE_BLOCK_OFFSET_XZ(size.x, size.y, size.z, p.x * g_scale, p.y * g_scale, p.z * g_scale, scale * g_scale, &final_noise, vectorset_out, noise_offset_x, noise_offset_y, wind_perc, wind_perc);
-	sampler.noise_samplers[thread_index]->SetNoiseType(FastNoiseSIMD::NoiseType::SimplexFractal);
-	sampler.noise_samplers[thread_index]->SetFractalOctaves(4);
-	//sampler.noise_samplers[thread_index]->SetFractalType(FastNoiseSIMD::FractalType::Billow);
-	sampler.noise_samplers[thread_index]->FillNoiseSet(final_noise, vectorset_out);
+	noise->SetNoiseType(FastNoiseSIMD::NoiseType::SimplexFractal);
+	noise->SetFractalOctaves(4);
+	//noise->SetFractalType(FastNoiseSIMD::FractalType::Billow);
+	noise->FillNoiseSet(final_noise, vectorset_out);
 
 
 
@@ -22,15 +22,27 @@ namespace NoiseSamplers
 	};
 
 	const float noise3d(const float resolution, const glm::vec3& p);
-	const void noise3d_block(const Sampler& sampler, const float resolution, const glm::vec3& p, const glm::ivec3& size, const float scale, void** out, FastNoiseVectorSet* vectorset_out, float* dest_noise, int offset, int stride, SamplerProperties* properties);
+	const void noise3d_block(const Sampler& sampler, const float resolution, const glm::vec3& p, const glm::ivec3& size, const float scale, void** out, NoiseVectorSet* vectorset_out, float* dest_noise, int offset, int stride, SamplerProperties* properties);
 
-	const void terrain2d_block(const Sampler& sampler, const float resolution, const glm::vec3& p, const glm::ivec3& size, const float scale, void** out, FastNoiseVectorSet* vectorset_out, float* dest_noise, int offset, int stride, SamplerProperties* properties);
-	const void terrain2d_pert_block(const Sampler & sampler, const float resolution, const glm::vec3& p, const glm::ivec3& size, const float scale, void ** out, FastNoiseVectorSet * vectorset_out, float* dest_noise, int offset, int stride, SamplerProperties* properties);
+	const float terrain2d_columns(const Sampler& sampler, const float resolution, const glm::vec3& p, const glm::ivec3& size, const float scale, float* columns, NoiseVectorSet* vectorset_out, SamplerProperties* properties);
+	const float terrain2d_pert_columns(const Sampler& sampler, const float resolution, const glm::vec3& p, const glm::ivec3& size, const float scale, float* columns, NoiseVectorSet* vectorset_out, SamplerProperties* properties);
+	const float terrain2d_columns_batch(const Sampler& sampler, const float resolution, const glm::vec3* p, const float* scale, int count, const glm::ivec3& size, float* columns, NoiseVectorSet* vectorset_out, SamplerProperties* properties);
+	const float terrain2d_pert_columns_batch(const Sampler& sampler, const float resolution, const glm::vec3* p, const float* scale, int count, const glm::ivec3& size, float* columns, NoiseVectorSet* vectorset_out, SamplerProperties* properties);
 
-	const void terrain3d_block(const Sampler& sampler, const float resolution, const glm::vec3& p, const glm::ivec3& size, const float scale, void** out, FastNoiseVectorSet* vectorset_out, float* dest_noise, int offset, int stride, SamplerProperties* properties);
-	const void terrain3d_pert_block(const Sampler& sampler, const float resolution, const glm::vec3& p, const glm::ivec3& size, const float scale, void** out, FastNoiseVectorSet* vectorset_out, float* dest_noise, int offset, int stride, SamplerProperties* properties);
+	const bool terrain2d_range(const float resolution, const glm::vec3& min, const glm::vec3& max, float& out_min, float& out_max, SamplerProperties* properties);
+	const bool terrain2d_pert_range(const float resolution, const glm::vec3& min, const glm::vec3& max, float& out_min, float& out_max, SamplerProperties* properties);
+	const bool terrain3d_range(const float resolution, const glm::vec3& min, const glm::vec3& max, float& out_min, float& out_max, SamplerProperties* properties);
+	const bool terrain3d_pert_range(const float resolution, const glm::vec3& min, const glm::vec3& max, float& out_min, float& out_max, SamplerProperties* properties);
+	const float terrain3d_lipschitz(const float resolution, SamplerProperties* properties);
+	const bool windy3d_range(const float resolution, const glm::vec3& min, const glm::vec3& max, float& out_min, float& out_max, SamplerProperties* properties);
 
-	const void windy3d_block(const Sampler& sampler, const float resolution, const glm::vec3& p, const glm::ivec3& size, const float scale, void** out, FastNoiseVectorSet* vectorset_out, float* dest_noise, int offset, int stride, SamplerProperties* properties);
+	const void terrain2d_block(const Sampler& sampler, const float resolution, const glm::vec3& p, const glm::ivec3& size, const float scale, void** out, NoiseVectorSet* vectorset_out, float* dest_noise, int offset, int stride, SamplerProperties* properties);
+	const void terrain2d_pert_block(const Sampler & sampler, const float resolution, const glm::vec3& p, const glm::ivec3& size, const float scale, void ** out, NoiseVectorSet * vectorset_out, float* dest_noise, int offset, int stride, SamplerProperties* properties);
+
+	const void terrain3d_block(const Sampler& sampler, const float resolution, const glm::vec3& p, const glm::ivec3& size, const float scale, void** out, NoiseVectorSet* vectorset_out, float* dest_noise, int offset, int stride, SamplerProperties* properties);
+	const void terrain3d_pert_block(const Sampler& sampler, const float resolution, const glm::vec3& p, const glm::ivec3& size, const float scale, void** out, NoiseVectorSet* vectorset_out, float* dest_noise, int offset, int stride, SamplerProperties* properties);
+
+	const void windy3d_block(const Sampler& sampler, const float resolution, const glm::vec3& p, const glm::ivec3& size, const float scale, void** out, NoiseVectorSet* vectorset_out, float* dest_noise, int offset, int stride, SamplerProperties* properties);
 
 	inline glm::vec3 implicit_gradient(SamplerValueFunction f, const float resolution, const glm::vec3& p, float h = 0.01f)
 	{
@@ -45,7 +57,7 @@ namespace NoiseSamplers
 		return vec3(dxp - dxm, dyp - dym, dzp - dzm);
 	}
 
-	inline void implicit_block(const SamplerValueFunction& f, const float resolution, const glm::vec3& p, const glm::ivec3& size, const float scale, float** out, FastNoiseVectorSet** vectorset_out)
+	inline void implicit_block(const SamplerValueFunction& f, const float resolution, const glm::vec3& p, const glm::ivec3& size, const float scale, float** out, NoiseVectorSet** vectorset_out)
 	{
 		if (!out)
 			return;
@@ -74,68 +86,77 @@ namespace NoiseSamplers
 		Sampler s;
 		s.value = f;
 		s.gradient = std::bind(implicit_gradient, f, _1, _2, _3);
-		for (int i = 0; i < 8; i++)
-			s.noise_samplers[i] = FastNoiseSIMD::NewFastNoiseSIMD();
+		s.noise_id = new_noise_id();
 		return s;
 	}
 
 	inline void create_sampler_noise3d(Sampler* s)
 	{
 		using namespace std::placeholders;
+		s->type = SAMPLER_TYPES_NOISE_3D;
 		s->value = noise3d;
 		s->gradient = std::bind(implicit_gradient, noise3d, _1, _2, _3);
-		for (int i = 0; i < 8; i++)
-			s->noise_samplers[i] = FastNoiseSIMD::NewFastNoiseSIMD();
+		s->noise_id = new_noise_id();
 		s->block = std::bind(noise3d_block, *s, _1, _2, _3, _4, _5, _6, _7, _8, _9, _10);
 	}
 
 	inline void create_sampler_terrain_2d(Sampler* s)
 	{
 		using namespace std::placeholders;
+		s->type = SAMPLER_TYPES_TERRAIN_2D;
 		s->value = noise3d;
 		s->gradient = std::bind(implicit_gradient, noise3d, _1, _2, _3);
-		for (int i = 0; i < 8; i++)
-			s->noise_samplers[i] = FastNoiseSIMD::NewFastNoiseSIMD();
+		s->noise_id = new_noise_id();
 		s->block = std::bind(terrain2d_block, *s, _1, _2, _3, _4, _5, _6, _7, _8, _9, _10);
+		s->range = terrain2d_range;
+		s->heightfield = std::bind(terrain2d_columns, *s, _1, _2, _3, _4, _5, _6, _7);
+		s->heightfield_batch = std::bind(terrain2d_columns_batch, *s, _1, _2, _3, _4, _5, _6, _7, _8);
 	}
 
 	inline void create_sampler_terrain_pert_2d(Sampler* s)
 	{
 		using namespace std::placeholders;
+		s->type = SAMPLER_TYPES_TERRAIN_PERT_2D;
 		s->value = noise3d;
 		s->gradient = std::bind(implicit_gradient, noise3d, _1, _2, _3);
-		for (int i = 0; i < 8; i++)
-			s->noise_samplers[i] = FastNoiseSIMD::NewFastNoiseSIMD();
+		s->noise_id = new_noise_id();
 		s->block = std::bind(terrain2d_pert_block, *s, _1, _2, _3, _4, _5, _6, _7, _8, _9, _10);
+		s->range = terrain2d_pert_range;
+		s->heightfield = std::bind(terrain2d_pert_columns, *s, _1, _2, _3, _4, _5, _6, _7);
+		s->heightfield_batch = std::bind(terrain2d_pert_columns_batch, *s, _1, _2, _3, _4, _5, _6, _7, _8);
 	}
 
 	inline void create_sampler_terrain_3d(Sampler* s)
 	{
 		using namespace std::placeholders;
+		s->type = SAMPLER_TYPES_TERRAIN_3D;
 		s->value = noise3d;
 		s->gradient = std::bind(implicit_gradient, noise3d, _1, _2, _3);
-		for (int i = 0; i < 8; i++)
-			s->noise_samplers[i] = FastNoiseSIMD::NewFastNoiseSIMD();
+		s->noise_id = new_noise_id();
 		s->block = std::bind(terrain3d_block, *s, _1, _2, _3, _4, _5, _6, _7, _8, _9, _10);
+		s->range = terrain3d_range;
+		s->lipschitz = terrain3d_lipschitz;
 	}
 
 	inline void create_sampler_terrain_pert_3d(Sampler* s)
 	{
 		using namespace std::placeholders;
+		s->type = SAMPLER_TYPES_TERRAIN_PERT_3D;
 		s->value = noise3d;
 		s->gradient = std::bind(implicit_gradient, noise3d, _1, _2, _3);
-		for (int i = 0; i < 8; i++)
-			s->noise_samplers[i] = FastNoiseSIMD::NewFastNoiseSIMD();
+		s->noise_id = new_noise_id();
 		s->block = std::bind(terrain3d_pert_block, *s, _1, _2, _3, _4, _5, _6, _7, _8, _9, _10);
+		s->range = terrain3d_pert_range;
 	}
 
 	inline void create_sampler_windy_3d(Sampler* s)
 	{
 		using namespace std::placeholders;
+		s->type = SAMPLER_TYPES_WINDY_3D;
 		s->value = noise3d;
 		s->gradient = std::bind(implicit_gradient, noise3d, _1, _2, _3);
-		for (int i = 0; i < 8; i++)
-			s->noise_samplers[i] = FastNoiseSIMD::NewFastNoiseSIMD();
+		s->noise_id = new_noise_id();
 		s->block = std::bind(windy3d_block, *s, _1, _2, _3, _4, _5, _6, _7, _8, _9, _10);
+		s->range = windy3d_range;
 	}
 }
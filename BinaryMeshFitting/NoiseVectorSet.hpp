@@ -0,0 +1,24 @@
+#pragma once
+
+#include <FastNoiseSIMD.h>
+
+// A FastNoiseVectorSet that knows how many positions it has room for. NoiseBlock keeps one per
+// pooled block and reuses it for blocks of any size, so the allocation only grows; a smaller
+// block just lowers size, the count FillNoiseSet walks.
+struct NoiseVectorSet : public FastNoiseVectorSet
+{
+	int capacity;
+
+	inline NoiseVectorSet() : capacity(0) {}
+
+	inline void prepare(int count)
+	{
+		if (count > capacity)
+		{
+			SetSize(count);
+			capacity = count;
+		}
+		else
+			size = count;
+	}
+};
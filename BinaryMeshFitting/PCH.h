@@ -9,7 +9,4 @@
 
 #define PI 3.1415926535897932384626433832795f
 
-#include "GUI/imgui.h"
-#include "GUI/imgui_impl_glfw_gl3.h"
-
 #include <Vc/Vc>
@@ -0,0 +1,158 @@
+#include "PCH.h"
+#include "PackedDensity.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+#define PACKED_DENSITY_MAX 32767.0f
+
+static inline bool sample_negative(const uint32_t* signs, uint32_t z_per_y, uint32_t dim, uint32_t x, uint32_t y, uint32_t z)
+{
+	return (signs[(x * dim + y) * z_per_y + (z >> 5)] >> (z & 31)) & 1;
+}
+
+// Whether any axis neighbour of the sample has the other sign, making it an endpoint of a crossing edge
+static inline bool sample_crossing(const uint32_t* signs, uint32_t z_per_y, uint32_t dim, uint32_t x, uint32_t y, uint32_t z, bool negative)
+{
+	return (x > 0 && sample_negative(signs, z_per_y, dim, x - 1, y, z) != negative) ||
+		(x + 1 < dim && sample_negative(signs, z_per_y, dim, x + 1, y, z) != negative) ||
+		(y > 0 && sample_negative(signs, z_per_y, dim, x, y - 1, z) != negative) ||
+		(y + 1 < dim && sample_negative(signs, z_per_y, dim, x, y + 1, z) != negative) ||
+		(z > 0 && sample_negative(signs, z_per_y, dim, x, y, z - 1) != negative) ||
+		(z + 1 < dim && sample_negative(signs, z_per_y, dim, x, y, z + 1) != negative);
+}
+
+PackedDensityBlock::PackedDensityBlock()
+{
+	dim = 0;
+	bricks_per_axis = 0;
+	brick_capacity = 0;
+	data_capacity = 0;
+	stored_bricks = 0;
+	brick_index = 0;
+	brick_band = 0;
+	data = 0;
+	initialized = false;
+}
+
+PackedDensityBlock::~PackedDensityBlock()
+{
+	_aligned_free(brick_index);
+	_aligned_free(brick_band);
+	_aligned_free(data);
+}
+
+void PackedDensityBlock::pack(const float* density, const uint32_t* signs, uint32_t _dim)
+{
+	const uint32_t B = PACKED_DENSITY_BRICK_DIM;
+	dim = _dim;
+	bricks_per_axis = (dim + B - 1) / B;
+	uint32_t z_per_y = (dim + 31) / 32;
+	uint32_t bricks = bricks_per_axis * bricks_per_axis * bricks_per_axis;
+	if (brick_capacity < bricks)
+	{
+		_aligned_free(brick_index);
+		_aligned_free(brick_band);
+		brick_index = (uint32_t*)_aligned_malloc(sizeof(uint32_t) * bricks, 16);
+		brick_band = (float*)_aligned_malloc(sizeof(float) * bricks, 16);
+		brick_capacity = bricks;
+	}
+
+	// Which bricks hold a crossing sample, and the band of each
+	stored_bricks = 0;
+	for (uint32_t b = 0; b < bricks; b++)
+	{
+		uint32_t bx = b / (bricks_per_axis * bricks_per_axis), by = (b / bricks_per_axis) % bricks_per_axis, bz = b % bricks_per_axis;
+		uint32_t x1 = std::min(bx * B + B, dim), y1 = std::min(by * B + B, dim), z1 = std::min(bz * B + B, dim);
+		float band = 0.0f;
+		bool any = false;
+		for (uint32_t x = bx * B; x < x1; x++)
+		{
+			for (uint32_t y = by * B; y < y1; y++)
+			{
+				for (uint32_t z = bz * B; z < z1; z++)
+				{
+					if (sample_crossing(signs, z_per_y, dim, x, y, z, sample_negative(signs, z_per_y, dim, x, y, z)))
+					{
+						any = true;
+						band = std::max(band, fabsf(density[(x * dim + y) * dim + z]));
+					}
+				}
+			}
+		}
+		brick_index[b] = (any ? stored_bricks++ : PACKED_DENSITY_NO_BRICK);
+		brick_band[b] = std::max(band, 1e-30f);
+	}
+
+	// Pooled blocks are reused, but one that is far too large would defeat the point
+	if (data_capacity < stored_bricks || data_capacity > stored_bricks * 2)
+	{
+		_aligned_free(data);
+		data = (stored_bricks ? (int16_t*)_aligned_malloc(sizeof(int16_t) * PACKED_DENSITY_BRICK_SIZE * stored_bricks, 16) : 0);
+		data_capacity = stored_bricks;
+	}
+
+	for (uint32_t b = 0; b < bricks; b++)
+	{
+		if (brick_index[b] == PACKED_DENSITY_NO_BRICK)
+			continue;
+		uint32_t bx = b / (bricks_per_axis * bricks_per_axis), by = (b / bricks_per_axis) % bricks_per_axis, bz = b % bricks_per_axis;
+		uint32_t x1 = std::min(bx * B + B, dim), y1 = std::min(by * B + B, dim), z1 = std::min(bz * B + B, dim);
+		float to_packed = PACKED_DENSITY_MAX / brick_band[b];
+		int16_t* out = data + brick_index[b] * PACKED_DENSITY_BRICK_SIZE;
+		for (uint32_t x = bx * B; x < x1; x++)
+		{
+			for (uint32_t y = by * B; y < y1; y++)
+			{
+				for (uint32_t z = bz * B; z < z1; z++)
+				{
+					bool negative = sample_negative(signs, z_per_y, dim, x, y, z);
+					// Never 0, the two ends of a crossing edge must keep opposite signs
+					float q = PACKED_DENSITY_MAX;
+					if (sample_crossing(signs, z_per_y, dim, x, y, z, negative))
+						q = std::min(PACKED_DENSITY_MAX, std::max(1.0f, floorf(fabsf(density[(x * dim + y) * dim + z]) * to_packed + 0.5f)));
+					out[((x - bx * B) * B + y - by * B) * B + z - bz * B] = (int16_t)(negative ? -q : q);
+				}
+			}
+		}
+	}
+	initialized = true;
+}
+
+void PackedDensityBlock::unpack(float* density, const uint32_t* signs) const
+{
+	const uint32_t B = PACKED_DENSITY_BRICK_DIM;
+	uint32_t z_per_y = (dim + 31) / 32;
+	uint32_t bricks = bricks_per_axis * bricks_per_axis * bricks_per_axis;
+	for (uint32_t b = 0; b < bricks; b++)
+	{
+		uint32_t bx = b / (bricks_per_axis * bricks_per_axis), by = (b / bricks_per_axis) % bricks_per_axis, bz = b % bricks_per_axis;
+		uint32_t x1 = std::min(bx * B + B, dim), y1 = std::min(by * B + B, dim), z1 = std::min(bz * B + B, dim);
+		if (brick_index[b] == PACKED_DENSITY_NO_BRICK)
+		{
+			for (uint32_t x = bx * B; x < x1; x++)
+				for (uint32_t y = by * B; y < y1; y++)
+					for (uint32_t z = bz * B; z < z1; z++)
+						density[(x * dim + y) * dim + z] = (sample_negative(signs, z_per_y, dim, x, y, z) ? -1.0f : 1.0f);
+			continue;
+		}
+
+		float from_packed = brick_band[b] / PACKED_DENSITY_MAX;
+		const int16_t* in = data + brick_index[b] * PACKED_DENSITY_BRICK_SIZE;
+		for (uint32_t x = bx * B; x < x1; x++)
+		{
+			for (uint32_t y = by * B; y < y1; y++)
+			{
+				const int16_t* row = in + ((x - bx * B) * B + y - by * B) * B - bz * B;
+				float* out = density + (x * dim + y) * dim;
+				for (uint32_t z = bz * B; z < z1; z++)
+					out[z] = (float)row[z] * from_packed;
+			}
+		}
+	}
+}
+
+size_t PackedDensityBlock::bytes() const
+{
+	return sizeof(PackedDensityBlock) + (sizeof(uint32_t) + sizeof(float)) * brick_capacity + sizeof(int16_t) * PACKED_DENSITY_BRICK_SIZE * data_capacity;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include "LinkedNode.hpp"
+
+#define PACKED_DENSITY_BRICK_DIM 8
+#define PACKED_DENSITY_BRICK_SIZE (PACKED_DENSITY_BRICK_DIM * PACKED_DENSITY_BRICK_DIM * PACKED_DENSITY_BRICK_DIM)
+#define PACKED_DENSITY_NO_BRICK 0xFFFFFFFF
+
+// Compact copy of a chunk's densities for keeping it around, see BlockLRU. calculate_isovertex only
+// reads the two samples of an edge whose signs differ, so only bricks holding such a sample are
+// kept. Each is stored as 16-bit values relative to its band, the largest magnitude among those
+// samples; the others are clamped to the band with their sign. Signs always come from the binary
+// block, which is kept alongside, so samples the sampler never wrote (see label_heightfield) don't matter.
+struct PackedDensityBlock : public LinkedNode<PackedDensityBlock>
+{
+	uint32_t dim;
+	uint32_t bricks_per_axis;
+	uint32_t brick_capacity;	// Bricks the arrays below have room for
+	uint32_t data_capacity;		// Bricks data has room for
+	uint32_t stored_bricks;
+	uint32_t* brick_index;		// Into data, PACKED_DENSITY_NO_BRICK for bricks all of one sign
+	float* brick_band;
+	int16_t* data;
+	bool initialized;
+
+	PackedDensityBlock();
+	~PackedDensityBlock();
+
+	// signs is the chunk's binary block, one bit per sample set for negative densities
+	void pack(const float* density, const uint32_t* signs, uint32_t dim);
+	// Bricks that weren't stored get a placeholder density of the right sign
+	void unpack(float* density, const uint32_t* signs) const;
+
+	size_t bytes() const;
+};
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <glm/glm.hpp>
+
+// 12 byte vertex of formatted, uploaded and archived chunk meshes: a third of the separate position,
+// normal and color floats. Positions are quantized to the mesh's bounding box, so precision scales
+// with the chunk. The layout is read by GLChunk and main_vs.glsl as is.
+struct PackedVertex
+{
+	uint16_t p[3];	// 0 to 65535 from the box's min to its max
+	uint8_t n[2];	// Octahedral normal, 0 to 255 for -1 to 1
+	uint8_t c[4];	// RGB color, the last byte pads the vertex to 12 bytes
+};
+
+static_assert(sizeof(PackedVertex) == 12, "PackedVertex must stay 12 bytes, archives and vertex layouts depend on it");
+
+inline uint8_t pack_unorm8(float v)
+{
+	return (uint8_t)std::min(255.0f, std::max(0.0f, v * 255.0f + 0.5f));
+}
+
+inline uint16_t pack_unorm16(float v)
+{
+	return (uint16_t)std::min(65535.0f, std::max(0.0f, v * 65535.0f + 0.5f));
+}
+
+// Projects the normal onto the octahedron |x| + |y| + |z| = 1 and folds the lower half over the upper
+inline void pack_octahedral(const glm::vec3& n, uint8_t out[2])
+{
+	float l1 = fabsf(n.x) + fabsf(n.y) + fabsf(n.z);
+	float x = 0.0f, y = 0.0f;
+	if (l1 > 0.0f)
+	{
+		x = n.x / l1;
+		y = n.y / l1;
+		if (n.z < 0.0f)
+		{
+			float fx = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+			float fy = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+			x = fx;
+			y = fy;
+		}
+	}
+	out[0] = pack_unorm8(x * 0.5f + 0.5f);
+	out[1] = pack_unorm8(y * 0.5f + 0.5f);
+}
+
+inline glm::vec3 unpack_octahedral(const uint8_t in[2])
+{
+	float x = (float)in[0] / 255.0f * 2.0f - 1.0f;
+	float y = (float)in[1] / 255.0f * 2.0f - 1.0f;
+	float z = 1.0f - fabsf(x) - fabsf(y);
+	if (z < 0.0f)
+	{
+		float fx = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+		float fy = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+		x = fx;
+		y = fy;
+	}
+	return glm::normalize(glm::vec3(x, y, z));
+}
+
+// inv_extent is 1 / (box max - box min) per axis, 0 for a flat axis
+inline PackedVertex pack_vertex(const glm::vec3& p, const glm::vec3& n, const glm::vec3& color, const glm::vec3& box_min, const glm::vec3& inv_extent)
+{
+	PackedVertex v;
+	glm::vec3 t = (p - box_min) * inv_extent;
+	v.p[0] = pack_unorm16(t.x);
+	v.p[1] = pack_unorm16(t.y);
+	v.p[2] = pack_unorm16(t.z);
+	pack_octahedral(n, v.n);
+	v.c[0] = pack_unorm8(color.x);
+	v.c[1] = pack_unorm8(color.y);
+	v.c[2] = pack_unorm8(color.z);
+	v.c[3] = 0;
+	return v;
+}
+
+inline glm::vec3 unpack_position(const PackedVertex& v, const glm::vec3& box_min, const glm::vec3& extent)
+{
+	return box_min + glm::vec3((float)v.p[0], (float)v.p[1], (float)v.p[2]) * (extent / 65535.0f);
+}
+
+inline glm::vec3 unpack_color(const PackedVertex& v)
+{
+	return glm::vec3((float)v.c[0], (float)v.c[1], (float)v.c[2]) / 255.0f;
+}
@@ -1,12 +1,99 @@
 #pragma once
 
+#include <atomic>
 #include <mutex>
+#include <vector>
 #include "MemoryPool.h"
-#include "LinkedList.hpp"
+#include "ThreadSlot.hpp"
 
+#ifndef RESOURCE_ALLOCATOR_MAX_THREADS
+#define RESOURCE_ALLOCATOR_MAX_THREADS 64
+#endif
+#ifndef RESOURCE_ALLOCATOR_MAGAZINE_SIZE
+#define RESOURCE_ALLOCATOR_MAGAZINE_SIZE 16
+#endif
+
+struct ResourceAllocatorStats
+{
+	size_t created;			// Elements constructed by the pool
+	size_t in_use;			// Handed out and not freed yet
+	size_t cached;			// Free, sitting in a thread magazine or the depot
+	uint64_t allocations;
+	uint64_t frees;
+	uint64_t depot_gets;	// Full magazines taken from the depot
+	uint64_t depot_puts;	// Full magazines returned to the depot
+};
+
+// Pooled allocator for the chunk blocks. Free elements are kept in per-thread magazines
+// (small stacks of pointers) so new_element/free_element never lock in the common case.
+// When a thread's magazine runs empty or full it swaps it with the depot, a pair of
+// lock-free stacks of full and empty magazines. Only growing the pool takes the mutex.
 template <class T>
 class ResourceAllocator
 {
+	struct Magazine
+	{
+		std::atomic<Magazine*> next;
+		uint32_t count;
+		T* items[RESOURCE_ALLOCATOR_MAGAZINE_SIZE];
+
+		inline Magazine() : next(0), count(0) {}
+	};
+
+	// Treiber stack. The top 16 bits of the head hold a tag that changes on every update
+	// so a pop can't succeed on a head that was popped and pushed back in between (ABA).
+	// Magazines are only deleted with the allocator, so reading a stale next is safe.
+	class MagazineStack
+	{
+		static_assert(sizeof(void*) == 8, "MagazineStack packs a tag into the upper pointer bits");
+		std::atomic<uint64_t> head;
+
+		static inline Magazine* unpack(uint64_t h) { return (Magazine*)(uintptr_t)(h & 0xFFFFFFFFFFFFull); }
+		static inline uint64_t pack(Magazine* m, uint64_t h) { return (uint64_t)(uintptr_t)m | (((h >> 48) + 1) << 48); }
+
+	public:
+		inline MagazineStack() : head(0) {}
+
+		inline void push(Magazine* m)
+		{
+			uint64_t old_head = head.load(std::memory_order_relaxed);
+			do
+			{
+				m->next.store(unpack(old_head), std::memory_order_relaxed);
+			} while (!head.compare_exchange_weak(old_head, pack(m, old_head), std::memory_order_release, std::memory_order_relaxed));
+		}
+
+		inline Magazine* pop()
+		{
+			uint64_t old_head = head.load(std::memory_order_acquire);
+			Magazine* m;
+			do
+			{
+				m = unpack(old_head);
+				if (!m)
+					return 0;
+			} while (!head.compare_exchange_weak(old_head, pack(m->next.load(std::memory_order_relaxed), old_head), std::memory_order_acquire, std::memory_order_acquire));
+			return m;
+		}
+	};
+
+	// Only ever written by its owning thread; the counters are atomics so stats() can read them.
+	struct alignas(64) ThreadCache
+	{
+		Magazine* loaded;
+		std::atomic<uint64_t> allocations;
+		std::atomic<uint64_t> frees;
+		std::atomic<uint64_t> depot_gets;
+		std::atomic<uint64_t> depot_puts;
+
+		inline ThreadCache() : loaded(0), allocations(0), frees(0), depot_gets(0), depot_puts(0) {}
+	};
+
+	static inline void bump(std::atomic<uint64_t>& counter)
+	{
+		counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
+
 public:
 	inline ResourceAllocator()
 	{
@@ -14,57 +101,117 @@ public:
 
 	inline ~ResourceAllocator()
 	{
-		LinkedNode<T>* n = used_chunks.head;
-		while (n)
+		for (T* c : created)
+			pool.deleteElement(c);
+
+		for (int i = 0; i <= RESOURCE_ALLOCATOR_MAX_THREADS; i++)
+			delete caches[i].loaded;
+		Magazine* m;
+		while ((m = full_magazines.pop()))
+			delete m;
+		while ((m = empty_magazines.pop()))
+			delete m;
+	}
+
+	inline T* new_element()
+	{
+		uint32_t slot = get_thread_slot();
+		if (slot >= RESOURCE_ALLOCATOR_MAX_THREADS)
 		{
-			LinkedNode<T>* next = n->next;
-			pool.deleteElement((T*)n);
-			n = next;
+			std::unique_lock<std::mutex> lock(_mutex);
+			return new_element(caches[RESOURCE_ALLOCATOR_MAX_THREADS], true);
 		}
+		return new_element(caches[slot], false);
+	}
 
-		n = free_chunks.head;
-		while (n)
+	inline void free_element(T* element)
+	{
+		if (!element)
+			return;
+		uint32_t slot = get_thread_slot();
+		if (slot >= RESOURCE_ALLOCATOR_MAX_THREADS)
 		{
-			LinkedNode<T>* next = n->next;
-			pool.deleteElement((T*)n);
-			n = next;
+			std::unique_lock<std::mutex> lock(_mutex);
+			free_element(caches[RESOURCE_ALLOCATOR_MAX_THREADS], element);
+			return;
 		}
+		free_element(caches[slot], element);
 	}
 
-	inline T* new_element(bool no_lock = false)
+	// Counters are read without stopping the other threads, so they are only exact when idle.
+	ResourceAllocatorStats stats()
 	{
-		std::unique_lock<std::mutex> _lock(_mutex, std::defer_lock);
-		if (!no_lock)
-			_lock.lock();
-		if (free_chunks.tail)
+		ResourceAllocatorStats s = {};
+		for (int i = 0; i <= RESOURCE_ALLOCATOR_MAX_THREADS; i++)
 		{
-			T* c = (T*)free_chunks.tail;
-			free_chunks.unlink(c);
-			used_chunks.push_back(c);
-			return c;
+			s.allocations += caches[i].allocations.load(std::memory_order_relaxed);
+			s.frees += caches[i].frees.load(std::memory_order_relaxed);
+			s.depot_gets += caches[i].depot_gets.load(std::memory_order_relaxed);
+			s.depot_puts += caches[i].depot_puts.load(std::memory_order_relaxed);
 		}
-
-		T* c = pool.newElement();
-		used_chunks.push_back(c);
-		return c;
+		s.created = created_count.load(std::memory_order_relaxed);
+		s.in_use = (s.allocations > s.frees ? (size_t)(s.allocations - s.frees) : 0);
+		s.cached = (s.created > s.in_use ? s.created - s.in_use : 0);
+		return s;
 	}
 
-	inline void free_element(T* element, bool no_lock = false)
+	// Guards pool growth, and the shared cache used by threads past RESOURCE_ALLOCATOR_MAX_THREADS
+	std::mutex _mutex;
+
+private:
+	MemoryPool<T> pool;
+	std::vector<T*> created;
+	std::atomic<size_t> created_count = { 0 };
+	MagazineStack full_magazines;
+	MagazineStack empty_magazines;
+	ThreadCache caches[RESOURCE_ALLOCATOR_MAX_THREADS + 1];
+
+	// locked: the caller already holds _mutex (overflow cache)
+	T* new_element(ThreadCache& cache, bool locked)
 	{
-		if (!element)
-			return;
+		bump(cache.allocations);
+
+		Magazine* m = cache.loaded;
+		if (m && m->count)
+			return m->items[--m->count];
+
+		Magazine* full = full_magazines.pop();
+		if (full)
+		{
+			bump(cache.depot_gets);
+			if (m)
+				empty_magazines.push(m);
+			cache.loaded = full;
+			return full->items[--full->count];
+		}
+
 		std::unique_lock<std::mutex> lock(_mutex, std::defer_lock);
-		if (!no_lock)
+		if (!locked)
 			lock.lock();
-		free_chunks.push_back(used_chunks.unlink(element));
-		if (!no_lock)
-			lock.unlock();
+		T* c = pool.newElement();
+		created.push_back(c);
+		created_count.store(created.size(), std::memory_order_relaxed);
+		return c;
 	}
 
-	std::mutex _mutex;
+	void free_element(ThreadCache& cache, T* element)
+	{
+		bump(cache.frees);
 
-private:
-	MemoryPool<T> pool;
-	LinkedList<T> used_chunks;
-	LinkedList<T> free_chunks;
-};
\ No newline at end of file
+		Magazine* m = cache.loaded;
+		if (m && m->count == RESOURCE_ALLOCATOR_MAGAZINE_SIZE)
+		{
+			bump(cache.depot_puts);
+			full_magazines.push(m);
+			m = 0;
+		}
+		if (!m)
+		{
+			m = empty_magazines.pop();
+			if (!m)
+				m = new Magazine();
+			cache.loaded = m;
+		}
+		m->items[m->count++] = element;
+	}
+};
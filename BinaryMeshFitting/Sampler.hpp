@@ -3,36 +3,72 @@
 #include <functional>
 #include <glm/glm.hpp>
 #include <FastNoiseSIMD.h>
+#include "NoiseVectorSet.hpp"
 #include <string>
+#include <atomic>
 
 class SamplerProperties
 {
 public:
-	int thread_id;
-
-	inline SamplerProperties() : thread_id(0) {}
-	inline SamplerProperties(int _thread_id) : thread_id(_thread_id) {}
+	inline SamplerProperties() {}
 	virtual ~SamplerProperties() {};
 
 };
 
 //typedef std::function<float(const float world_size, const glm::vec3& p)> SamplerValueFunction;
 typedef const float(*SamplerValueFunction)(const float world_size, const glm::vec3& p);
-typedef std::function<void(const float world_size, const glm::vec3& p, const glm::ivec3& size, const float scale, void** out, FastNoiseVectorSet* vectorset_out, float* dest_noise, int offset, int stride, SamplerProperties* properties)> SamplerBlockFunction;
+typedef std::function<void(const float world_size, const glm::vec3& p, const glm::ivec3& size, const float scale, void** out, NoiseVectorSet* vectorset_out, float* dest_noise, int offset, int stride, SamplerProperties* properties)> SamplerBlockFunction;
 typedef std::function<glm::vec3(const float world_size, const glm::vec3& p, float h)> SamplerGradientFunction;
+// Samplers whose density is a pure heightfield, density(x, y, z) = columns[x * size.z + z] - (y * scale + p.y) * y_scale,
+// can provide this instead of materializing the whole volume. Fills size.x * size.z columns and returns y_scale.
+typedef std::function<float(const float world_size, const glm::vec3& p, const glm::ivec3& size, const float scale, float* columns, NoiseVectorSet* vectorset_out, SamplerProperties* properties)> SamplerHeightfieldFunction;
+// The same for count footprints at once, p[i] and scale[i] each, in a single noise pass. Footprint i
+// goes to columns + i * size.x * size.z; vectorset_out is resized to exactly that many points.
+typedef std::function<float(const float world_size, const glm::vec3* p, const float* scale, int count, const glm::ivec3& size, float* columns, NoiseVectorSet* vectorset_out, SamplerProperties* properties)> SamplerHeightfieldBatchFunction;
+// Optional conservative bounds of the density over the box [min, max]: every sample taken inside it
+// lies in [out_min, out_max]. Returns false when the sampler can't tell.
+typedef std::function<bool(const float world_size, const glm::vec3& min, const glm::vec3& max, float& out_min, float& out_max, SamplerProperties* properties)> SamplerRangeFunction;
+// Optional bound on how fast the density changes, per world unit moved. 0 when unknown.
+typedef std::function<float(const float world_size, SamplerProperties* properties)> SamplerLipschitzFunction;
+
+// Which density function a sampler evaluates. Part of the cache keys, so the values must stay the
+// same between runs. Functions passed to create_sampler all share SAMPLER_TYPES_CUSTOM.
+enum SAMPLER_TYPES
+{
+	SAMPLER_TYPES_CUSTOM = 0,
+	SAMPLER_TYPES_NOISE_3D = 1,
+	SAMPLER_TYPES_TERRAIN_2D = 2,
+	SAMPLER_TYPES_TERRAIN_PERT_2D = 3,
+	SAMPLER_TYPES_TERRAIN_3D = 4,
+	SAMPLER_TYPES_TERRAIN_PERT_3D = 5,
+	SAMPLER_TYPES_WINDY_3D = 6
+};
 
 struct Sampler
 {
+	uint32_t type;	// SAMPLER_TYPES
 	float world_size;
 	SamplerValueFunction value;
 	SamplerBlockFunction block;
 	SamplerGradientFunction gradient;
-	FastNoiseSIMD* noise_samplers[8];
+	SamplerHeightfieldFunction heightfield;
+	SamplerHeightfieldBatchFunction heightfield_batch;
+	SamplerRangeFunction range;
+	SamplerLipschitzFunction lipschitz;
+	uint32_t noise_id;	// Picks the sampler's noise generators, see JobSystem::get_noise. 0 for samplers without noise.
 
-	inline Sampler() { for (int i = 0; i < 8; i++) noise_samplers[i] = 0; }
+	inline Sampler() : type(SAMPLER_TYPES_CUSTOM), noise_id(0) {}
 	inline virtual ~Sampler() {}
 };
 
+// Ids for Sampler::noise_id, starting at 1. Samplers are made a handful of times per run, so ids
+// aren't reused: a thread keeps the generators of samplers it used until it exits.
+inline uint32_t new_noise_id()
+{
+	static std::atomic<uint32_t> next_id(1);
+	return next_id++;
+}
+
 inline std::string get_simd_text()
 {
 	switch (FastNoiseSIMD::GetSIMDLevel())
@@ -0,0 +1,412 @@
+#include "PCH.h"
+#include "SignMask.hpp"
+
+#include <FastNoiseSIMD.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SIGN_MASK_X86 1
+#include <immintrin.h>
+#else
+#define SIGN_MASK_X86 0
+#endif
+
+// MSVC lets any function use any intrinsic, GCC/Clang need the target spelled out
+#ifdef _MSC_VER
+#define SIGN_MASK_TARGET(x)
+#else
+#define SIGN_MASK_TARGET(x) __attribute__((target(x)))
+#endif
+
+#define SIGN_MASK_CLASS(any_positive, any_negative) ((any_positive ? SIGN_MASK_CLASSES_POSITIVE : 0) | (any_negative ? SIGN_MASK_CLASSES_NEGATIVE : 0))
+
+using namespace SignMask;
+
+static inline uint32_t word_length(uint32_t row_length, uint32_t word)
+{
+	uint32_t z_max = row_length - word * 32;
+	return (z_max > 32 ? 32 : z_max);
+}
+
+static inline uint32_t full_mask(uint32_t z_max)
+{
+	return (z_max == 32 ? 0xFFFFFFFF : (1u << z_max) - 1);
+}
+
+static uint32_t label_scalar(const float* samples, uint32_t rows, uint32_t row_length, uint32_t* out)
+{
+	uint32_t words = (row_length + 31) / 32;
+	uint32_t any_negative = 0, any_positive = 0;
+	for (uint32_t r = 0; r < rows; r++)
+	{
+		const float* row = samples + (size_t)r * row_length;
+		for (uint32_t w = 0; w < words; w++)
+		{
+			const float* s = row + w * 32;
+			uint32_t z_max = word_length(row_length, w);
+			uint32_t m = 0;
+			for (uint32_t z = 0; z < z_max; z++)
+			{
+				if (s[z] < 0.0f)
+					m |= 1u << z;
+			}
+			any_negative |= m;
+			any_positive |= ~m & full_mask(z_max);
+			*out++ = m;
+		}
+	}
+	return SIGN_MASK_CLASS(any_positive, any_negative);
+}
+
+// Heightfield rows: one row of columns against a single y value t, optionally storing densities
+typedef uint32_t(*HeightfieldRowFunction)(const float* columns, uint32_t row_length, float t, uint32_t* out, float* density);
+
+static uint32_t heightfield_row_scalar(const float* columns, uint32_t row_length, float t, uint32_t* out, float* density)
+{
+	uint32_t words = (row_length + 31) / 32;
+	uint32_t any_negative = 0, any_positive = 0;
+	for (uint32_t w = 0; w < words; w++)
+	{
+		const float* c = columns + w * 32;
+		uint32_t z_max = word_length(row_length, w);
+		uint32_t m = 0;
+		for (uint32_t z = 0; z < z_max; z++)
+		{
+			float d = c[z] - t;
+			if (density)
+				density[w * 32 + z] = d;
+			if (d < 0.0f)
+				m |= 1u << z;
+		}
+		any_negative |= m;
+		any_positive |= ~m & full_mask(z_max);
+		out[w] = m;
+	}
+	return SIGN_MASK_CLASS(any_positive, any_negative);
+}
+
+static inline void column_range(const float* columns, uint32_t count, float& lo, float& hi)
+{
+	lo = columns[0];
+	hi = columns[0];
+	for (uint32_t i = 1; i < count; i++)
+	{
+		lo = (columns[i] < lo ? columns[i] : lo);
+		hi = (columns[i] > hi ? columns[i] : hi);
+	}
+}
+
+static uint32_t label_heightfield_rows(HeightfieldRowFunction row, const float* columns, uint32_t dim, float y_origin, float y_step, float y_scale, uint32_t* out, float* density)
+{
+	uint32_t words = (dim + 31) / 32;
+	uint32_t result = 0;
+
+	float lo_prev = 0.0f, hi_prev = 0.0f, lo_next = 0.0f, hi_next = 0.0f;
+	float lo, hi;
+	column_range(columns, dim, lo, hi);
+	for (uint32_t x = 0; x < dim; x++)
+	{
+		const float* row_columns = columns + (size_t)x * dim;
+		if (x + 1 < dim)
+			column_range(row_columns + dim, dim, lo_next, hi_next);
+
+		// A sign change along x or y involves this slice or its neighbours
+		float band_lo = lo, band_hi = hi;
+		if (x > 0)
+		{
+			band_lo = (lo_prev < band_lo ? lo_prev : band_lo);
+			band_hi = (hi_prev > band_hi ? hi_prev : band_hi);
+		}
+		if (x + 1 < dim)
+		{
+			band_lo = (lo_next < band_lo ? lo_next : band_lo);
+			band_hi = (hi_next > band_hi ? hi_next : band_hi);
+		}
+
+		for (uint32_t y = 0; y < dim; y++)
+		{
+			float t = ((float)y * y_step + y_origin) * y_scale;
+			float t_below = ((float)(y > 0 ? y - 1 : y) * y_step + y_origin) * y_scale;
+			float t_above = ((float)(y + 1 < dim ? y + 1 : y) * y_step + y_origin) * y_scale;
+			uint32_t* row_out = out + ((size_t)x * dim + y) * words;
+			bool near_surface = density && band_lo < t_above && band_hi >= t_below;
+
+			if (!near_surface && t <= lo)
+			{
+				for (uint32_t w = 0; w < words; w++)
+					row_out[w] = 0;
+				result |= SIGN_MASK_CLASSES_POSITIVE;
+			}
+			else if (!near_surface && t > hi)
+			{
+				for (uint32_t w = 0; w < words; w++)
+					row_out[w] = full_mask(word_length(dim, w));
+				result |= SIGN_MASK_CLASSES_NEGATIVE;
+			}
+			else
+				result |= row(row_columns, dim, t, row_out, near_surface ? density + ((size_t)x * dim + y) * dim : 0);
+		}
+
+		lo_prev = lo;
+		hi_prev = hi;
+		lo = lo_next;
+		hi = hi_next;
+	}
+	return result;
+}
+
+static uint32_t label_heightfield_scalar(const float* columns, uint32_t dim, float y_origin, float y_step, float y_scale, uint32_t* out, float* density)
+{
+	return label_heightfield_rows(heightfield_row_scalar, columns, dim, y_origin, y_step, y_scale, out, density);
+}
+
+#if SIGN_MASK_X86
+SIGN_MASK_TARGET("sse2")
+static uint32_t label_sse2(const float* samples, uint32_t rows, uint32_t row_length, uint32_t* out)
+{
+	const __m128 zero = _mm_setzero_ps();
+	uint32_t words = (row_length + 31) / 32;
+	uint32_t any_negative = 0, any_positive = 0;
+	for (uint32_t r = 0; r < rows; r++)
+	{
+		const float* row = samples + (size_t)r * row_length;
+		for (uint32_t w = 0; w < words; w++)
+		{
+			const float* s = row + w * 32;
+			uint32_t z_max = word_length(row_length, w);
+			uint32_t m = 0, z = 0;
+			for (; z + 4 <= z_max; z += 4)
+				m |= (uint32_t)_mm_movemask_ps(_mm_cmplt_ps(_mm_loadu_ps(s + z), zero)) << z;
+			for (; z < z_max; z++)
+			{
+				if (s[z] < 0.0f)
+					m |= 1u << z;
+			}
+			any_negative |= m;
+			any_positive |= ~m & full_mask(z_max);
+			*out++ = m;
+		}
+	}
+	return SIGN_MASK_CLASS(any_positive, any_negative);
+}
+
+SIGN_MASK_TARGET("avx2")
+static uint32_t label_avx2(const float* samples, uint32_t rows, uint32_t row_length, uint32_t* out)
+{
+	const __m256 zero = _mm256_setzero_ps();
+	uint32_t words = (row_length + 31) / 32;
+	uint32_t any_negative = 0, any_positive = 0;
+	for (uint32_t r = 0; r < rows; r++)
+	{
+		const float* row = samples + (size_t)r * row_length;
+		for (uint32_t w = 0; w < words; w++)
+		{
+			const float* s = row + w * 32;
+			uint32_t z_max = word_length(row_length, w);
+			uint32_t m = 0, z = 0;
+			for (; z + 8 <= z_max; z += 8)
+				m |= (uint32_t)_mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(s + z), zero, _CMP_LT_OQ)) << z;
+			for (; z < z_max; z++)
+			{
+				if (s[z] < 0.0f)
+					m |= 1u << z;
+			}
+			any_negative |= m;
+			any_positive |= ~m & full_mask(z_max);
+			*out++ = m;
+		}
+	}
+	return SIGN_MASK_CLASS(any_positive, any_negative);
+}
+
+SIGN_MASK_TARGET("avx512f")
+static uint32_t label_avx512(const float* samples, uint32_t rows, uint32_t row_length, uint32_t* out)
+{
+	const __m512 zero = _mm512_setzero_ps();
+	uint32_t words = (row_length + 31) / 32;
+	uint32_t any_negative = 0, any_positive = 0;
+	for (uint32_t r = 0; r < rows; r++)
+	{
+		const float* row = samples + (size_t)r * row_length;
+		for (uint32_t w = 0; w < words; w++)
+		{
+			const float* s = row + w * 32;
+			uint32_t z_max = word_length(row_length, w);
+			uint32_t m = 0, z = 0;
+			for (; z + 16 <= z_max; z += 16)
+				m |= (uint32_t)_mm512_cmp_ps_mask(_mm512_loadu_ps(s + z), zero, _CMP_LT_OQ) << z;
+			for (; z < z_max; z++)
+			{
+				if (s[z] < 0.0f)
+					m |= 1u << z;
+			}
+			any_negative |= m;
+			any_positive |= ~m & full_mask(z_max);
+			*out++ = m;
+		}
+	}
+	return SIGN_MASK_CLASS(any_positive, any_negative);
+}
+
+SIGN_MASK_TARGET("sse2")
+static uint32_t heightfield_row_sse2(const float* columns, uint32_t row_length, float t, uint32_t* out, float* density)
+{
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 tv = _mm_set1_ps(t);
+	uint32_t words = (row_length + 31) / 32;
+	uint32_t any_negative = 0, any_positive = 0;
+	for (uint32_t w = 0; w < words; w++)
+	{
+		const float* c = columns + w * 32;
+		float* d_out = (density ? density + w * 32 : 0);
+		uint32_t z_max = word_length(row_length, w);
+		uint32_t m = 0, z = 0;
+		for (; z + 4 <= z_max; z += 4)
+		{
+			__m128 d = _mm_sub_ps(_mm_loadu_ps(c + z), tv);
+			if (d_out)
+				_mm_storeu_ps(d_out + z, d);
+			m |= (uint32_t)_mm_movemask_ps(_mm_cmplt_ps(d, zero)) << z;
+		}
+		for (; z < z_max; z++)
+		{
+			float d = c[z] - t;
+			if (d_out)
+				d_out[z] = d;
+			if (d < 0.0f)
+				m |= 1u << z;
+		}
+		any_negative |= m;
+		any_positive |= ~m & full_mask(z_max);
+		out[w] = m;
+	}
+	return SIGN_MASK_CLASS(any_positive, any_negative);
+}
+
+SIGN_MASK_TARGET("avx2")
+static uint32_t heightfield_row_avx2(const float* columns, uint32_t row_length, float t, uint32_t* out, float* density)
+{
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 tv = _mm256_set1_ps(t);
+	uint32_t words = (row_length + 31) / 32;
+	uint32_t any_negative = 0, any_positive = 0;
+	for (uint32_t w = 0; w < words; w++)
+	{
+		const float* c = columns + w * 32;
+		float* d_out = (density ? density + w * 32 : 0);
+		uint32_t z_max = word_length(row_length, w);
+		uint32_t m = 0, z = 0;
+		for (; z + 8 <= z_max; z += 8)
+		{
+			__m256 d = _mm256_sub_ps(_mm256_loadu_ps(c + z), tv);
+			if (d_out)
+				_mm256_storeu_ps(d_out + z, d);
+			m |= (uint32_t)_mm256_movemask_ps(_mm256_cmp_ps(d, zero, _CMP_LT_OQ)) << z;
+		}
+		for (; z < z_max; z++)
+		{
+			float d = c[z] - t;
+			if (d_out)
+				d_out[z] = d;
+			if (d < 0.0f)
+				m |= 1u << z;
+		}
+		any_negative |= m;
+		any_positive |= ~m & full_mask(z_max);
+		out[w] = m;
+	}
+	return SIGN_MASK_CLASS(any_positive, any_negative);
+}
+
+SIGN_MASK_TARGET("avx512f")
+static uint32_t heightfield_row_avx512(const float* columns, uint32_t row_length, float t, uint32_t* out, float* density)
+{
+	const __m512 zero = _mm512_setzero_ps();
+	const __m512 tv = _mm512_set1_ps(t);
+	uint32_t words = (row_length + 31) / 32;
+	uint32_t any_negative = 0, any_positive = 0;
+	for (uint32_t w = 0; w < words; w++)
+	{
+		const float* c = columns + w * 32;
+		float* d_out = (density ? density + w * 32 : 0);
+		uint32_t z_max = word_length(row_length, w);
+		uint32_t m = 0, z = 0;
+		for (; z + 16 <= z_max; z += 16)
+		{
+			__m512 d = _mm512_sub_ps(_mm512_loadu_ps(c + z), tv);
+			if (d_out)
+				_mm512_storeu_ps(d_out + z, d);
+			m |= (uint32_t)_mm512_cmp_ps_mask(d, zero, _CMP_LT_OQ) << z;
+		}
+		for (; z < z_max; z++)
+		{
+			float d = c[z] - t;
+			if (d_out)
+				d_out[z] = d;
+			if (d < 0.0f)
+				m |= 1u << z;
+		}
+		any_negative |= m;
+		any_positive |= ~m & full_mask(z_max);
+		out[w] = m;
+	}
+	return SIGN_MASK_CLASS(any_positive, any_negative);
+}
+
+static uint32_t label_heightfield_sse2(const float* columns, uint32_t dim, float y_origin, float y_step, float y_scale, uint32_t* out, float* density)
+{
+	return label_heightfield_rows(heightfield_row_sse2, columns, dim, y_origin, y_step, y_scale, out, density);
+}
+
+static uint32_t label_heightfield_avx2(const float* columns, uint32_t dim, float y_origin, float y_step, float y_scale, uint32_t* out, float* density)
+{
+	return label_heightfield_rows(heightfield_row_avx2, columns, dim, y_origin, y_step, y_scale, out, density);
+}
+
+static uint32_t label_heightfield_avx512(const float* columns, uint32_t dim, float y_origin, float y_step, float y_scale, uint32_t* out, float* density)
+{
+	return label_heightfield_rows(heightfield_row_avx512, columns, dim, y_origin, y_step, y_scale, out, density);
+}
+#endif
+
+int SignMask::get_simd_level()
+{
+	return FastNoiseSIMD::GetSIMDLevel();
+}
+
+LabelFunction SignMask::get_label_function()
+{
+#if SIGN_MASK_X86
+	switch (get_simd_level())
+	{
+	case FN_AVX512:
+		return label_avx512;
+	case FN_AVX2:
+		return label_avx2;
+	case FN_SSE41:
+	case FN_SSE2:
+		return label_sse2;
+	default:
+		break;
+	}
+#endif
+	return label_scalar;
+}
+
+HeightfieldFunction SignMask::get_heightfield_function()
+{
+#if SIGN_MASK_X86
+	switch (get_simd_level())
+	{
+	case FN_AVX512:
+		return label_heightfield_avx512;
+	case FN_AVX2:
+		return label_heightfield_avx2;
+	case FN_SSE41:
+	case FN_SSE2:
+		return label_heightfield_sse2;
+	default:
+		break;
+	}
+#endif
+	return label_heightfield_scalar;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+
+// Turns rows of densities into 32-bit sign words (bit z set when sample z < 0), the
+// format BinaryBlock stores. The instruction set is picked once at runtime from
+// FastNoiseSIMD::GetSIMDLevel so it always matches what the noise is generated with.
+namespace SignMask
+{
+	enum SIGN_MASK_CLASSES
+	{
+		SIGN_MASK_CLASSES_EMPTY = 0,
+		SIGN_MASK_CLASSES_POSITIVE = 1,
+		SIGN_MASK_CLASSES_NEGATIVE = 2,
+		SIGN_MASK_CLASSES_MIXED = 3
+	};
+
+	// rows: number of rows, row_length: samples per row (rows are packed back to back)
+	// out: receives (row_length + 31) / 32 words per row
+	// Returns a SIGN_MASK_CLASSES value, MIXED meaning the rows contain both signs.
+	typedef uint32_t(*LabelFunction)(const float* samples, uint32_t rows, uint32_t row_length, uint32_t* out);
+
+	// Same output for a dim^3 block whose density is a heightfield,
+	// density(x, y, z) = columns[x * dim + z] - (y * y_step + y_origin) * y_scale, y_scale > 0.
+	// Rows entirely above or below the surface are filled without looking at the samples. When
+	// density is set, the rows that can hold the end of a sign changing edge get their densities
+	// written and every other row is left untouched.
+	typedef uint32_t(*HeightfieldFunction)(const float* columns, uint32_t dim, float y_origin, float y_step, float y_scale, uint32_t* out, float* density);
+
+	LabelFunction get_label_function();
+	HeightfieldFunction get_heightfield_function();
+	int get_simd_level();
+
+	inline uint32_t label(const float* samples, uint32_t rows, uint32_t row_length, uint32_t* out)
+	{
+		static const LabelFunction f = get_label_function();
+		return f(samples, rows, row_length, out);
+	}
+
+	inline uint32_t label_heightfield(const float* columns, uint32_t dim, float y_origin, float y_step, float y_scale, uint32_t* out, float* density)
+	{
+		static const HeightfieldFunction f = get_heightfield_function();
+		return f(columns, dim, y_origin, y_step, y_scale, out, density);
+	}
+}
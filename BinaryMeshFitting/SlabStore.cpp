@@ -0,0 +1,201 @@
+#include "PCH.h"
+#include "SlabStore.hpp"
+
+#include <cstring>
+#include <vector>
+
+// Copies one layer of a density block (laid out (x * dim + y) * dim + z) to or from a dim * dim slab
+static void copy_layer(float* density, uint32_t dim, int axis, uint32_t layer, float* slab, bool to_slab)
+{
+	if (axis == 0)
+	{
+		float* d = density + layer * dim * dim;
+		if (to_slab)
+			memcpy(slab, d, sizeof(float) * dim * dim);
+		else
+			memcpy(d, slab, sizeof(float) * dim * dim);
+		return;
+	}
+
+	for (uint32_t x = 0; x < dim; x++)
+	{
+		if (axis == 1)
+		{
+			float* d = density + (x * dim + layer) * dim;
+			if (to_slab)
+				memcpy(slab + x * dim, d, sizeof(float) * dim);
+			else
+				memcpy(d, slab + x * dim, sizeof(float) * dim);
+			continue;
+		}
+
+		for (uint32_t y = 0; y < dim; y++)
+		{
+			float* d = density + (x * dim + y) * dim + layer;
+			if (to_slab)
+				slab[x * dim + y] = *d;
+			else
+				*d = slab[x * dim + y];
+		}
+	}
+}
+
+SlabStore::SlabStore() : max_bytes(0), bytes(0), hits(0), misses(0), inserts(0), evictions(0)
+{
+}
+
+SlabStore::~SlabStore()
+{
+	clear();
+}
+
+void SlabStore::init(size_t _max_bytes)
+{
+	clear();
+	std::unique_lock<std::mutex> lock(_mutex);
+	max_bytes = _max_bytes;
+}
+
+bool SlabStore::get_neighbour_code(uint64_t morton_code, int axis, int dir, uint64_t& out_code)
+{
+	if (!morton_code)
+		return false;
+
+	// Three bits per level below the leading 1, the deepest level last
+	int top = 63;
+	while (!(morton_code >> top))
+		top--;
+	int levels = top / 3;
+
+	uint64_t c = 0;
+	for (int l = 0; l < levels; l++)
+		c |= ((morton_code >> (l * 3 + axis)) & 1) << l;
+	if ((dir < 0 && c == 0) || (dir > 0 && c + 1 >= (1ull << levels)))
+		return false;
+	c += dir;
+
+	out_code = morton_code;
+	for (int l = 0; l < levels; l++)
+	{
+		out_code &= ~(1ull << (l * 3 + axis));
+		out_code |= ((c >> l) & 1) << (l * 3 + axis);
+	}
+	return true;
+}
+
+uint32_t SlabStore::take(uint64_t sample_key, uint64_t morton_code, float* density, uint32_t dim, float scale)
+{
+	if (!max_bytes)
+		return 0;
+
+	// Faces are moved out under the lock and copied after
+	std::vector<Entry> found;
+	std::vector<uint32_t> found_sides;
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		for (int side = 0; side < 6; side++)
+		{
+			int axis = side / 2;
+			bool high = (side & 1) != 0;
+			uint64_t low_code = morton_code;
+			if (!high && !get_neighbour_code(morton_code, axis, -1, low_code))
+				continue;
+
+			Key key;
+			key.sample_key = sample_key;
+			key.face_code = (low_code << 2) | (uint64_t)axis;
+			auto search = lookup.find(key);
+			if (search == lookup.end() || search->second->dim != dim || search->second->scale != scale)
+			{
+				misses++;
+				continue;
+			}
+			found.push_back(*search->second);
+			found_sides.push_back(side);
+			bytes -= search->second->bytes;
+			entries.erase(search->second);
+			lookup.erase(search);
+			hits++;
+		}
+	}
+
+	uint32_t taken = 0;
+	for (size_t i = 0; i < found.size(); i++)
+	{
+		int axis = found_sides[i] / 2;
+		bool high = (found_sides[i] & 1) != 0;
+		copy_layer(density, dim, axis, (high ? dim - 1 : 0), found[i].data, false);
+		_aligned_free(found[i].data);
+		taken |= 1u << found_sides[i];
+	}
+	return taken;
+}
+
+void SlabStore::put(uint64_t sample_key, uint64_t morton_code, const float* density, uint32_t dim, float scale, uint32_t taken)
+{
+	if (!max_bytes)
+		return;
+
+	for (int side = 0; side < 6; side++)
+	{
+		int axis = side / 2;
+		bool high = (side & 1) != 0;
+		// The neighbour sampled its side of a taken face already
+		uint64_t neighbour_code;
+		if ((taken & (1u << side)) || !get_neighbour_code(morton_code, axis, (high ? 1 : -1), neighbour_code))
+			continue;
+
+		Entry e;
+		e.key.sample_key = sample_key;
+		e.key.face_code = ((high ? morton_code : neighbour_code) << 2) | (uint64_t)axis;
+		e.dim = dim;
+		e.scale = scale;
+		e.data = (float*)_aligned_malloc(sizeof(float) * dim * dim, 16);
+		e.bytes = sizeof(Entry) + sizeof(float) * dim * dim;
+		copy_layer((float*)density, dim, axis, (high ? dim - 1 : 0), e.data, true);
+
+		std::unique_lock<std::mutex> lock(_mutex);
+		auto search = lookup.find(e.key);
+		if (search != lookup.end())
+			erase(search->second);
+
+		entries.push_front(e);
+		lookup[e.key] = entries.begin();
+		bytes += e.bytes;
+		inserts++;
+
+		while (bytes > max_bytes && !entries.empty())
+		{
+			erase(std::prev(entries.end()));
+			evictions++;
+		}
+	}
+}
+
+void SlabStore::clear()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	while (!entries.empty())
+		erase(entries.begin());
+}
+
+SlabStoreStats SlabStore::stats()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	SlabStoreStats s;
+	s.hits = hits;
+	s.misses = misses;
+	s.inserts = inserts;
+	s.evictions = evictions;
+	s.slabs = entries.size();
+	s.bytes = bytes;
+	return s;
+}
+
+void SlabStore::erase(std::list<Entry>::iterator it)
+{
+	_aligned_free(it->data);
+	bytes -= it->bytes;
+	lookup.erase(it->key);
+	entries.erase(it);
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+
+struct SlabStoreStats
+{
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t inserts;
+	uint64_t evictions;
+	size_t slabs;
+	size_t bytes;
+};
+
+// Face layers of recently sampled chunks, so a neighbour at the same level skips sampling them again.
+// Grids only meet on a face without overlap: the last layer of one chunk is then the first layer of
+// the next. A face is keyed by the Morton code of the chunk on its low side, the axis it lies across
+// and the key of the settings the samples depend on (see BlockLRU). Each is handed out once, to the
+// second of its two chunks; bounded by bytes, the least recently stored faces are freed first.
+class SlabStore
+{
+public:
+	SlabStore();
+	~SlabStore();
+
+	void init(size_t max_bytes);
+	inline bool is_enabled() const { return max_bytes > 0; }
+
+	// Copies the faces stored by neighbours into the matching layers of density. Returns which were
+	// filled, bit axis * 2 for the low layer and axis * 2 + 1 for the high one.
+	uint32_t take(uint64_t sample_key, uint64_t morton_code, float* density, uint32_t dim, float scale);
+	// Stores the faces of fully sampled densities that weren't taken and have a neighbour
+	void put(uint64_t sample_key, uint64_t morton_code, const float* density, uint32_t dim, float scale, uint32_t taken);
+	void clear();
+
+	SlabStoreStats stats();
+
+	// The Morton code of the node one step along axis (dir -1 or 1) at the same level, false past the world
+	static bool get_neighbour_code(uint64_t morton_code, int axis, int dir, uint64_t& out_code);
+
+private:
+	struct Key
+	{
+		uint64_t sample_key;
+		uint64_t face_code;	// Morton code of the low side chunk, shifted left 2, plus the axis
+
+		inline bool operator==(const Key& other) const { return sample_key == other.sample_key && face_code == other.face_code; }
+	};
+
+	struct KeyHash
+	{
+		inline size_t operator()(const Key& k) const { return (size_t)(k.face_code * 0x9E3779B97F4A7C15ull ^ k.sample_key); }
+	};
+
+	struct Entry
+	{
+		Key key;
+		uint32_t dim;
+		float scale;
+		float* data;
+		size_t bytes;
+	};
+
+	std::mutex _mutex;
+	size_t max_bytes;
+	size_t bytes;
+	std::list<Entry> entries;	// Most recent first
+	std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> lookup;
+
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t inserts;
+	uint64_t evictions;
+
+	void erase(std::list<Entry>::iterator it);
+};
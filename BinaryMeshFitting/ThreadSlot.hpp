@@ -0,0 +1,68 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Small, stable per-thread index. omp_get_thread_num() restarts at 0 in every team and
+// is 0 for every non-OpenMP thread (watcher, render), so it can't key per-thread state
+// that is shared between those. A thread's slot is handed back when it exits and the
+// lowest free one is reused, so the slots stay below the number of live threads no matter
+// how often the job system or OpenMP recreate theirs.
+class ThreadSlots
+{
+public:
+	static inline uint32_t acquire()
+	{
+		ThreadSlots& s = get();
+		std::unique_lock<std::mutex> lock(s._mutex);
+		if (s.free_slots.empty())
+			return s.next_slot++;
+		auto lowest = std::min_element(s.free_slots.begin(), s.free_slots.end());
+		uint32_t slot = *lowest;
+		*lowest = s.free_slots.back();
+		s.free_slots.pop_back();
+		return slot;
+	}
+
+	static inline void release(uint32_t slot)
+	{
+		ThreadSlots& s = get();
+		std::unique_lock<std::mutex> lock(s._mutex);
+		s.free_slots.push_back(slot);
+	}
+
+private:
+	std::mutex _mutex;
+	std::vector<uint32_t> free_slots;
+	uint32_t next_slot;
+
+	inline ThreadSlots() : next_slot(0) {}
+
+	// Constructed before the first thread's holder, so it outlives all of them
+	static inline ThreadSlots& get()
+	{
+		static ThreadSlots slots;
+		return slots;
+	}
+};
+
+// Owns the calling thread's slot while the thread runs. Whatever was kept under the slot
+// (e.g. a ResourceAllocator magazine) is left for the next thread to get it.
+struct ThreadSlotHolder
+{
+	uint32_t slot;
+
+	inline ThreadSlotHolder() : slot(ThreadSlots::acquire()) {}
+	inline ~ThreadSlotHolder() { ThreadSlots::release(slot); }
+
+	ThreadSlotHolder(const ThreadSlotHolder&) = delete;
+	ThreadSlotHolder& operator=(const ThreadSlotHolder&) = delete;
+};
+
+inline uint32_t get_thread_slot()
+{
+	thread_local ThreadSlotHolder holder;
+	return holder.slot;
+}
@@ -0,0 +1,431 @@
+#include "PCH.h"
+#include "WorldOctree.hpp"
+#include "WorldOctreeNode.hpp"
+#include "ChunkGenerator.hpp"
+#include "DMCChunk.hpp"
+#include "MeshArchive.hpp"
+#include "DefaultOptions.h"
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <thread>
+#include <omp.h>
+
+// Headless batch mesher. Builds either an LOD snapshot around a focus point or a uniform
+// grid of chunks covering a region, runs the regular chunk pipeline on N threads and
+// writes every chunk into a single OBJ file in world space.
+
+// Deepest level a 64-bit Morton code has room for, 3 bits a level below the leading 1
+#define BATCH_MAX_LEVEL 21
+
+enum BATCH_MODES
+{
+	BATCH_MODES_LOD = 0,
+	BATCH_MODES_REGION = 1
+};
+
+struct BatchOptions
+{
+	int mode;
+	glm::vec3 focus;
+	glm::vec3 region_min;
+	glm::vec3 region_max;
+	int level;
+	int world_size;
+	int min_level;
+	int max_level;
+	int resolution;
+	int far_resolution;
+	int iters;
+	float overlap;
+	int threads;
+	std::string cache;
+	std::string baked;
+	std::string output;
+
+	BatchOptions()
+	{
+		WorldProperties defaults;
+		mode = BATCH_MODES_LOD;
+		focus = glm::vec3(0, 0, 0);
+		region_min = glm::vec3(0, 0, 0);
+		region_max = glm::vec3(0, 0, 0);
+		level = -1;
+		world_size = 256;
+		min_level = defaults.min_level;
+		max_level = defaults.max_level;
+		resolution = defaults.chunk_resolution;
+		far_resolution = 0;
+		iters = defaults.process_iters;
+		overlap = defaults.overlap;
+		threads = (int)std::thread::hardware_concurrency();
+	}
+};
+
+static void print_usage()
+{
+	using namespace std;
+	cout << "Usage: bmf_mesh [options] <output.obj>" << endl << endl;
+	cout << "Options:" << endl;
+	cout << "  --mode <lod|region>          LOD snapshot around --focus (default) or a uniform grid over --region" << endl;
+	cout << "  --focus <x,y,z>              Focus point of the LOD snapshot (default 0,0,0)" << endl;
+	cout << "  --region <x0,y0,z0,x1,y1,z1> World space bounds to mesh in region mode" << endl;
+	cout << "  --level <n>                  Octree level of the region chunks, up to the max level (default max level)" << endl;
+	cout << "  --size <n>                   Half extent of the world (default 256)" << endl;
+	cout << "  --min-level <n>              Minimum octree level" << endl;
+	cout << "  --max-level <n>              Maximum octree level" << endl;
+	cout << "  --resolution <n>             Chunk resolution" << endl;
+	cout << "  --far-resolution <n>         Chunk resolution of every level but the two finest (default --resolution)" << endl;
+	cout << "  --iters <n>                  Mesh processing iterations" << endl;
+	cout << "  --overlap <f>                Chunk overlap" << endl;
+	cout << "  --threads <n>                Worker threads (default all cores)" << endl;
+	cout << "  --cache <dir>                Reuse/store finished chunk meshes in this directory" << endl;
+	cout << "  --baked <dir>                Load chunk meshes from the tiles bmf_bake wrote to this directory" << endl;
+}
+
+static bool parse_floats(const char* s, float* out, int count)
+{
+	for (int i = 0; i < count; i++)
+	{
+		char* end;
+		out[i] = strtof(s, &end);
+		if (end == s)
+			return false;
+		s = end;
+		if (i < count - 1)
+		{
+			if (*s != ',')
+				return false;
+			s++;
+		}
+	}
+	return *s == 0;
+}
+
+static bool parse_options(int argc, char** argv, BatchOptions& opts)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		const char* arg = argv[i];
+		const char* next = (i + 1 < argc ? argv[i + 1] : 0);
+		bool has_value = true;
+
+		if (!strcmp(arg, "--help") || !strcmp(arg, "-h"))
+			return false;
+
+		if (arg[0] != '-')
+		{
+			opts.output = arg;
+			continue;
+		}
+		if (!next)
+		{
+			std::cout << "Missing value for " << arg << "." << std::endl;
+			return false;
+		}
+
+		if (!strcmp(arg, "--mode"))
+		{
+			if (!strcmp(next, "lod"))
+				opts.mode = BATCH_MODES_LOD;
+			else if (!strcmp(next, "region"))
+				opts.mode = BATCH_MODES_REGION;
+			else
+				has_value = false;
+		}
+		else if (!strcmp(arg, "--focus"))
+			has_value = parse_floats(next, &opts.focus.x, 3);
+		else if (!strcmp(arg, "--region"))
+		{
+			float r[6];
+			has_value = parse_floats(next, r, 6);
+			opts.region_min = glm::vec3(glm::min(r[0], r[3]), glm::min(r[1], r[4]), glm::min(r[2], r[5]));
+			opts.region_max = glm::vec3(glm::max(r[0], r[3]), glm::max(r[1], r[4]), glm::max(r[2], r[5]));
+		}
+		else if (!strcmp(arg, "--level"))
+		{
+			opts.level = atoi(next);
+			has_value = (opts.level >= 0);
+		}
+		else if (!strcmp(arg, "--size"))
+			opts.world_size = atoi(next);
+		else if (!strcmp(arg, "--min-level"))
+			opts.min_level = atoi(next);
+		else if (!strcmp(arg, "--max-level"))
+			opts.max_level = atoi(next);
+		else if (!strcmp(arg, "--resolution"))
+			opts.resolution = atoi(next);
+		else if (!strcmp(arg, "--far-resolution"))
+			opts.far_resolution = atoi(next);
+		else if (!strcmp(arg, "--iters"))
+			opts.iters = atoi(next);
+		else if (!strcmp(arg, "--overlap"))
+			opts.overlap = (float)atof(next);
+		else if (!strcmp(arg, "--threads"))
+			opts.threads = atoi(next);
+		else if (!strcmp(arg, "--cache"))
+			opts.cache = next;
+		else if (!strcmp(arg, "--baked"))
+			opts.baked = next;
+		else
+		{
+			std::cout << "Unknown option " << arg << "." << std::endl;
+			return false;
+		}
+
+		if (!has_value)
+		{
+			std::cout << "Invalid value for " << arg << ": " << next << std::endl;
+			return false;
+		}
+		i++;
+	}
+
+	if (opts.output.empty())
+		return false;
+	if (opts.level < 0)
+		opts.level = opts.max_level;
+	int max_level = glm::min(BATCH_MAX_LEVEL, opts.max_level);
+	if (opts.level > max_level)
+	{
+		std::cout << "--level must be between 0 and " << max_level << "." << std::endl;
+		return false;
+	}
+	if (opts.threads < 1)
+		opts.threads = 1;
+	return true;
+}
+
+static void gather_lod(WorldOctree& world, const BatchOptions& opts, SmartContainer<WorldOctreeNode*>& batch)
+{
+	world.focus_point = opts.focus;
+	world.watcher.focus_pos = opts.focus;
+	world.split_leaves();
+
+	for (auto& n : world.leaves)
+	{
+		n->generation_stage = GENERATION_STAGES_GENERATING;
+		batch.push_back(n);
+	}
+}
+
+static void gather_region(WorldOctree& world, const BatchOptions& opts, SmartContainer<WorldOctreeNode*>& batch)
+{
+	using namespace glm;
+	int level = opts.level;
+	int cells = 1 << level;
+	float root_size = world.octree.size;
+	vec3 root_pos = world.octree.pos;
+	float c_size = root_size / (float)cells;
+
+	ivec3 start = ivec3(floor((opts.region_min - root_pos) / c_size));
+	ivec3 end = ivec3(ceil((opts.region_max - root_pos) / c_size));
+	start = clamp(start, ivec3(0), ivec3(cells));
+	end = clamp(end, ivec3(0), ivec3(cells));
+
+	world.next_chunk_id = 0;
+	for (int x = start.x; x < end.x; x++)
+	{
+		for (int y = start.y; y < end.y; y++)
+		{
+			for (int z = start.z; z < end.z; z++)
+			{
+				vec3 pos = root_pos + vec3((float)x, (float)y, (float)z) * c_size;
+				WorldOctreeNode* n = world.node_pool.newElement(0, nullptr, c_size, pos, (uint8_t)level);
+
+				uint64_t code = 1;
+				for (int b = level - 1; b >= 0; b--)
+					code = (code << 3) | ((x >> b) & 1) | (((y >> b) & 1) << 1) | (((z >> b) & 1) << 2);
+				n->morton_code = code;
+
+				world.create_chunk(n);
+				n->generation_stage = GENERATION_STAGES_GENERATING;
+				batch.push_back(n);
+			}
+		}
+	}
+}
+
+static bool write_obj(const std::string& filename, SmartContainer<WorldOctreeNode*>& batch, size_t& v_total, size_t& p_total)
+{
+	FILE* f = fopen(filename.c_str(), "wb");
+	if (!f)
+		return false;
+
+	static char buffer[1 << 20];
+	setvbuf(f, buffer, _IOFBF, sizeof(buffer));
+
+	fprintf(f, "# BinaryMeshFitting batch mesh\n");
+	v_total = 0;
+	p_total = 0;
+	int count = (int)batch.count;
+	for (int i = 0; i < count; i++)
+	{
+		DMCChunk* chunk = batch[i]->chunk;
+		if (!chunk || !chunk->contains_mesh)
+			continue;
+
+		const size_t face_size = (QUADS ? 4 : 3);
+		size_t v_count, i_count;
+		if (chunk->baked_entry)
+		{
+			// Read in place from a baked tile, positions are packed to the entry's world space bounds
+			const MeshArchive* archive = chunk->baked_archive;
+			const MeshArchiveEntry* e = chunk->baked_entry;
+			fprintf(f, "o chunk_%llx\n", (unsigned long long)batch[i]->morton_code.code);
+
+			glm::vec3 box_min = glm::vec3(e->box_min[0], e->box_min[1], e->box_min[2]);
+			glm::vec3 extent = glm::vec3(e->box_max[0], e->box_max[1], e->box_max[2]) - box_min;
+			const PackedVertex* v = archive->get_vertices(e);
+			v_count = e->vertex_count;
+			for (size_t k = 0; k < v_count; k++)
+			{
+				glm::vec3 p = unpack_position(v[k], box_min, extent);
+				fprintf(f, "v %.5f %.5f %.5f\n", p.x, p.y, p.z);
+			}
+
+			const void* inds = archive->get_indexes(e);
+			i_count = e->index_count - e->index_count % face_size;
+			for (size_t k = 0; k < i_count; k += face_size)
+			{
+				fputc('f', f);
+				for (size_t j = 0; j < face_size; j++)
+				{
+					uint32_t index = (e->index_size == 2 ? ((const uint16_t*)inds)[k + j] : ((const uint32_t*)inds)[k + j]);
+					fprintf(f, " %llu", (unsigned long long)(v_total + index + 1));
+				}
+				fputc('\n', f);
+			}
+		}
+		else
+		{
+			if (!chunk->vi || !chunk->vi->mesh_indexes.count)
+				continue;
+
+			auto& verts = chunk->vi->vertices;
+			auto& inds = chunk->vi->mesh_indexes;
+			fprintf(f, "o chunk_%llx\n", (unsigned long long)batch[i]->morton_code.code);
+
+			v_count = verts.count;
+			for (size_t k = 0; k < v_count; k++)
+			{
+				glm::vec3 p = chunk->overlap_pos + verts.p[k] * chunk->scale;
+				fprintf(f, "v %.5f %.5f %.5f\n", p.x, p.y, p.z);
+			}
+
+			i_count = inds.count - inds.count % face_size;
+			for (size_t k = 0; k < i_count; k += face_size)
+			{
+				fputc('f', f);
+				for (size_t j = 0; j < face_size; j++)
+					fprintf(f, " %llu", (unsigned long long)(v_total + inds[(int)(k + j)] + 1));
+				fputc('\n', f);
+			}
+		}
+
+		v_total += v_count;
+		p_total += i_count / face_size;
+	}
+
+	bool ok = !ferror(f);
+	fclose(f);
+	return ok;
+}
+
+template <class T>
+static void print_allocator_stats(const char* name, ResourceAllocator<T>& allocator)
+{
+	ResourceAllocatorStats s = allocator.stats();
+	printf("  %-10s %8zu created %8zu in use %10llu allocs %8llu depot swaps\n", name, s.created, s.in_use,
+		(unsigned long long)s.allocations, (unsigned long long)(s.depot_gets + s.depot_puts));
+}
+
+int main(int argc, char** argv)
+{
+	using namespace std;
+
+	BatchOptions opts;
+	if (!parse_options(argc, argv, opts))
+	{
+		print_usage();
+		return 1;
+	}
+
+	omp_set_num_threads(opts.threads);
+
+	WorldOctree world;
+	world.properties.min_level = opts.min_level;
+	world.properties.max_level = opts.max_level;
+	world.properties.chunk_resolution = opts.resolution;
+	for (int i = 0; i < opts.max_level - 1 && i < WORLD_MAX_LEVELS; i++)
+		world.properties.level_resolutions[i] = opts.far_resolution;
+	world.properties.process_iters = opts.iters;
+	world.properties.overlap = opts.overlap;
+	world.properties.num_threads = opts.threads;
+	world.properties.mesh_cache_path = opts.cache;
+	world.properties.baked_mesh_path = opts.baked;
+	world.init((uint32_t)opts.world_size);
+
+	ChunkGenerator& generator = world.watcher.generator;
+	generator.init(&world);
+
+	SmartContainer<WorldOctreeNode*> batch;
+	if (opts.mode == BATCH_MODES_LOD)
+		gather_lod(world, opts, batch);
+	else
+		gather_region(world, opts, batch);
+
+	if (!batch.count)
+	{
+		cout << "Nothing to mesh." << endl;
+		return 1;
+	}
+
+	cout << "Generating " << batch.count << " chunks on " << opts.threads << " threads...";
+	auto start = chrono::steady_clock::now();
+	generator.process_queue(batch);
+	auto elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+	cout << "done (" << (int)elapsed << "ms)" << endl;
+
+	cout << "Allocators:" << endl;
+	print_allocator_stats("density", generator.density_allocator);
+	print_allocator_stats("binary", generator.binary_allocator);
+	print_allocator_stats("noise", generator.noise_allocator);
+	print_allocator_stats("masks", generator.masks_allocator);
+	print_allocator_stats("cells", generator.cell_allocator);
+	print_allocator_stats("indexes", generator.inds_allocator);
+	print_allocator_stats("vi", generator.vi_allocator);
+	print_allocator_stats("mesh", generator.mesh_allocator);
+
+	if (generator.mesh_cache.is_enabled())
+	{
+		// Wait for the queued writes so the next run sees them
+		generator.mesh_cache.shutdown();
+		MeshCacheStats cs = generator.mesh_cache.stats();
+		printf("Mesh cache: %llu hits, %llu misses, %llu written (%llu bytes), %llu dropped\n", (unsigned long long)cs.hits, (unsigned long long)cs.misses,
+			(unsigned long long)cs.writes, (unsigned long long)cs.bytes_written, (unsigned long long)cs.dropped_writes);
+	}
+
+	if (generator.baked_tiles.is_enabled())
+	{
+		MeshTileReaderStats bs = generator.baked_tiles.stats();
+		printf("Baked tiles: %llu hits, %llu misses, %zu mapped\n", (unsigned long long)bs.hits, (unsigned long long)bs.misses, bs.open_tiles);
+	}
+
+	cout << "Writing " << opts.output << "...";
+	size_t v_total, p_total;
+	if (!write_obj(opts.output, batch, v_total, p_total))
+	{
+		cout << "failed." << endl;
+		return 1;
+	}
+	cout << "done (" << v_total << " verts, " << p_total << " prims)" << endl;
+
+	return 0;
+}
@@ -0,0 +1,414 @@
+#include "PCH.h"
+#include "WorldOctree.hpp"
+#include "WorldOctreeNode.hpp"
+#include "DMCChunk.hpp"
+#include "ChunkMesh.hpp"
+#include "MeshProcessor.hpp"
+#include "DefaultOptions.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <Windows.h>
+#include <Psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+// Runs the chunk pipeline stage by stage over a fixed, seeded set of chunks and reports
+// per-stage timings as JSON. Single threaded on purpose so numbers are comparable
+// between machines and between SIMD/threading changes.
+// Allocations are the chunk block allocators' (ResourceAllocatorStats), each resolution gets
+// its own. Peak RSS is the growth of the process peak while a resolution ran; run one
+// resolution per process for absolute numbers.
+
+#define BENCH_DEFAULT_SEED 1337
+#define BENCH_DEFAULT_CHUNKS 64
+#define BENCH_DEFAULT_ITERS 2
+#define BENCH_DEFAULT_REPEAT 3
+#define BENCH_MIN_LEVEL 3
+#define BENCH_MAX_LEVEL 6
+
+enum BENCH_STAGES
+{
+	BENCH_STAGES_LABEL_GRID = 0,
+	BENCH_STAGES_LABEL_EDGES,
+	BENCH_STAGES_POLYGONIZE,
+	BENCH_STAGES_OPTIMIZE_DUAL,
+	BENCH_STAGES_OPTIMIZE_PRIMAL,
+	BENCH_STAGES_FORMAT,
+	BENCH_STAGES_COUNT
+};
+
+static const char* stage_names[BENCH_STAGES_COUNT] = { "label_grid", "label_edges", "polygonize", "optimize_dual_grid", "optimize_primal_grid", "format" };
+
+enum BENCH_ALLOCATORS
+{
+	BENCH_ALLOCATORS_BINARY = 0,
+	BENCH_ALLOCATORS_DENSITY,
+	BENCH_ALLOCATORS_NOISE,
+	BENCH_ALLOCATORS_MASKS,
+	BENCH_ALLOCATORS_VI,
+	BENCH_ALLOCATORS_CELLS,
+	BENCH_ALLOCATORS_INDEXES,
+	BENCH_ALLOCATORS_MESH,
+	BENCH_ALLOCATORS_COUNT
+};
+
+static const char* allocator_names[BENCH_ALLOCATORS_COUNT] = { "binary", "density", "noise", "masks", "vertices_indexes", "cells", "indexes", "mesh" };
+
+struct BenchChunk
+{
+	glm::vec3 pos;
+	float size;
+	int level;
+	uint64_t code;
+};
+
+struct BenchResult
+{
+	int resolution;
+	uint64_t voxels;
+	uint64_t chunks_with_mesh;
+	uint64_t vertices;
+	uint64_t triangles;
+	uint64_t stage_ns[BENCH_STAGES_COUNT];
+	uint64_t total_ns;
+	ResourceAllocatorStats allocators[BENCH_ALLOCATORS_COUNT];
+	uint64_t peak_rss_growth;
+};
+
+static uint64_t get_peak_rss()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return (uint64_t)counters.PeakWorkingSetSize;
+	return 0;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return 0;
+#ifdef __APPLE__
+	return (uint64_t)usage.ru_maxrss;
+#else
+	return (uint64_t)usage.ru_maxrss * 1024;
+#endif
+#endif
+}
+
+static uint64_t now_ns()
+{
+	using namespace std::chrono;
+	return (uint64_t)duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+// Picks chunks the same way the octree would lay them out, with y kept inside the
+// terrain's height band so most of them actually contain surface.
+static void generate_chunks(uint32_t seed, int count, float world_size, float height, std::vector<BenchChunk>& out)
+{
+	std::mt19937 rng(seed);
+	std::uniform_int_distribution<int> level_dist(BENCH_MIN_LEVEL, BENCH_MAX_LEVEL);
+
+	float root_size = world_size * 2.0f;
+	glm::vec3 root_pos = glm::vec3(1, 1, 1) * -world_size;
+	for (int i = 0; i < count; i++)
+	{
+		BenchChunk c;
+		c.level = level_dist(rng);
+		int cells = 1 << c.level;
+		c.size = root_size / (float)cells;
+
+		int y_min = (int)floor((-height - root_pos.y) / c.size);
+		int y_max = (int)floor((height - root_pos.y) / c.size);
+		y_min = glm::clamp(y_min, 0, cells - 1);
+		y_max = glm::clamp(y_max, 0, cells - 1);
+
+		std::uniform_int_distribution<int> xz_dist(0, cells - 1);
+		std::uniform_int_distribution<int> y_dist(y_min, y_max);
+		int x = xz_dist(rng);
+		int y = y_dist(rng);
+		int z = xz_dist(rng);
+		c.pos = root_pos + glm::vec3((float)x, (float)y, (float)z) * c.size;
+
+		c.code = 1;
+		for (int b = c.level - 1; b >= 0; b--)
+			c.code = (c.code << 3) | ((x >> b) & 1) | (((y >> b) & 1) << 1) | (((z >> b) & 1) << 2);
+		out.push_back(c);
+	}
+}
+
+static void run_resolution(WorldOctree& world, const std::vector<BenchChunk>& chunks, int resolution, int iters, int repeat, BenchResult& result)
+{
+	// Blocks are sized on first use, so each resolution gets its own allocators
+	ResourceAllocator<BinaryBlock> binary_allocator;
+	ResourceAllocator<DensityBlock> density_allocator;
+	ResourceAllocator<NoiseBlock> noise_allocator;
+	ResourceAllocator<MasksBlock> masks_allocator;
+	ResourceAllocator<VerticesIndicesBlock> vi_allocator;
+	ResourceAllocator<DMC_CellsBlock> cell_allocator;
+	ResourceAllocator<IndexesBlock> inds_allocator;
+	ResourceAllocator<ChunkMesh> mesh_allocator;
+
+	memset(&result, 0, sizeof(result));
+	result.resolution = resolution;
+
+	int max_level = world.properties.max_level;
+	bool boundary_processing = world.properties.boundary_processing;
+	float base_overlap = world.properties.overlap;
+
+	uint64_t peak_rss_start = get_peak_rss();
+
+	DMCChunk chunk;
+	for (int r = 0; r < repeat; r++)
+	{
+		for (const BenchChunk& c : chunks)
+		{
+			WorldOctreeNode node(0, nullptr, c.size, c.pos, (uint8_t)c.level);
+			node.morton_code = c.code;
+			chunk.init(c.pos, c.size, c.level, world.sampler, c.code);
+			chunk.dim = resolution;
+			node.chunk = &chunk;
+
+			float overlap = (c.level == max_level && (!boundary_processing || iters == 0) ? 0.0f : base_overlap + 0.005f * (float)iters);
+			uint64_t t0 = now_ns();
+			chunk.label_grid(&binary_allocator, &density_allocator, &noise_allocator, overlap, world.noise_properties, 0, 0, 0, 0);
+			uint64_t t1 = now_ns();
+			chunk.label_edges(&vi_allocator, &cell_allocator, &inds_allocator, &density_allocator, &masks_allocator);
+			uint64_t t2 = now_ns();
+			chunk.polygonize();
+			uint64_t t3 = now_ns();
+			uint64_t t4 = t3, t5 = t3;
+
+			if (iters > 0 && chunk.contains_mesh && chunk.vi->vertices.count && chunk.vi->mesh_indexes.count)
+			{
+				auto& v_out = chunk.vi->vertices;
+				auto& i_out = chunk.vi->mesh_indexes;
+				Processing::MeshProcessor<3> mp(true, SMOOTH_NORMALS);
+				mp.init(v_out, i_out, world.sampler);
+				mp.optimize_dual_grid(iters, boundary_processing);
+				t4 = now_ns();
+				mp.optimize_primal_grid(false, false, boundary_processing);
+				v_out.count = 0;
+				i_out.count = 0;
+				mp.flush(v_out, i_out);
+				t5 = now_ns();
+			}
+
+			node.format(&mesh_allocator);
+			uint64_t t6 = now_ns();
+
+			result.stage_ns[BENCH_STAGES_LABEL_GRID] += t1 - t0;
+			result.stage_ns[BENCH_STAGES_LABEL_EDGES] += t2 - t1;
+			result.stage_ns[BENCH_STAGES_POLYGONIZE] += t3 - t2;
+			result.stage_ns[BENCH_STAGES_OPTIMIZE_DUAL] += t4 - t3;
+			result.stage_ns[BENCH_STAGES_OPTIMIZE_PRIMAL] += t5 - t4;
+			result.stage_ns[BENCH_STAGES_FORMAT] += t6 - t5;
+			result.voxels += (uint64_t)resolution * resolution * resolution;
+
+			if (chunk.contains_mesh && chunk.vi)
+			{
+				result.chunks_with_mesh++;
+				result.vertices += chunk.vi->vertices.count;
+				result.triangles += (QUADS ? chunk.vi->mesh_indexes.count / 2 : chunk.vi->mesh_indexes.count / 3);
+			}
+
+			binary_allocator.free_element(chunk.binary_block);
+			density_allocator.free_element(chunk.density_block);
+			cell_allocator.free_element(chunk.cell_block);
+			inds_allocator.free_element(chunk.indexes_block);
+			vi_allocator.free_element(chunk.vi);
+			if (node.mesh)
+			{
+				node.mesh->reset_data();
+				mesh_allocator.free_element(node.mesh);
+				node.mesh = 0;
+			}
+			node.chunk = 0;
+		}
+	}
+
+	for (int s = 0; s < BENCH_STAGES_COUNT; s++)
+		result.total_ns += result.stage_ns[s];
+	result.allocators[BENCH_ALLOCATORS_BINARY] = binary_allocator.stats();
+	result.allocators[BENCH_ALLOCATORS_DENSITY] = density_allocator.stats();
+	result.allocators[BENCH_ALLOCATORS_NOISE] = noise_allocator.stats();
+	result.allocators[BENCH_ALLOCATORS_MASKS] = masks_allocator.stats();
+	result.allocators[BENCH_ALLOCATORS_VI] = vi_allocator.stats();
+	result.allocators[BENCH_ALLOCATORS_CELLS] = cell_allocator.stats();
+	result.allocators[BENCH_ALLOCATORS_INDEXES] = inds_allocator.stats();
+	result.allocators[BENCH_ALLOCATORS_MESH] = mesh_allocator.stats();
+	// The peak is process wide and only grows, a resolution that stays under an earlier one's reports 0
+	uint64_t peak_rss_end = get_peak_rss();
+	result.peak_rss_growth = (peak_rss_end > peak_rss_start ? peak_rss_end - peak_rss_start : 0);
+}
+
+static void write_json(std::ostream& out, uint32_t seed, int chunk_count, int iters, int repeat, const std::vector<BenchResult>& results)
+{
+	using namespace std;
+	out << setprecision(6) << fixed;
+	out << "{" << endl;
+	out << "  \"seed\": " << seed << "," << endl;
+	out << "  \"chunks\": " << chunk_count << "," << endl;
+	out << "  \"iters\": " << iters << "," << endl;
+	out << "  \"repeat\": " << repeat << "," << endl;
+	out << "  \"simd\": \"" << get_simd_text() << "\"," << endl;
+	out << "  \"results\": [" << endl;
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const BenchResult& r = results[i];
+		double voxels = (double)(r.voxels ? r.voxels : 1);
+		double total_s = (double)r.total_ns * 1e-9;
+		out << "    {" << endl;
+		out << "      \"resolution\": " << r.resolution << "," << endl;
+		out << "      \"voxels\": " << r.voxels << "," << endl;
+		out << "      \"chunks_with_mesh\": " << r.chunks_with_mesh << "," << endl;
+		out << "      \"vertices\": " << r.vertices << "," << endl;
+		out << "      \"triangles\": " << r.triangles << "," << endl;
+		out << "      \"stages\": {" << endl;
+		for (int s = 0; s < BENCH_STAGES_COUNT; s++)
+		{
+			out << "        \"" << stage_names[s] << "\": { \"total_ns\": " << r.stage_ns[s] << ", \"ns_per_voxel\": " << (double)r.stage_ns[s] / voxels << " }";
+			out << (s + 1 < BENCH_STAGES_COUNT ? "," : "") << endl;
+		}
+		out << "      }," << endl;
+		out << "      \"total_ns\": " << r.total_ns << "," << endl;
+		out << "      \"ns_per_voxel\": " << (double)r.total_ns / voxels << "," << endl;
+		out << "      \"triangles_per_second\": " << (total_s > 0.0 ? (double)r.triangles / total_s : 0.0) << "," << endl;
+		out << "      \"allocators\": {" << endl;
+		uint64_t allocations = 0;
+		for (int a = 0; a < BENCH_ALLOCATORS_COUNT; a++)
+		{
+			const ResourceAllocatorStats& stats = r.allocators[a];
+			allocations += stats.allocations;
+			out << "        \"" << allocator_names[a] << "\": { \"created\": " << stats.created << ", \"allocations\": " << stats.allocations << ", \"depot_swaps\": " << stats.depot_gets + stats.depot_puts << " }";
+			out << (a + 1 < BENCH_ALLOCATORS_COUNT ? "," : "") << endl;
+		}
+		out << "      }," << endl;
+		out << "      \"allocations\": " << allocations << "," << endl;
+		out << "      \"peak_rss_growth_bytes\": " << r.peak_rss_growth << endl;
+		out << "    }" << (i + 1 < results.size() ? "," : "") << endl;
+	}
+	out << "  ]" << endl;
+	out << "}" << endl;
+}
+
+static void print_usage()
+{
+	using namespace std;
+	cout << "Usage: bmf_bench [options]" << endl << endl;
+	cout << "Options:" << endl;
+	cout << "  --resolutions <a,b,...>  Chunk resolutions to run (default 16,32,64)" << endl;
+	cout << "  --chunks <n>             Chunks per resolution (default " << BENCH_DEFAULT_CHUNKS << ")" << endl;
+	cout << "  --seed <n>               Seed for the chunk set (default " << BENCH_DEFAULT_SEED << ")" << endl;
+	cout << "  --iters <n>              Mesh processing iterations (default " << BENCH_DEFAULT_ITERS << ")" << endl;
+	cout << "  --repeat <n>             Passes over the chunk set (default " << BENCH_DEFAULT_REPEAT << ")" << endl;
+	cout << "  --output <file>          Write the JSON report to a file instead of stdout" << endl;
+}
+
+int main(int argc, char** argv)
+{
+	using namespace std;
+
+	vector<int> resolutions = { 16, 32, 64 };
+	int chunk_count = BENCH_DEFAULT_CHUNKS;
+	uint32_t seed = BENCH_DEFAULT_SEED;
+	int iters = BENCH_DEFAULT_ITERS;
+	int repeat = BENCH_DEFAULT_REPEAT;
+	string output;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const char* arg = argv[i];
+		const char* next = (i + 1 < argc ? argv[i + 1] : 0);
+		if (!next || !strcmp(arg, "--help") || !strcmp(arg, "-h"))
+		{
+			print_usage();
+			return 1;
+		}
+
+		if (!strcmp(arg, "--resolutions"))
+		{
+			resolutions.clear();
+			stringstream ss(next);
+			string item;
+			while (getline(ss, item, ','))
+			{
+				int r = atoi(item.c_str());
+				if (r >= 4)
+					resolutions.push_back(r);
+			}
+		}
+		else if (!strcmp(arg, "--chunks"))
+			chunk_count = atoi(next);
+		else if (!strcmp(arg, "--seed"))
+			seed = (uint32_t)strtoul(next, 0, 10);
+		else if (!strcmp(arg, "--iters"))
+			iters = atoi(next);
+		else if (!strcmp(arg, "--repeat"))
+			repeat = atoi(next);
+		else if (!strcmp(arg, "--output"))
+			output = next;
+		else
+		{
+			print_usage();
+			return 1;
+		}
+		i++;
+	}
+
+	if (resolutions.empty() || chunk_count < 1 || repeat < 1)
+	{
+		print_usage();
+		return 1;
+	}
+
+	// The world prints its setup to cout, keep that off the JSON stream
+	streambuf* cout_buf = cout.rdbuf();
+	ostringstream world_log;
+	if (output.empty())
+		cout.rdbuf(world_log.rdbuf());
+
+	WorldOctree world;
+	world.properties.process_iters = iters;
+
+	vector<BenchChunk> chunks;
+	generate_chunks(seed, chunk_count, world.sampler.world_size, world.noise_properties.height, chunks);
+
+	vector<BenchResult> results;
+	for (int r : resolutions)
+	{
+		cerr << "Resolution " << r << "...";
+		BenchResult result;
+		run_resolution(world, chunks, r, iters, repeat, result);
+		results.push_back(result);
+		cerr << "done (" << (int)(result.total_ns / 1000000) << "ms)" << endl;
+	}
+
+	cout.rdbuf(cout_buf);
+	if (output.empty())
+		write_json(cout, seed, chunk_count, iters, repeat, results);
+	else
+	{
+		ofstream f(output);
+		if (!f)
+		{
+			cerr << "Couldn't open " << output << endl;
+			return 1;
+		}
+		write_json(f, seed, chunk_count, iters, repeat, results);
+	}
+
+	return 0;
+}
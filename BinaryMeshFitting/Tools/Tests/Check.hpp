@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdio>
+
+// Minimal assertions for the core tests, which are plain executables run by ctest. A failed
+// check is reported and counted, the test keeps going and returns the count from main.
+static int check_failures = 0;
+
+#define CHECK(_cond) \
+do { \
+	if (!(_cond)) \
+	{ \
+		fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #_cond); \
+		check_failures++; \
+	} \
+} while (0)
+
+#define CHECK_RESULT() (check_failures ? (fprintf(stderr, "%d checks failed\n", check_failures), 1) : 0)
@@ -0,0 +1,134 @@
+#include "PCH.h"
+#include "EditLayer.hpp"
+#include "Check.hpp"
+
+#include <cmath>
+#include <vector>
+
+using namespace glm;
+
+static bool near(float a, float b)
+{
+	return fabsf(a - b) < 1e-5f;
+}
+
+// The edits below, in the order they're made. The world spans [-64, 64], so they end up at different
+// depths: 1 and 4 straddle x = 16 and stay in the [0, 32] node, 2 goes one level down and 3 two,
+// which makes the octree visit them out of order.
+static void add_edits(EditLayer& layer)
+{
+	CHECK(layer.add(BRUSH_SHAPES_SPHERE, BRUSH_OPS_ADD, vec3(20, 20, 20), vec3(8, 8, 8)) == 1);
+	CHECK(layer.add(BRUSH_SHAPES_BOX, BRUSH_OPS_SUBTRACT, vec3(24, 20, 20), vec3(3, 3, 3)) == 2);
+	CHECK(layer.add(BRUSH_SHAPES_SPHERE, BRUSH_OPS_ADD, vec3(26, 20, 20), vec3(2, 0, 0)) == 3);
+	CHECK(layer.add(BRUSH_SHAPES_BOX, BRUSH_OPS_ADD, vec3(16, 20, 20), vec3(0.5f, 0.5f, 0.5f)) == 4);
+}
+
+static void test_query()
+{
+	EditLayer layer;
+	layer.init(vec3(-64, -64, -64), 128.0f);
+	add_edits(layer);
+	CHECK(layer.count() == 4);
+
+	std::vector<BrushEdit> found;
+	layer.query(vec3(4, 4, 4), vec3(36, 36, 36), 0, found);
+	CHECK(found.size() == 4);
+	for (size_t i = 0; i < found.size(); i++)
+		CHECK(found[i].serial == (uint32_t)i + 1);
+
+	// Spheres are stored with the radius on every axis
+	CHECK(found.size() > 2 && found[2].half_size == vec3(2, 2, 2));
+
+	// Appended after what's already there, only the newer edits
+	layer.query(vec3(4, 4, 4), vec3(36, 36, 36), 2, found);
+	CHECK(found.size() == 6 && found[4].serial == 3 && found[5].serial == 4);
+
+	// Only the brushes overlapping the box
+	found.clear();
+	layer.query(vec3(25, 19, 19), vec3(26, 21, 21), 0, found);
+	CHECK(found.size() == 3 && found[0].serial == 1 && found[1].serial == 2 && found[2].serial == 3);
+
+	found.clear();
+	layer.query(vec3(-60, -60, -60), vec3(-50, -50, -50), 0, found);
+	CHECK(found.empty());
+	CHECK(!layer.intersects(vec3(-60, -60, -60), vec3(-50, -50, -50)));
+	CHECK(layer.intersects(vec3(15, 19, 19), vec3(17, 21, 21)));
+
+	std::vector<BrushEdit> pending;
+	layer.take_pending(pending);
+	CHECK(pending.size() == 4);
+	pending.clear();
+	layer.take_pending(pending);
+	CHECK(pending.empty());
+
+	layer.clear();
+	CHECK(layer.count() == 0 && !layer.intersects(vec3(-64, -64, -64), vec3(64, 64, 64)));
+}
+
+// The queried edits applied in order give the union of the spheres minus the box, with the last
+// sphere added back on top of it
+static void test_composition()
+{
+	const uint32_t dim = 33;
+	const float scale = 1.0f;
+	const vec3 origin(4, 4, 4);
+
+	EditLayer layer;
+	layer.init(vec3(-64, -64, -64), 128.0f);
+	add_edits(layer);
+
+	std::vector<BrushEdit> found;
+	layer.query(origin, origin + (float)(dim - 1) * scale, 0, found);
+	CHECK(found.size() == 4);
+
+	std::vector<float> data(dim * dim * dim, -100.0f);
+	for (const BrushEdit& e : found)
+		e.apply(data.data(), origin, dim, scale);
+
+	auto at = [&](int x, int y, int z) { return data[((uint32_t)(x - 4) * dim + (uint32_t)(y - 4)) * dim + (uint32_t)(z - 4)]; };
+
+	// Only the first sphere
+	CHECK(near(at(16, 20, 20), 4.0f));
+	CHECK(near(at(20, 20, 28), 0.0f));
+	// Next to the box, 1 from its face
+	CHECK(near(at(20, 20, 20), 1.0f));
+	// Carved out by the box
+	CHECK(near(at(22, 20, 20), -1.0f));
+	// Inside the box too, but the last sphere comes after it
+	CHECK(near(at(26, 20, 20), 2.0f));
+	CHECK(near(at(27, 20, 20), 1.0f));
+	// Far from every brush, untouched
+	CHECK(at(4, 4, 4) == -100.0f);
+	CHECK(at(36, 36, 36) == -100.0f);
+
+	// Every sample a brush reached matches composing the brushes' densities directly
+	bool match = true;
+	for (int x = 0; x < (int)dim; x++)
+	{
+		for (int y = 0; y < (int)dim; y++)
+		{
+			for (int z = 0; z < (int)dim; z++)
+			{
+				vec3 p = origin + vec3((float)x, (float)y, (float)z) * scale;
+				float expected = -100.0f;
+				for (const BrushEdit& e : found)
+				{
+					vec3 lo = e.get_min() - scale, hi = e.get_max() + scale;
+					if (p.x < lo.x || p.y < lo.y || p.z < lo.z || p.x > hi.x || p.y > hi.y || p.z > hi.z)
+						continue;
+					float b = e.density(p);
+					expected = (e.op == BRUSH_OPS_ADD ? fmaxf(expected, b) : fminf(expected, -b));
+				}
+				match = match && near(data[((uint32_t)x * dim + (uint32_t)y) * dim + (uint32_t)z], expected);
+			}
+		}
+	}
+	CHECK(match);
+}
+
+int main()
+{
+	test_query();
+	test_composition();
+	return CHECK_RESULT();
+}
@@ -0,0 +1,152 @@
+#include "PCH.h"
+#include "PackedDensity.hpp"
+#include "Check.hpp"
+
+#include <cmath>
+#include <vector>
+
+#define STEPS 32767.0f
+
+struct Field
+{
+	uint32_t dim;
+	std::vector<float> density;
+	std::vector<uint32_t> signs;
+
+	bool negative(int x, int y, int z) const
+	{
+		uint32_t z_per_y = (dim + 31) / 32;
+		return (signs[(x * dim + y) * z_per_y + (z >> 5)] >> (z & 31)) & 1;
+	}
+
+	bool crossing(int x, int y, int z) const
+	{
+		const int d[6][3] = { { -1, 0, 0 }, { 1, 0, 0 }, { 0, -1, 0 }, { 0, 1, 0 }, { 0, 0, -1 }, { 0, 0, 1 } };
+		for (int i = 0; i < 6; i++)
+		{
+			int nx = x + d[i][0], ny = y + d[i][1], nz = z + d[i][2];
+			if (nx >= 0 && ny >= 0 && nz >= 0 && nx < (int)dim && ny < (int)dim && nz < (int)dim && negative(nx, ny, nz) != negative(x, y, z))
+				return true;
+		}
+		return false;
+	}
+};
+
+// A wobbly sphere, so the bands differ from brick to brick, with the signs labelled from it
+static Field make_field(uint32_t dim, float cx, float cy, float cz, float radius)
+{
+	Field f;
+	f.dim = dim;
+	f.density.resize(dim * dim * dim);
+	uint32_t z_per_y = (dim + 31) / 32;
+	f.signs.assign(dim * dim * z_per_y, 0);
+	for (uint32_t x = 0; x < dim; x++)
+	{
+		for (uint32_t y = 0; y < dim; y++)
+		{
+			for (uint32_t z = 0; z < dim; z++)
+			{
+				float dx = (float)x - cx, dy = (float)y - cy, dz = (float)z - cz;
+				float d = (radius - sqrtf(dx * dx + dy * dy + dz * dz)) * (1.5f + sinf((float)(x * 7 + y * 3 + z)));
+				f.density[(x * dim + y) * dim + z] = d;
+				if (d < 0.0f)
+					f.signs[(x * dim + y) * z_per_y + (z >> 5)] |= 1u << (z & 31);
+			}
+		}
+	}
+	return f;
+}
+
+static void check_round_trip(PackedDensityBlock& block, const Field& f)
+{
+	const uint32_t B = PACKED_DENSITY_BRICK_DIM;
+	uint32_t dim = f.dim;
+	block.pack(f.density.data(), f.signs.data(), dim);
+	CHECK(block.dim == dim);
+	CHECK(block.bricks_per_axis == (dim + B - 1) / B);
+
+	std::vector<float> out(dim * dim * dim, 12345.0f);
+	block.unpack(out.data(), f.signs.data());
+
+	uint32_t n = block.bricks_per_axis;
+	uint32_t stored = 0;
+	bool bricks_match = true, bands_match = true, signs_match = true, in_step = true, clamped = true, placeholders = true;
+	for (uint32_t bx = 0; bx < n; bx++)
+	{
+		for (uint32_t by = 0; by < n; by++)
+		{
+			for (uint32_t bz = 0; bz < n; bz++)
+			{
+				uint32_t b = (bx * n + by) * n + bz;
+				bool any = false;
+				float band = 0.0f;
+				for (uint32_t x = bx * B; x < bx * B + B && x < dim; x++)
+					for (uint32_t y = by * B; y < by * B + B && y < dim; y++)
+						for (uint32_t z = bz * B; z < bz * B + B && z < dim; z++)
+							if (f.crossing(x, y, z))
+							{
+								any = true;
+								band = fmaxf(band, fabsf(f.density[(x * dim + y) * dim + z]));
+							}
+
+				// Exactly the bricks with a crossing sample are kept
+				bricks_match = bricks_match && ((block.brick_index[b] != PACKED_DENSITY_NO_BRICK) == any);
+				if (any)
+				{
+					stored++;
+					bands_match = bands_match && block.brick_band[b] == band;
+				}
+
+				for (uint32_t x = bx * B; x < bx * B + B && x < dim; x++)
+				{
+					for (uint32_t y = by * B; y < by * B + B && y < dim; y++)
+					{
+						for (uint32_t z = bz * B; z < bz * B + B && z < dim; z++)
+						{
+							float v = out[(x * dim + y) * dim + z];
+							float d = f.density[(x * dim + y) * dim + z];
+							signs_match = signs_match && ((v < 0.0f) == f.negative(x, y, z));
+							if (!any)
+								placeholders = placeholders && v == (f.negative(x, y, z) ? -1.0f : 1.0f);
+							else if (f.crossing(x, y, z))
+								// Half a step of rounding, a whole one when a value near 0 is kept off it
+								in_step = in_step && fabsf(v - d) <= band / STEPS * 1.001f;
+							else
+								clamped = clamped && fabsf(fabsf(v) - band) <= band * 1e-6f;
+						}
+					}
+				}
+			}
+		}
+	}
+	CHECK(bricks_match);
+	CHECK(bands_match);
+	CHECK(block.stored_bricks == stored);
+	CHECK(signs_match);
+	CHECK(in_step);
+	CHECK(clamped);
+	CHECK(placeholders);
+}
+
+static void test_round_trip()
+{
+	// Partial bricks along the far faces
+	PackedDensityBlock block;
+	Field f = make_field(20, 9.3f, 10.1f, 8.7f, 6.4f);
+	check_round_trip(block, f);
+	CHECK(block.stored_bricks > 0 && block.stored_bricks < 27);
+
+	// A pooled block packed again at other resolutions
+	check_round_trip(block, make_field(33, 4.0f, 30.0f, 16.5f, 12.2f));
+	check_round_trip(block, make_field(9, 4.5f, 4.5f, 4.5f, 3.1f));
+
+	// All solid, nothing to keep
+	check_round_trip(block, make_field(16, 8.0f, 8.0f, 8.0f, 100.0f));
+	CHECK(block.stored_bricks == 0);
+}
+
+int main()
+{
+	test_round_trip();
+	return CHECK_RESULT();
+}
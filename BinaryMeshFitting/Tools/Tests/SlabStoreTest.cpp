@@ -0,0 +1,161 @@
+#include "PCH.h"
+#include "SlabStore.hpp"
+#include "Check.hpp"
+
+#include <vector>
+
+// Same layout as the octree: a leading 1, then three bits per level (x, y, z), the deepest last
+static uint64_t make_code(int level, int x, int y, int z)
+{
+	uint64_t code = 1;
+	for (int b = level - 1; b >= 0; b--)
+		code = (code << 3) | ((x >> b) & 1) | (((y >> b) & 1) << 1) | (((z >> b) & 1) << 2);
+	return code;
+}
+
+static void test_neighbour_code()
+{
+	uint64_t out;
+	CHECK(!SlabStore::get_neighbour_code(0, 0, 1, out));
+	for (int axis = 0; axis < 3; axis++)
+	{
+		CHECK(!SlabStore::get_neighbour_code(1, axis, 1, out));
+		CHECK(!SlabStore::get_neighbour_code(1, axis, -1, out));
+	}
+
+	for (int level = 1; level <= 4; level++)
+	{
+		int cells = 1 << level;
+		for (int x = 0; x < cells; x++)
+			for (int y = 0; y < cells; y++)
+				for (int z = 0; z < cells; z++)
+				{
+					uint64_t code = make_code(level, x, y, z);
+					for (int axis = 0; axis < 3; axis++)
+					{
+						for (int dir = -1; dir <= 1; dir += 2)
+						{
+							int p[3] = { x, y, z };
+							p[axis] += dir;
+							bool inside = (p[axis] >= 0 && p[axis] < cells);
+							out = 0;
+							bool found = SlabStore::get_neighbour_code(code, axis, dir, out);
+							CHECK(found == inside);
+							if (found && inside)
+								CHECK(out == make_code(level, p[0], p[1], p[2]));
+						}
+					}
+				}
+	}
+
+	// Deepest levels the codes have room for
+	uint64_t code = make_code(21, (1 << 21) - 1, 0, 12345);
+	CHECK(!SlabStore::get_neighbour_code(code, 0, 1, out));
+	CHECK(SlabStore::get_neighbour_code(code, 0, -1, out) && out == make_code(21, (1 << 21) - 2, 0, 12345));
+	CHECK(SlabStore::get_neighbour_code(code, 2, 1, out) && out == make_code(21, (1 << 21) - 1, 0, 12346));
+}
+
+// Each voxel holds its chunk's id and its own index, so a copied layer shows where it came from
+static std::vector<float> make_density(uint32_t dim, float id)
+{
+	std::vector<float> density(dim * dim * dim);
+	for (uint32_t i = 0; i < dim * dim * dim; i++)
+		density[i] = id * 100000.0f + (float)i;
+	return density;
+}
+
+static float at(const std::vector<float>& density, uint32_t dim, uint32_t x, uint32_t y, uint32_t z)
+{
+	return density[(x * dim + y) * dim + z];
+}
+
+// A face put by one chunk is taken by its neighbour on the other side, into the opposite layer
+static void test_take_put()
+{
+	const uint32_t dim = 8;
+	const float scale = 0.5f;
+	const uint64_t sample_key = 42;
+	const int level = 3;
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		for (int low_first = 0; low_first < 2; low_first++)
+		{
+			SlabStore store;
+			store.init(1 << 20);
+
+			int p[3] = { 3, 4, 5 };
+			uint64_t low_code = make_code(level, p[0], p[1], p[2]);
+			p[axis]++;
+			uint64_t high_code = make_code(level, p[0], p[1], p[2]);
+
+			uint64_t first = (low_first ? low_code : high_code);
+			uint64_t second = (low_first ? high_code : low_code);
+			std::vector<float> first_density = make_density(dim, 1.0f);
+			CHECK(store.take(sample_key, first, first_density.data(), dim, scale) == 0);
+			store.put(sample_key, first, first_density.data(), dim, scale, 0);
+
+			// Other settings, another resolution or a chunk that doesn't share the face get nothing
+			std::vector<float> other = make_density(dim, 3.0f);
+			uint32_t side = (uint32_t)(axis * 2 + (low_first ? 0 : 1));
+			CHECK((store.take(sample_key + 1, second, other.data(), dim, scale) & (1u << side)) == 0);
+			CHECK((store.take(sample_key, second, other.data(), dim, scale * 2.0f) & (1u << side)) == 0);
+			CHECK(other == make_density(dim, 3.0f));
+
+			std::vector<float> second_density = make_density(dim, 2.0f);
+			uint32_t taken = store.take(sample_key, second, second_density.data(), dim, scale);
+			CHECK(taken == (1u << side));
+
+			// The second chunk's layer on the face is the first chunk's layer on it
+			uint32_t first_layer = (low_first ? dim - 1 : 0);
+			uint32_t second_layer = (low_first ? 0 : dim - 1);
+			bool match = true;
+			for (uint32_t u = 0; u < dim; u++)
+			{
+				for (uint32_t v = 0; v < dim; v++)
+				{
+					uint32_t a[3] = { u, u, u };
+					uint32_t b[3] = { u, u, u };
+					int k = 0;
+					for (int c = 0; c < 3; c++)
+					{
+						if (c == axis)
+						{
+							a[c] = first_layer;
+							b[c] = second_layer;
+						}
+						else
+						{
+							a[c] = (k ? v : u);
+							b[c] = a[c];
+							k++;
+						}
+					}
+					match = match && at(second_density, dim, b[0], b[1], b[2]) == at(first_density, dim, a[0], a[1], a[2]);
+				}
+			}
+			CHECK(match);
+
+			// Handed out once
+			std::vector<float> again = make_density(dim, 2.0f);
+			CHECK((store.take(sample_key, second, again.data(), dim, scale) & (1u << side)) == 0);
+		}
+	}
+
+	// Faces that were taken aren't stored again, the neighbour already has them
+	SlabStore store;
+	store.init(1 << 20);
+	std::vector<float> density = make_density(dim, 1.0f);
+	uint64_t code = make_code(level, 3, 4, 5);
+	store.put(sample_key, code, density.data(), dim, scale, 0x3F);
+	CHECK(store.stats().slabs == 0);
+	store.put(sample_key, code, density.data(), dim, scale, 0);
+	CHECK(store.stats().slabs == 6);
+}
+
+int main()
+{
+	test_neighbour_code();
+	test_take_put();
+	return CHECK_RESULT();
+}
@@ -0,0 +1,224 @@
+#include "PCH.h"
+#include "WorldOctree.hpp"
+#include "ChunkGenerator.hpp"
+#include "WorldBaker.hpp"
+
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <thread>
+#include <omp.h>
+
+// Out-of-core baker. Generates every level from --min-level to --max-level over a region,
+// a bounded batch of chunks at a time, and streams the meshes to tile files in a directory.
+
+struct BakeOptions
+{
+	glm::vec3 region_min;
+	glm::vec3 region_max;
+	bool has_region;
+	int world_size;
+	int min_level;
+	int max_level;
+	int tile_level;
+	int resolution;
+	int far_resolution;
+	int iters;
+	float overlap;
+	int threads;
+	int batch;
+	bool resume;
+	std::string output;
+
+	BakeOptions()
+	{
+		WorldProperties defaults;
+		WorldBakeOptions bake_defaults;
+		region_min = glm::vec3(0, 0, 0);
+		region_max = glm::vec3(0, 0, 0);
+		has_region = false;
+		world_size = 256;
+		min_level = defaults.min_level;
+		max_level = defaults.max_level;
+		tile_level = -1;
+		resolution = defaults.chunk_resolution;
+		far_resolution = 0;
+		iters = defaults.process_iters;
+		overlap = defaults.overlap;
+		threads = (int)std::thread::hardware_concurrency();
+		batch = bake_defaults.batch_chunks;
+		resume = false;
+	}
+};
+
+static void print_usage()
+{
+	using namespace std;
+	cout << "Usage: bmf_bake [options] <output directory>" << endl << endl;
+	cout << "Options:" << endl;
+	cout << "  --region <x0,y0,z0,x1,y1,z1> World space bounds to bake (default the whole world)" << endl;
+	cout << "  --size <n>                   Half extent of the world (default 256)" << endl;
+	cout << "  --min-level <n>              Coarsest octree level baked" << endl;
+	cout << "  --max-level <n>              Finest octree level baked" << endl;
+	cout << "  --tile-level <n>             Octree level of the tile files (default max level - 3)" << endl;
+	cout << "  --resolution <n>             Chunk resolution" << endl;
+	cout << "  --far-resolution <n>         Chunk resolution of every level but the two finest (default --resolution)" << endl;
+	cout << "  --iters <n>                  Mesh processing iterations" << endl;
+	cout << "  --overlap <f>                Chunk overlap" << endl;
+	cout << "  --threads <n>                Worker threads (default all cores)" << endl;
+	cout << "  --batch <n>                  Chunks generated at once, bounds memory use (default " << WorldBakeOptions().batch_chunks << ")" << endl;
+	cout << "  --resume <0|1>               Skip tiles already in the output directory" << endl;
+}
+
+static bool parse_floats(const char* s, float* out, int count)
+{
+	for (int i = 0; i < count; i++)
+	{
+		char* end;
+		out[i] = strtof(s, &end);
+		if (end == s)
+			return false;
+		s = end;
+		if (i < count - 1)
+		{
+			if (*s != ',')
+				return false;
+			s++;
+		}
+	}
+	return *s == 0;
+}
+
+static bool parse_options(int argc, char** argv, BakeOptions& opts)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		const char* arg = argv[i];
+		const char* next = (i + 1 < argc ? argv[i + 1] : 0);
+		bool has_value = true;
+
+		if (!strcmp(arg, "--help") || !strcmp(arg, "-h"))
+			return false;
+
+		if (arg[0] != '-')
+		{
+			opts.output = arg;
+			continue;
+		}
+		if (!next)
+		{
+			std::cout << "Missing value for " << arg << "." << std::endl;
+			return false;
+		}
+
+		if (!strcmp(arg, "--region"))
+		{
+			float r[6];
+			has_value = parse_floats(next, r, 6);
+			opts.region_min = glm::vec3(std::min(r[0], r[3]), std::min(r[1], r[4]), std::min(r[2], r[5]));
+			opts.region_max = glm::vec3(std::max(r[0], r[3]), std::max(r[1], r[4]), std::max(r[2], r[5]));
+			opts.has_region = true;
+		}
+		else if (!strcmp(arg, "--size"))
+			opts.world_size = atoi(next);
+		else if (!strcmp(arg, "--min-level"))
+			opts.min_level = atoi(next);
+		else if (!strcmp(arg, "--max-level"))
+			opts.max_level = atoi(next);
+		else if (!strcmp(arg, "--tile-level"))
+			opts.tile_level = atoi(next);
+		else if (!strcmp(arg, "--resolution"))
+			opts.resolution = atoi(next);
+		else if (!strcmp(arg, "--far-resolution"))
+			opts.far_resolution = atoi(next);
+		else if (!strcmp(arg, "--iters"))
+			opts.iters = atoi(next);
+		else if (!strcmp(arg, "--overlap"))
+			opts.overlap = (float)atof(next);
+		else if (!strcmp(arg, "--threads"))
+			opts.threads = atoi(next);
+		else if (!strcmp(arg, "--batch"))
+			opts.batch = atoi(next);
+		else if (!strcmp(arg, "--resume"))
+			opts.resume = atoi(next) != 0;
+		else
+		{
+			std::cout << "Unknown option " << arg << "." << std::endl;
+			return false;
+		}
+
+		if (!has_value)
+		{
+			std::cout << "Invalid value for " << arg << ": " << next << std::endl;
+			return false;
+		}
+		i++;
+	}
+
+	if (opts.output.empty())
+		return false;
+	if (opts.tile_level < 0)
+		opts.tile_level = std::max(opts.min_level, opts.max_level - 3);
+	if (opts.threads < 1)
+		opts.threads = 1;
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	using namespace std;
+
+	BakeOptions opts;
+	if (!parse_options(argc, argv, opts))
+	{
+		print_usage();
+		return 1;
+	}
+
+	omp_set_num_threads(opts.threads);
+
+	WorldOctree world;
+	world.properties.min_level = opts.min_level;
+	world.properties.max_level = opts.max_level;
+	world.properties.chunk_resolution = opts.resolution;
+	for (int i = 0; i < opts.max_level - 1 && i < WORLD_MAX_LEVELS; i++)
+		world.properties.level_resolutions[i] = opts.far_resolution;
+	world.properties.process_iters = opts.iters;
+	world.properties.overlap = opts.overlap;
+	world.properties.num_threads = opts.threads;
+	world.init((uint32_t)opts.world_size);
+
+	ChunkGenerator& generator = world.watcher.generator;
+	generator.init(&world);
+
+	WorldBakeOptions bake_options;
+	bake_options.region_min = (opts.has_region ? opts.region_min : world.octree.pos);
+	bake_options.region_max = (opts.has_region ? opts.region_max : world.octree.pos + world.octree.size);
+	bake_options.tile_level = opts.tile_level;
+	bake_options.batch_chunks = opts.batch;
+	bake_options.skip_existing = opts.resume;
+	bake_options.directory = opts.output;
+
+	WorldBaker baker(&world, &generator);
+	auto start = chrono::steady_clock::now();
+	baker.on_batch = [&start](const WorldBakeStats& s)
+	{
+		auto elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+		printf("\r%llu chunks, %llu meshes, %llu tiles (%.1f MB) in %.1fs", (unsigned long long)s.chunks, (unsigned long long)s.meshes,
+			(unsigned long long)s.tiles, (double)s.bytes / (1024.0 * 1024.0), (double)elapsed / 1000.0);
+		fflush(stdout);
+	};
+
+	cout << "Baking levels " << opts.min_level << " to " << opts.max_level << " into " << opts.output << " on " << opts.threads << " threads..." << endl;
+	bool ok = baker.bake(bake_options);
+	auto elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+	const WorldBakeStats& s = baker.stats;
+	printf("\n%s: %llu chunks, %llu meshes in %llu tiles (%llu bytes), %llu uniform subtrees skipped, %llu existing tiles kept, %dms\n",
+		(ok ? "Done" : "Failed"), (unsigned long long)s.chunks, (unsigned long long)s.meshes, (unsigned long long)s.tiles, (unsigned long long)s.bytes,
+		(unsigned long long)s.uniform_subtrees, (unsigned long long)s.existing_tiles, (int)elapsed);
+
+	return (ok ? 0 : 1);
+}
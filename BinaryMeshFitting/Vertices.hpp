@@ -1,6 +1,7 @@
 #pragma once
 #include "PCH.h"
 #include <glm/glm.hpp>
+#include "SmartContainer.hpp"
 
 struct DualVertex
 {
@@ -23,6 +24,165 @@ struct DualVertex
 	inline DualVertex(glm::vec3 pos, glm::vec3 norm) : p(pos), n(norm) {}
 };
 
+// Structure-of-arrays storage for the vertices of a chunk. The meshing and smoothing
+// passes only touch a couple of fields each, so every field lives in its own array and
+// a pass only streams the bytes it uses. get/set/push_back give a DualVertex (AoS) view
+// for code that still works on whole vertices.
+struct DualVertexStore
+{
+	size_t size;
+	size_t count;
+
+	glm::vec3* p;
+	glm::vec3* n;
+	glm::vec3* color;
+	float* s;
+	uint32_t* adj_offset;
+	uint8_t* adj_next;
+	uint8_t* init_valence;
+	uint8_t* boundary;
+
+	inline DualVertexStore() : size(0), count(0), p(0), n(0), color(0), s(0), adj_offset(0), adj_next(0), init_valence(0), boundary(0) {}
+
+	inline ~DualVertexStore()
+	{
+		reset();
+	}
+
+	inline bool resize(size_t new_size)
+	{
+		if (!resize_array(p, new_size) || !resize_array(n, new_size) || !resize_array(color, new_size) || !resize_array(s, new_size) ||
+			!resize_array(adj_offset, new_size) || !resize_array(adj_next, new_size) || !resize_array(init_valence, new_size) || !resize_array(boundary, new_size))
+			return false;
+		size = new_size;
+		return true;
+	}
+
+	inline bool prepare(size_t amount)
+	{
+		if (count + amount <= size)
+			return true;
+		size_t new_size = (!size ? 32 : size);
+		while (new_size < count + amount)
+			new_size *= 2;
+		return resize(new_size);
+	}
+
+	// Bytes held by the arrays
+	inline size_t bytes() const
+	{
+		return size * (sizeof(glm::vec3) * 3 + sizeof(float) + sizeof(uint32_t) + sizeof(uint8_t) * 3);
+	}
+
+	inline DualVertex get(size_t i) const
+	{
+		DualVertex v;
+		v.boundary = boundary[i] != 0;
+		v.index = (uint32_t)i;
+		v.init_valence = init_valence[i];
+		v.valence = init_valence[i];
+		v.adj_next = adj_next[i];
+		v.adj_offset = adj_offset[i];
+		v.s = s[i];
+		v.p = p[i];
+		v.n = n[i];
+		v.color = color[i];
+		return v;
+	}
+
+	inline void set(size_t i, const DualVertex& v)
+	{
+		boundary[i] = v.boundary;
+		init_valence[i] = v.init_valence;
+		adj_next[i] = v.adj_next;
+		adj_offset[i] = v.adj_offset;
+		s[i] = v.s;
+		p[i] = v.p;
+		n[i] = v.n;
+		color[i] = v.color;
+	}
+
+	inline bool push_back(const DualVertex& v)
+	{
+		if (!prepare(1))
+			return false;
+		set(count++, v);
+		return true;
+	}
+
+	inline bool push_back(const DualVertexStore& other)
+	{
+		if (!other.count)
+			return true;
+		if (!prepare(other.count))
+			return false;
+		memcpy(p + count, other.p, sizeof(glm::vec3) * other.count);
+		memcpy(n + count, other.n, sizeof(glm::vec3) * other.count);
+		memcpy(color + count, other.color, sizeof(glm::vec3) * other.count);
+		memcpy(s + count, other.s, sizeof(float) * other.count);
+		memcpy(adj_offset + count, other.adj_offset, sizeof(uint32_t) * other.count);
+		memcpy(adj_next + count, other.adj_next, sizeof(uint8_t) * other.count);
+		memcpy(init_valence + count, other.init_valence, sizeof(uint8_t) * other.count);
+		memcpy(boundary + count, other.boundary, sizeof(uint8_t) * other.count);
+		count += other.count;
+		return true;
+	}
+
+	// AoS -> SoA
+	inline bool push_back(SmartContainer<DualVertex>& other)
+	{
+		if (!prepare(other.count))
+			return false;
+		for (size_t i = 0; i < other.count; i++)
+			set(count++, other.elements[i]);
+		return true;
+	}
+
+	// Zeroes the fields only the meshing passes fill (s, adjacency, valence, boundary), for
+	// vertices restored from just their p, n and color
+	inline void clear_topology(size_t first, size_t amount)
+	{
+		memset(s + first, 0, sizeof(float) * amount);
+		memset(adj_offset + first, 0, sizeof(uint32_t) * amount);
+		memset(adj_next + first, 0, sizeof(uint8_t) * amount);
+		memset(init_valence + first, 0, sizeof(uint8_t) * amount);
+		memset(boundary + first, 0, sizeof(uint8_t) * amount);
+	}
+
+	// SoA -> AoS, appended to out
+	inline bool copy_to(SmartContainer<DualVertex>& out) const
+	{
+		if (!out.prepare(count))
+			return false;
+		for (size_t i = 0; i < count; i++)
+			out.elements[out.count++] = get(i);
+		return true;
+	}
+
+	inline void reset()
+	{
+		free(p); free(n); free(color); free(s);
+		free(adj_offset); free(adj_next); free(init_valence); free(boundary);
+		p = n = color = 0;
+		s = 0;
+		adj_offset = 0;
+		adj_next = init_valence = boundary = 0;
+		size = 0;
+		count = 0;
+	}
+
+private:
+	template <class T>
+	static inline bool resize_array(T*& a, size_t new_size)
+	{
+		T* new_a = static_cast<T*>(realloc((void*)a, sizeof(T) * new_size));
+		if (!new_a)
+			return false;
+		a = new_a;
+		return true;
+	}
+};
+
 struct DMC_Isovertex
 {
 	uint32_t index;
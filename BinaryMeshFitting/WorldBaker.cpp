@@ -0,0 +1,195 @@
+#include "PCH.h"
+#include "WorldBaker.hpp"
+#include "WorldOctree.hpp"
+#include "WorldOctreeNode.hpp"
+#include "ChunkGenerator.hpp"
+#include "DMCChunk.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <mutex>
+
+#define DEFAULT_BAKE_TILE_LEVEL 4
+#define DEFAULT_BAKE_BATCH_CHUNKS 1024
+
+WorldBakeOptions::WorldBakeOptions()
+{
+	region_min = glm::vec3(0, 0, 0);
+	region_max = glm::vec3(0, 0, 0);
+	tile_level = DEFAULT_BAKE_TILE_LEVEL;
+	batch_chunks = DEFAULT_BAKE_BATCH_CHUNKS;
+	skip_existing = false;
+}
+
+WorldBaker::WorldBaker(WorldOctree* _world, ChunkGenerator* _generator) : world(_world), generator(_generator), failed(false)
+{
+	memset(&stats, 0, sizeof(WorldBakeStats));
+}
+
+WorldBaker::~WorldBaker()
+{
+}
+
+bool WorldBaker::bake(const WorldBakeOptions& _options)
+{
+	options = _options;
+	options.batch_chunks = (options.batch_chunks < 1 ? 1 : options.batch_chunks);
+	memset(&stats, 0, sizeof(WorldBakeStats));
+	failed = false;
+	if (!writer.init(options.directory))
+		return false;
+
+	WorldOctreeNode& root = world->octree;
+	visit(root.morton_code.code, root.pos, root.size, 0);
+	flush();
+	if (!writer.close())
+		failed = true;
+
+	stats.tiles = writer.tiles_written;
+	stats.bytes = writer.bytes_written;
+	return !failed;
+}
+
+void WorldBaker::visit(uint64_t code, const glm::vec3& pos, float size, int level)
+{
+	using namespace glm;
+	if (failed)
+		return;
+	const vec3& r_min = options.region_min;
+	const vec3& r_max = options.region_max;
+	if (pos.x >= r_max.x || pos.y >= r_max.y || pos.z >= r_max.z || pos.x + size <= r_min.x || pos.y + size <= r_min.y || pos.z + size <= r_min.z)
+		return;
+
+	// A tile on disk is everything below its node, a coarse chunk's tile only holds that chunk
+	bool skip_self = false;
+	if (options.skip_existing && level <= options.tile_level)
+	{
+		FILE* f = fopen(writer.get_path(code).c_str(), "rb");
+		if (f)
+		{
+			fclose(f);
+			stats.existing_tiles++;
+			if (level == options.tile_level)
+				return;
+			skip_self = true;
+		}
+	}
+
+	if (is_uniform(pos, size))
+	{
+		stats.uniform_subtrees++;
+		return;
+	}
+
+	const WorldProperties& properties = world->properties;
+	if (level >= properties.min_level && !skip_self)
+	{
+		WorldOctreeNode* n;
+		{
+			std::unique_lock<std::mutex> lock(world->chunk_mutex);
+			n = world->node_pool.newElement(0, nullptr, size, pos, (uint8_t)level);
+		}
+		n->morton_code = code;
+		n->generation_stage = GENERATION_STAGES_GENERATING;
+		batch.push_back(n);
+		if ((int)batch.count >= options.batch_chunks)
+			flush();
+	}
+
+	if (level >= properties.max_level)
+		return;
+	float half = size * 0.5f;
+	for (int i = 0; i < 8; i++)
+	{
+		vec3 offset = vec3((float)(i & 1), (float)((i >> 1) & 1), (float)((i >> 2) & 1)) * half;
+		visit((code << 3) | (uint64_t)i, pos + offset, half, level + 1);
+	}
+}
+
+void WorldBaker::flush()
+{
+	if (!batch.count)
+		return;
+
+	generator->process_queue(batch);
+
+	// Depth first order keeps each tile's chunks together, a tile is done once the next one starts
+	int count = (int)batch.count;
+	for (int i = 0; i < count; i++)
+	{
+		WorldOctreeNode* n = batch[i];
+		DMCChunk* chunk = n->chunk;
+		// Empty chunks are stored too, so they aren't sampled again at runtime. Uniform ones never are.
+		if (chunk && !chunk->uniform && !failed)
+		{
+			uint64_t tile_code = get_tile_code(n->morton_code.code, n->level);
+			if (!writer.is_open() || writer.get_tile_code() != tile_code)
+			{
+				if (!writer.close() || !writer.open(tile_code))
+					failed = true;
+			}
+			if (!failed && !writer.add(chunk))
+				failed = true;
+			if (chunk->contains_mesh)
+				stats.meshes++;
+		}
+		release(n);
+	}
+	stats.chunks += count;
+	batch.count = 0;
+
+	stats.tiles = writer.tiles_written;
+	stats.bytes = writer.bytes_written;
+	if (on_batch)
+		on_batch(stats);
+}
+
+void WorldBaker::release(WorldOctreeNode* n)
+{
+	if (n->mesh)
+	{
+		n->mesh->reset_data();
+		generator->mesh_allocator.free_element(n->mesh);
+		n->mesh = 0;
+	}
+
+	std::unique_lock<std::mutex> lock(world->chunk_mutex);
+	if (n->chunk)
+	{
+		// Blocks were released (or handed to the block cache) by the smooth stage
+		generator->vi_allocator.free_element(n->chunk->vi);
+		n->chunk->vi = 0;
+		world->chunk_pool.deleteElement(n->chunk);
+		n->chunk = 0;
+	}
+	world->node_pool.deleteElement(n);
+}
+
+// Conservative for every chunk in the subtree: the margin is the widest one get_sample_bounds
+// gives any of them, which is that of a chunk the subtree's size at the lowest resolution.
+bool WorldBaker::is_uniform(const glm::vec3& pos, float size)
+{
+	const Sampler& sampler = world->sampler;
+	const WorldProperties& properties = world->properties;
+	if (!sampler.range)
+		return false;
+
+	int min_resolution = properties.chunk_resolution;
+	for (int i = properties.min_level; i <= properties.max_level; i++)
+		min_resolution = std::min(min_resolution, properties.get_resolution(i));
+	float overlap = properties.overlap + 0.005f * (float)properties.process_iters;
+	float margin = size * overlap + size * (1.0f + overlap * 2.0f) / (float)(min_resolution - 1);
+
+	glm::vec3 box_min = pos - margin;
+	glm::vec3 box_max = pos + (size + margin);
+	if (world->edits.intersects(box_min, box_max))
+		return false;
+	float d_min, d_max;
+	return sampler.range(sampler.world_size, box_min, box_max, d_min, d_max, &world->noise_properties) && (d_min >= 0.0f || d_max < 0.0f);
+}
+
+uint64_t WorldBaker::get_tile_code(uint64_t code, int level) const
+{
+	return (level > options.tile_level ? code >> (3 * (level - options.tile_level)) : code);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <functional>
+#include <glm/glm.hpp>
+#include "SmartContainer.hpp"
+#include "MeshTiles.hpp"
+
+struct WorldBakeOptions
+{
+	glm::vec3 region_min;
+	glm::vec3 region_max;
+	int tile_level;			// Chunks below a node at this level share its tile, coarser chunks get one each
+	int batch_chunks;		// Chunks generated at once, which bounds the working set
+	bool skip_existing;		// Leave tiles already on disk alone, so an interrupted bake can resume
+	std::string directory;
+
+	WorldBakeOptions();
+};
+
+struct WorldBakeStats
+{
+	uint64_t chunks;			// Sent through the generator
+	uint64_t uniform_subtrees;	// Skipped whole, the sampler's range query proved them all air or all solid
+	uint64_t existing_tiles;
+	uint64_t tiles;
+	uint64_t meshes;
+	uint64_t bytes;
+};
+
+// Generates every chunk of the world's levels (min_level to max_level) inside a region and streams
+// their meshes to tile files (see MeshTileWriter), for worlds that wouldn't fit in memory. The octree
+// is walked depth first in Morton order, so the chunks of a tile come out together and each batch
+// covers a compact piece of the world, which keeps the generator's caches useful. Only one batch of
+// nodes and chunks exists at a time, they go back to the world's pools once written.
+class WorldBaker
+{
+public:
+	WorldBaker(class WorldOctree* world, class ChunkGenerator* generator);
+	~WorldBaker();
+
+	bool bake(const WorldBakeOptions& options);
+
+	WorldBakeStats stats;
+	// Called after every batch is written
+	std::function<void(const WorldBakeStats&)> on_batch;
+
+private:
+	class WorldOctree* world;
+	class ChunkGenerator* generator;
+	WorldBakeOptions options;
+	MeshTileWriter writer;
+	SmartContainer<class WorldOctreeNode*> batch;
+	bool failed;
+
+	void visit(uint64_t code, const glm::vec3& pos, float size, int level);
+	void flush();
+	void release(class WorldOctreeNode* n);
+	bool is_uniform(const glm::vec3& pos, float size);
+	uint64_t get_tile_code(uint64_t code, int level) const;
+};
@@ -16,6 +16,9 @@
 #define DEFAULT_THREADS 4
 #define DEFAULT_ITERATIONS 0
 #define DEFAULT_RESOLUTION 32
+#define DEFAULT_MESH_LRU_BYTES (64 * 1024 * 1024)
+#define DEFAULT_BLOCK_LRU_BYTES (64 * 1024 * 1024)
+#define DEFAULT_SLAB_STORE_BYTES (16 * 1024 * 1024)
 
 __declspec(noinline) WorldProperties::WorldProperties()
 {
@@ -27,9 +30,15 @@ __declspec(noinline) WorldProperties::WorldProperties()
 	num_threads = DEFAULT_THREADS;
 	process_iters = DEFAULT_ITERATIONS;
 	chunk_resolution = DEFAULT_RESOLUTION;
+	for (int i = 0; i < WORLD_MAX_LEVELS; i++)
+		level_resolutions[i] = 0;
 	enable_stitching = false;
 	overlap = 0.035f;
 	boundary_processing = false;
+	mesh_lru_bytes = DEFAULT_MESH_LRU_BYTES;
+	block_lru_bytes = DEFAULT_BLOCK_LRU_BYTES;
+	retain_all_blocks = false;
+	slab_store_bytes = DEFAULT_SLAB_STORE_BYTES;
 }
 
 WorldOctree::WorldOctree()
@@ -92,8 +101,6 @@ void destroy_world_nodes(MemoryPool<WorldOctreeNode>* pool, MemoryPool<DMCChunk>
 WorldOctree::~WorldOctree()
 {
 	destroy_world_nodes(&node_pool, &chunk_pool, &octree);
-	for (int i = 0; i < 8; i++)
-		delete sampler.noise_samplers[i];
 }
 
 void WorldOctree::destroy_leaves()
@@ -124,6 +131,8 @@ void WorldOctree::init(uint32_t size)
 	new(&octree) WorldOctreeNode(0, 0, (float)size, pos, 0);
 	octree.flags = NODE_FLAGS_DIRTY | NODE_FLAGS_DRAW;
 	octree.morton_code = 1;
+
+	edits.init(pos, (float)size);
 }
 
 void WorldOctree::split_leaves()
@@ -264,8 +273,35 @@ void WorldOctree::create_chunk(WorldOctreeNode* n)
 {
 	n->chunk = chunk_pool.newElement();
 	n->chunk->init(n->pos, n->size, n->level, sampler, n->morton_code.code);
-	n->chunk->dim = properties.chunk_resolution;
+	n->chunk->dim = properties.get_resolution(n->level);
 	n->chunk->id = next_chunk_id++;
+
+	classify_chunk(n);
+}
+
+void WorldOctree::classify_chunk(WorldOctreeNode* n)
+{
+	n->chunk->uniform = false;
+	if (!sampler.range)
+		return;
+
+	// Air or solid throughout, with the widest overlap the generator may sample it at. The range
+	// query knows nothing of brush edits, chunks they reach are always sampled.
+	glm::vec3 box_min, box_max;
+	get_sample_bounds(n, box_min, box_max);
+	if (edits.intersects(box_min, box_max))
+		return;
+	float d_min, d_max;
+	if (sampler.range(sampler.world_size, box_min, box_max, d_min, d_max, &noise_properties) && (d_min >= 0.0f || d_max < 0.0f))
+		n->chunk->uniform = true;
+}
+
+void WorldOctree::get_sample_bounds(WorldOctreeNode* n, glm::vec3& out_min, glm::vec3& out_max)
+{
+	float overlap = properties.overlap + 0.005f * (float)properties.process_iters;
+	float cell = n->size * (1.0f + overlap * 2.0f) / (float)(n->chunk ? n->chunk->dim - 1 : properties.get_resolution(n->level) - 1);
+	out_min = n->pos - (n->size * overlap + cell);
+	out_max = n->pos + (n->size * (1.0f + overlap) + cell);
 }
 
 void WorldOctree::upload_batch(SmartContainer<WorldOctreeNode*>& batch)
@@ -280,25 +316,19 @@ void WorldOctree::upload_batch(SmartContainer<WorldOctreeNode*>& batch)
 	}
 }
 
-void WorldOctree::generate_outline(SmartContainer<WorldOctreeNode*>& batch)
+void WorldOctree::generate_outline(SmartContainer<WorldOctreeNode*>& batch, SmartContainer<glm::vec3>& v_pos, SmartContainer<uint32_t>& inds)
 {
 	using namespace std;
 
 	cout << "Generating outline...";
 	clock_t start_clock = clock();
 
-	outline_chunk.init(false, false);
-	SmartContainer<glm::vec3> v_pos;
-	SmartContainer<uint32_t> inds;
-
 	int count = (int)batch.count;
 	for (int i = 0; i < count; i++)
 	{
 		batch[i]->generate_outline(v_pos, inds);
 	}
 
-	outline_chunk.set_data(v_pos, inds);
-
 	double elapsed = clock() - start_clock;
 	cout << "done (" << (int)(elapsed / (double)CLOCKS_PER_SEC * 1000.0) << "ms)" << endl;
 }
@@ -326,7 +356,7 @@ void WorldOctree::init_updates(glm::vec3 focus_pos)
 	watcher.init(this, focus_pos);
 }
 
-void WorldOctree::process_from_render_thread()
+void WorldOctree::process_from_render_thread(const std::function<void(WorldOctreeNode*)>& upload_node, const std::function<void(ChunkMesh&)>& upload_stitches)
 {
 	// Renderables mutex is already locked from the main render loop
 
@@ -349,17 +379,24 @@ void WorldOctree::process_from_render_thread()
 				break;
 			}
 			n->generation_stage = GENERATION_STAGES_UPLOADING;
-			n->upload();
+			bool has_data = n->mesh && n->mesh->vertex_count > 0 && (n->mesh->index_count > 0 || (n->chunk->vi && n->chunk->vi->mesh_indexes.count > 0));
+			if (n->mesh && upload_node)
+				upload_node(n);
+			else if (!n->mesh && n->gl_chunk && watcher.release_callback)
+				watcher.release_callback(n);	// Re-meshed after an edit and nothing is left
 
 			if (!FAST_GROUPING)
 			{
-				watcher.generator.vi_allocator.free_element(n->chunk->vi);
-				n->chunk->vi = 0;
+				watcher.generator.retire_mesh(n);
 			}
 			n->generation_stage = GENERATION_STAGES_DONE;
-			if (n->gl_chunk)
-				n->gl_chunk->reset_data();
-			if (n->gl_chunk && n->gl_chunk->p_count > 0 && n->gl_chunk->v_count > 0)
+			if (n->mesh)
+			{
+				n->mesh->reset_data();
+				watcher.generator.mesh_allocator.free_element(n->mesh);
+				n->mesh = 0;
+			}
+			if (has_data)
 			{
 				upload_count++;
 			}
@@ -378,7 +415,8 @@ void WorldOctree::process_from_render_thread()
 	if (watcher.generator.stitcher.stage == STITCHING_STAGES_NEEDS_UPLOAD)
 	{
 		watcher.generator.stitcher.stage = STITCHING_STAGES_UPLOADING;
-		watcher.generator.stitcher.upload();
+		if (upload_stitches)
+			upload_stitches(watcher.generator.stitcher.mesh);
 		watcher.generator.stitcher.stage = STITCHING_STAGES_READY;
 	}
 }
@@ -5,16 +5,20 @@
 #include "MemoryPool.h"
 #include "DMCChunk.hpp"
 #include "SmartContainer.hpp"
-#include "GLChunk.hpp"
+#include "ChunkMesh.hpp"
 #include "ColorMapper.hpp"
 #include "WorldWatcher.hpp"
 #include "ResourceAllocator.hpp"
 #include "ChunkBlocks.hpp"
 #include "NoiseSampler.hpp"
+#include "EditLayer.hpp"
 
 #include <list>
 #include <stack>
 #include <mutex>
+#include <functional>
+
+#define WORLD_MAX_LEVELS 33
 
 struct WorldProperties
 {
@@ -26,11 +30,25 @@ struct WorldProperties
 	int num_threads;
 	int process_iters;
 	int chunk_resolution;
+	int level_resolutions[WORLD_MAX_LEVELS];	// Per octree level, 0 falls back to chunk_resolution
 	bool enable_stitching;
 	float overlap;
 	bool boundary_processing;
+	std::string mesh_cache_path;	// Empty disables the disk mesh cache
+	std::string baked_mesh_path;	// Directory of tiles written by WorldBaker to load meshes from, empty disables
+	size_t mesh_lru_bytes;			// 0 disables the in-memory cache of retired meshes
+	size_t block_lru_bytes;			// 0 disables keeping density and binary blocks for re-meshing
+	bool retain_all_blocks;			// Keep blocks of every finished chunk, not just edited ones
+	size_t slab_store_bytes;		// 0 disables sharing face samples between neighbouring chunks
 
 	__declspec(noinline) WorldProperties();
+
+	// The resolution chunks at level are created with
+	inline int get_resolution(int level) const
+	{
+		int r = (level >= 0 && level < WORLD_MAX_LEVELS ? level_resolutions[level] : 0);
+		return (r > 0 ? r : chunk_resolution);
+	}
 };
 
 class WorldOctree
@@ -44,9 +62,9 @@ public:
 	std::list<WorldOctreeNode*> leaves;
 	SmartContainer<DualVertex> v_out;
 	SmartContainer<uint32_t> i_out;
-	GLChunk outline_chunk;
 	int next_chunk_id;
 	NoiseSamplers::NoiseSamplerProperties noise_properties;
+	EditLayer edits;
 
 	uint32_t leaf_count;
 	glm::vec3 focus_point;
@@ -69,12 +87,16 @@ public:
 	bool node_needs_split(const glm::vec3& center, WorldOctreeNode* n);
 	bool node_needs_group(const glm::vec3& center, WorldOctreeNode* n);
 	void create_chunk(WorldOctreeNode* n);
+	// Sets chunk->uniform when the sampler's range query proves it all air or all solid
+	void classify_chunk(WorldOctreeNode* n);
+	// Box holding every sample of the node's chunk at the widest overlap, plus the cell around it a brush edit can reach from
+	void get_sample_bounds(WorldOctreeNode* n, glm::vec3& out_min, glm::vec3& out_max);
 	void upload_batch(SmartContainer<WorldOctreeNode*>& batch);
-	void generate_outline(SmartContainer<WorldOctreeNode*>& batch);
+	void generate_outline(SmartContainer<WorldOctreeNode*>& batch, SmartContainer<glm::vec3>& v_pos, SmartContainer<uint32_t>& inds);
 	DMCChunk* get_chunk_id_at(glm::vec3 p);
 
 	void init_updates(glm::vec3 focus_pos);
-	void process_from_render_thread();
+	void process_from_render_thread(const std::function<void(WorldOctreeNode*)>& upload_node, const std::function<void(ChunkMesh&)>& upload_stitches);
 
 private:
 };
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include "Tables.hpp"
 #include "DefaultOptions.h"
 #include "ResourceAllocator.hpp"
+#include "MeshArchive.hpp"
 
 WorldOctreeNode::WorldOctreeNode() : OctreeNode()
 {
@@ -14,6 +15,7 @@ WorldOctreeNode::WorldOctreeNode() : OctreeNode()
 	flags = 0;
 	renderable_prev = 0;
 	renderable_next = 0;
+	mesh = 0;
 	gl_chunk = 0;
 	stitch_flag = false;
 	stitch_stored_flag = false;
@@ -31,6 +33,7 @@ WorldOctreeNode::WorldOctreeNode(uint32_t _index, WorldOctreeNode* _parent, floa
 	generation_stage = 0;
 	renderable_prev = 0;
 	renderable_next = 0;
+	mesh = 0;
 	gl_chunk = 0;
 	force_chunk_octree = false;
 	stitch_flag = false;
@@ -42,6 +45,7 @@ WorldOctreeNode::WorldOctreeNode(uint32_t _index) : WorldOctreeNode()
 {
 	world_node_flag = true;
 	index = _index;
+	mesh = 0;
 	gl_chunk = 0;
 	force_chunk_octree = false;
 	stitch_flag = false;
@@ -65,34 +69,33 @@ void WorldOctreeNode::init(uint32_t _index, WorldOctreeNode* _parent, float _siz
 	flags = 0;
 }
 
-bool WorldOctreeNode::format(ResourceAllocator<GLChunk>* allocator)
+bool WorldOctreeNode::format(ResourceAllocator<ChunkMesh>* allocator)
 {
 	assert(allocator);
 	
 	if (chunk && chunk->contains_mesh)
 	{
-		assert(chunk->vi);
-		if (!gl_chunk)
+		assert(chunk->vi || chunk->baked_entry);
+		if (!mesh)
 		{
-			gl_chunk = allocator->new_element();
-			if (!gl_chunk)
+			mesh = allocator->new_element();
+			if (!mesh)
 				return false;
 		}
-		gl_chunk->format_data(chunk->vi->vertices, chunk->vi->mesh_indexes, false, false);
-		
-	}
-
-	return true;
-}
-
-bool WorldOctreeNode::upload()
-{
-	if (chunk && chunk->contains_mesh)
-	{
-		assert(gl_chunk);
-		gl_chunk->init(true, true);
-		return gl_chunk->set_data(gl_chunk->p_data, gl_chunk->c_data, &chunk->vi->mesh_indexes);
-		//return gl_chunk->set_data(&chunk->vi->mesh_indexes, FLAT_QUADS);
+		if (chunk->baked_entry)
+		{
+			// Already packed, to the entry's world space bounds. Those are moved into the chunk's
+			// cell space the vertices are drawn in.
+			using namespace glm;
+			const MeshArchive* archive = chunk->baked_archive;
+			const MeshArchiveEntry* e = chunk->baked_entry;
+			vec3 box_min = vec3(e->box_min[0], e->box_min[1], e->box_min[2]);
+			vec3 extent = vec3(e->box_max[0], e->box_max[1], e->box_max[2]) - box_min;
+			mesh->set_view(archive->get_vertices(e), e->vertex_count, archive->get_indexes(e), e->index_count, e->index_size,
+				(box_min - chunk->overlap_pos) / chunk->scale, extent / chunk->scale);
+		}
+		else if (!mesh->format_packed(chunk->vi->vertices, chunk->vi->mesh_indexes))
+			return false;
 	}
 
 	return true;
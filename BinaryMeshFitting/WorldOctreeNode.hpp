@@ -1,16 +1,12 @@
 #pragma once
 
-#include <gl/glew.h>
-#define GLFW_DLL
-#include <GLFW/glfw3.h>
 #define GLM_FORCE_NO_CTOR_INIT
 #define GLM_FORCE_INLINE
 #include <glm/glm.hpp>
 #include <atomic>
 #include "Vertices.hpp"
-#include "GLChunk.hpp"
+#include "ChunkMesh.hpp"
 #include "ResourceAllocator.hpp"
-#include "DynamicGLChunk.hpp"
 
 typedef enum NODE_FLAGS
 {
@@ -23,7 +19,9 @@ typedef enum NODE_FLAGS
 	NODE_FLAGS_DIRTY = 32,
 	NODE_FLAGS_DRAW_CHILDREN = 64,
 	NODE_FLAGS_GENERATING = 128,
-	NODE_FLAGS_SUPERCEDED = 256
+	NODE_FLAGS_SUPERCEDED = 256,
+	NODE_FLAGS_CANCELLED = 512,
+	NODE_FLAGS_EDITED = 1024
 };
 
 typedef enum GENERATION_STAGES
@@ -135,10 +133,12 @@ public:
 	glm::vec3 middle;
 	bool world_leaf_flag;
 	bool force_chunk_octree;
-	GLChunk* gl_chunk;
+	ChunkMesh* mesh;
+	// Owned by the renderer, opaque to the world
+	class GLChunk* gl_chunk;
 	bool stitch_flag;
 	bool stitch_stored_flag;
-	VertexRegion* stitches;
+	struct VertexRegion* stitches;
 
 	WorldOctreeNode();
 	WorldOctreeNode(uint32_t _index, WorldOctreeNode* _parent, float _size, glm::vec3 _pos, uint8_t _level);
@@ -147,8 +147,7 @@ public:
 
 	void init(uint32_t _index, WorldOctreeNode* _parent, float _size, glm::vec3 _pos, uint8_t _level);
 
-	bool format(ResourceAllocator<GLChunk>* allocator);
-	bool upload();
+	bool format(ResourceAllocator<ChunkMesh>* allocator);
 	void unlink();
 };
 
@@ -12,15 +12,26 @@
 WorldStitcher::WorldStitcher()
 {
 	stage = STITCHING_STAGES_READY;
+	v_containers = 0;
+	v_container_count = 0;
 }
 
 WorldStitcher::~WorldStitcher()
 {
+	delete[] v_containers;
 }
 
-void WorldStitcher::init()
+void WorldStitcher::prepare_containers()
 {
-	gl_chunk.init(true, true);
+	int threads = omp_get_max_threads();
+	if (threads > v_container_count)
+	{
+		delete[] v_containers;
+		v_containers = new SmartContainer<DualVertex>[threads];
+		v_container_count = threads;
+	}
+	for (int i = 0; i < v_container_count; i++)
+		v_containers[i].count = 0;
 }
 
 void WorldStitcher::stitch_all(WorldOctreeNode* root)
@@ -29,8 +40,7 @@ void WorldStitcher::stitch_all(WorldOctreeNode* root)
 		return;
 
 	vertices.count = 0;
-	for (int i = 0; i < 8; i++)
-		v_containers[i].count = 0;
+	prepare_containers();
 
 	SmartContainer<WorldOctreeNode*> cells;
 	gather_all_cells(root, cells);
@@ -42,7 +52,7 @@ void WorldStitcher::stitch_all(WorldOctreeNode* root)
 		int thread_id = omp_get_thread_num();
 		stitch_cell(cells[i], v_containers[thread_id]);
 	}
-	for (int i = 0; i < 8; i++)
+	for (int i = 0; i < v_container_count; i++)
 	{
 		vertices.push_back(v_containers[i]);
 	}
@@ -69,7 +79,7 @@ void WorldStitcher::stitch_all(emilib::HashMap<MortonCode, class WorldOctreeNode
 	cout << "Generated " << (int)chunks.count << " dual chunks in " << (int)(chunks_delta / (double)CLOCKS_PER_SEC * 1000.0) << "ms." << endl;
 	cout << "Stitching dual chunks...";
 
-	SmartContainer<DualVertex> v_containers[8];
+	prepare_containers();
 	start_clock = clock();
 	int count = (int)chunks.count;
 	std::atomic<int> skipped_count = 0;
@@ -84,7 +94,7 @@ void WorldStitcher::stitch_all(emilib::HashMap<MortonCode, class WorldOctreeNode
 			std::cout << i / ten * 10 << "%...";
 	}
 
-	for (int i = 0; i < 8; i++)
+	for (int i = 0; i < v_container_count; i++)
 	{
 		vertices.push_back(v_containers[i]);
 	}
@@ -98,14 +108,9 @@ void WorldStitcher::stitch_all_linear(emilib::HashMap<MortonCode, class WorldOct
 {
 }
 
-void WorldStitcher::upload()
-{
-	gl_chunk.set_data(gl_chunk.p_data, gl_chunk.c_data, 0);
-}
-
 void WorldStitcher::format()
 {
-	gl_chunk.format_data_tris(vertices);
+	mesh.format_packed_tris(vertices);
 }
 
 void WorldStitcher::gather_all_cells(WorldOctreeNode* n, SmartContainer<WorldOctreeNode*>& out)
@@ -162,8 +167,7 @@ void WorldStitcher::gather_marked_cells(SmartContainer<WorldOctreeNode*>& in_out
 void WorldStitcher::stitch_batch(SmartContainer<WorldOctreeNode*>& batch)
 {
 	vertices.count = 0;
-	for (int i = 0; i < 8; i++)
-		v_containers[i].count = 0;
+	prepare_containers();
 
 	clock_t start_clock = clock();
 
@@ -175,7 +179,7 @@ void WorldStitcher::stitch_batch(SmartContainer<WorldOctreeNode*>& batch)
 		int thread_id = omp_get_thread_num();
 		stitch_cell(batch[i], v_containers[thread_id]);
 	}
-	for (int i = 0; i < 8; i++)
+	for (int i = 0; i < v_container_count; i++)
 	{
 		vertices.push_back(v_containers[i]);
 	}
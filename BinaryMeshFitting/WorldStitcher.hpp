@@ -8,12 +8,11 @@
 #include <glm/glm.hpp>
 #include "ThreadDebug.hpp"
 #include "SmartContainer.hpp"
-#include "GLChunk.hpp"
+#include "ChunkMesh.hpp"
 #include "HashMap.hpp"
 #include "WorldOctreeNode.hpp"
 #include "sparsepp/spp.h"
 #include <map>
-#include "DynamicGLChunk.hpp"
 
 typedef enum STITCHING_STAGES
 {
@@ -33,12 +32,10 @@ public:
 	WorldStitcher();
 	~WorldStitcher();
 
-	void init();
 	void stitch_all(class WorldOctreeNode* root);
 	void stitch_all(emilib::HashMap<MortonCode, class WorldOctreeNode*>& leaves, spp::sparse_hash_map<MortonCode, DMCNode*>& chunk_nodes);
 	void stitch_all_linear(emilib::HashMap<MortonCode, class WorldOctreeNode*>& chunks);
 
-	void upload();
 	void format();
 
 	void gather_marked_cells(SmartContainer<WorldOctreeNode*>& in_out);
@@ -47,12 +44,15 @@ public:
 	std::mutex _mutex;
 	std::atomic<int> stage;
 
-	GLChunk gl_chunk;
-	DynamicGLChunk dynamic_chunk;
+	ChunkMesh mesh;
 
 private:
 	SmartContainer<DualVertex> vertices;
-	SmartContainer<DualVertex> v_containers[8];
+	// One per OpenMP thread, reallocated when there are more threads than containers
+	SmartContainer<DualVertex>* v_containers;
+	int v_container_count;
+
+	void prepare_containers();
 
 	void gather_all_cells(WorldOctreeNode* n, SmartContainer<WorldOctreeNode*>& out);
 
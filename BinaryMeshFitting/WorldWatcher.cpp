@@ -4,6 +4,7 @@
 #include "WorldOctreeNode.hpp"
 #include "DefaultOptions.h"
 #include <iostream>
+#include <algorithm>
 
 #define RESTITCH_ALL true
 
@@ -11,6 +12,8 @@ WorldWatcher::WorldWatcher() : ThreadDebug("WorldWatcher")
 {
 	this->world = 0;
 	this->_stop = false;
+	this->focus_pos = glm::vec3(0, 0, 0);
+	this->last_focus_pos = glm::vec3(0, 0, 0);
 }
 
 WorldWatcher::~WorldWatcher()
@@ -61,14 +64,15 @@ void WorldWatcher::update()
 			bool enable_stitching = world->properties.enable_stitching;
 			{
 				std::unique_lock<std::mutex> renderables_lock(renderables_mutex);
-				check_leaves(dirty_batch, max_gen);
+				check_leaves(pos, dirty_batch, max_gen);
 				process_batch(dirty_batch, generate_batch, stitch_batch);
+				check_edits(generate_batch);
 			}
 			if (generate_batch.count > 0)
 			{
 				std::cout << "Generating " << generate_batch.count << " chunks...";
 				clock_t start_clock = clock();
-				generator.process_queue(generate_batch);
+				generator.process_queue(generate_batch, true);
 				double chunk_time = clock() - start_clock;
 				std::cout << "done (" << (int)(chunk_time / (double)CLOCKS_PER_SEC * 1000.0) << "ms)" << std::endl;
 				if (enable_stitching)
@@ -152,27 +156,40 @@ void WorldWatcher::stop()
 	}
 }
 
-void WorldWatcher::check_leaves(SmartContainer<class WorldOctreeNode*>& batch_out, const int max_gen)
+void WorldWatcher::check_leaves(const glm::vec3& pos, SmartContainer<class WorldOctreeNode*>& batch_out, const int max_gen)
 {
+	// Splits are ranked by their approximate screen-space error (size over distance to the
+	// focus point), rebuilt every update so the order follows the camera. Groups only ever
+	// reduce work and are not budgeted.
+	split_candidates.clear();
 	WorldOctreeNode* n = renderables_head;
-	int counter = 0;
-	while (n && counter < max_gen)
+	while (n)
 	{
-		if (world->node_needs_split(focus_pos, n))
+		if (world->node_needs_split(pos, n))
 		{
-			handle_split_check(n, batch_out);
-			counter += 8;
+			float d = glm::distance(n->middle, pos);
+			split_candidates.push_back(std::make_pair(n->size / (d + 1.0f), n));
 		}
-		else if (n->world_leaf_flag && n->parent && world->node_needs_group(focus_pos, (WorldOctreeNode*)n->parent))
+		else if (n->world_leaf_flag && n->parent && world->node_needs_group(pos, (WorldOctreeNode*)n->parent))
 		{
 			handle_group_check((WorldOctreeNode*)n->parent, batch_out);
-			//counter++;
 		}
 		n = n->renderable_next;
 	}
+
+	std::sort(split_candidates.begin(), split_candidates.end(),
+		[](const std::pair<float, WorldOctreeNode*>& a, const std::pair<float, WorldOctreeNode*>& b) { return a.first > b.first; });
+
+	int counter = 0;
+	int count = (int)split_candidates.size();
+	for (int i = 0; i < count && counter < max_gen; i++)
+	{
+		if (handle_split_check(split_candidates[i].second, batch_out))
+			counter += 8;
+	}
 }
 
-void WorldWatcher::handle_split_check(WorldOctreeNode* n, SmartContainer<class WorldOctreeNode*>& batch_out)
+bool WorldWatcher::handle_split_check(WorldOctreeNode* n, SmartContainer<class WorldOctreeNode*>& batch_out)
 {
 	int flags = n->flags;
 	int stage = n->generation_stage;
@@ -183,7 +200,9 @@ void WorldWatcher::handle_split_check(WorldOctreeNode* n, SmartContainer<class W
 			n->flags ^= NODE_FLAGS_GROUP;
 		n->force_chunk_octree = false;
 		batch_out.push_back(n);
+		return true;
 	}
+	return false;
 }
 
 void WorldWatcher::handle_group_check(WorldOctreeNode* n, SmartContainer<class WorldOctreeNode*>& batch_out)
@@ -211,6 +230,40 @@ void WorldWatcher::handle_group_check(WorldOctreeNode* n, SmartContainer<class W
 	}
 }
 
+void WorldWatcher::check_edits(SmartContainer<class WorldOctreeNode*>& generate_batch_out)
+{
+	new_edits.clear();
+	world->edits.take_pending(new_edits);
+	if (new_edits.empty())
+		return;
+
+	// Only chunks that are drawn and idle need re-meshing, any other chunk is either being
+	// generated after the edit was made or not visible, and picks it up when it next samples
+	WorldOctreeNode* n = renderables_head;
+	while (n)
+	{
+		int flags = n->flags;
+		if (n->chunk && (flags & NODE_FLAGS_DRAW) && !(flags & (NODE_FLAGS_SPLIT | NODE_FLAGS_GROUP)) && n->generation_stage == GENERATION_STAGES_DONE)
+		{
+			glm::vec3 box_min, box_max;
+			world->get_sample_bounds(n, box_min, box_max);
+			for (const BrushEdit& e : new_edits)
+			{
+				glm::vec3 e_min = e.get_min(), e_max = e.get_max();
+				if (e_min.x <= box_max.x && e_min.y <= box_max.y && e_min.z <= box_max.z &&
+					box_min.x <= e_max.x && box_min.y <= e_max.y && box_min.z <= e_max.z)
+				{
+					n->flags |= NODE_FLAGS_EDITED;
+					n->generation_stage = GENERATION_STAGES_GENERATING;
+					generate_batch_out.push_back(n);
+					break;
+				}
+			}
+		}
+		n = n->renderable_next;
+	}
+}
+
 void WorldWatcher::process_batch(SmartContainer<class WorldOctreeNode*>& batch_in, SmartContainer<class WorldOctreeNode*>& batch_out, SmartContainer<class WorldOctreeNode*>& stitch_batch)
 {
 	int count = (int)batch_in.count;
@@ -248,7 +301,17 @@ void WorldWatcher::post_process_batch(SmartContainer<class WorldOctreeNode*>& ba
 
 		if (flags & NODE_FLAGS_SPLIT)
 		{
-			if (true || !world->node_needs_group(focus_pos, n))
+			// The generator drops children that went stale before they were sampled, in that
+			// case the split is undone and the parent keeps drawing its own mesh
+			bool cancelled = false;
+			for (int i = 0; i < 8; i++)
+			{
+				WorldOctreeNode* c = (WorldOctreeNode*)n->children[i];
+				if (c && (c->flags & NODE_FLAGS_CANCELLED))
+					cancelled = true;
+			}
+
+			if (!cancelled)
 			{
 				for (int i = 0; i < 8; i++)
 				{
@@ -275,11 +338,7 @@ void WorldWatcher::post_process_batch(SmartContainer<class WorldOctreeNode*>& ba
 				}
 				n->flags &= ~NODE_FLAGS_DRAW;
 				n->flags |= NODE_FLAGS_SUPERCEDED;
-				if (n->gl_chunk)
-				{
-					generator.gl_allocator.free_element(n->gl_chunk);
-					n->gl_chunk = 0;
-				}
+				release_meshes(n);
 				n->generation_stage = GENERATION_STAGES_DONE;
 				n->flags ^= NODE_FLAGS_SPLIT;
 
@@ -305,11 +364,11 @@ void WorldWatcher::post_process_batch(SmartContainer<class WorldOctreeNode*>& ba
 					{
 						unlink_renderable(c);
 						generator.binary_allocator.free_element(c->chunk->binary_block);
-						generator.vi_allocator.free_element(c->chunk->vi);
+						generator.retire_mesh(c);
 						generator.cell_allocator.free_element(c->chunk->cell_block);
 						generator.inds_allocator.free_element(c->chunk->indexes_block);
 						generator.density_allocator.free_element(c->chunk->density_block);
-						generator.gl_allocator.free_element(c->gl_chunk);
+						release_meshes(c);
 						world->chunk_pool.deleteElement(c->chunk);
 						world->node_pool.deleteElement(c);
 					}
@@ -330,11 +389,11 @@ void WorldWatcher::post_process_batch(SmartContainer<class WorldOctreeNode*>& ba
 					{
 						unlink_renderable(c);
 						generator.binary_allocator.free_element(c->chunk->binary_block);
-						generator.vi_allocator.free_element(c->chunk->vi);
+						generator.retire_mesh(c);
 						generator.cell_allocator.free_element(c->chunk->cell_block);
 						generator.inds_allocator.free_element(c->chunk->indexes_block);
 						generator.density_allocator.free_element(c->chunk->density_block);
-						generator.gl_allocator.free_element(c->gl_chunk);
+						release_meshes(c);
 						world->chunk_pool.deleteElement(c->chunk);
 						world->node_pool.deleteElement(c);
 					}
@@ -395,6 +454,18 @@ void WorldWatcher::process_stitching(SmartContainer<class WorldOctreeNode*>& bat
 {
 }
 
+void WorldWatcher::release_meshes(WorldOctreeNode* n)
+{
+	if (n->mesh)
+	{
+		n->mesh->reset_data();
+		generator.mesh_allocator.free_element(n->mesh);
+		n->mesh = 0;
+	}
+	if (n->gl_chunk && release_callback)
+		release_callback(n);
+}
+
 void WorldWatcher::unlink_renderable(WorldOctreeNode* n)
 {
 	if (renderables_head == n)
@@ -2,6 +2,8 @@
 
 #include <thread>
 #include <mutex>
+#include <condition_variable>
+#include <functional>
 #include <atomic>
 #include <list>
 #include <unordered_map>
@@ -11,8 +13,10 @@
 #include "ChunkGenerator.hpp"
 #include "WorldOctreeNode.hpp"
 #include "HashMap.hpp"
+#include "EditLayer.hpp"
 #include "sparsepp/spp.h"
 #include <map>
+#include <vector>
 
 class WorldWatcher : public ThreadDebug
 {
@@ -37,6 +41,10 @@ public:
 	ChunkGenerator generator;
 	std::condition_variable upload_cv;
 
+	// Called with the renderables mutex held whenever a node stops being drawn,
+	// so whoever owns its gl_chunk can take it back
+	std::function<void(class WorldOctreeNode*)> release_callback;
+
 	emilib::HashMap<MortonCode, WorldOctreeNode*> leaf_nodes;
 	//emilib::HashMap<MortonCode, DMCNode*> chunk_nodes;
 	spp::sparse_hash_map<MortonCode, DMCNode*> chunk_nodes;
@@ -47,9 +55,15 @@ private:
 	std::thread _thread;
 	std::atomic<bool> _stop;
 
-	void check_leaves(SmartContainer<class WorldOctreeNode*>& batch_out, const int max_gen);
-	void handle_split_check(class WorldOctreeNode* n, SmartContainer<class WorldOctreeNode*>& batch_out);
+	// Split candidates of the current update, highest priority first
+	std::vector<std::pair<float, class WorldOctreeNode*>> split_candidates;
+	// Edits made since the last update
+	std::vector<BrushEdit> new_edits;
+
+	void check_leaves(const glm::vec3& pos, SmartContainer<class WorldOctreeNode*>& batch_out, const int max_gen);
+	bool handle_split_check(class WorldOctreeNode* n, SmartContainer<class WorldOctreeNode*>& batch_out);
 	void handle_group_check(class WorldOctreeNode* n, SmartContainer<class WorldOctreeNode*>& batch_out);
+	void check_edits(SmartContainer<class WorldOctreeNode*>& generate_batch_out);
 
 	void process_batch(SmartContainer<class WorldOctreeNode*>& batch_in, SmartContainer<class WorldOctreeNode*>& batch_out, SmartContainer<class WorldOctreeNode*>& stitch_batch);
 	void post_process_batch(SmartContainer<class WorldOctreeNode*>& batch_in);
@@ -57,6 +71,7 @@ private:
 	void group_node_1(class WorldOctreeNode* n, SmartContainer<class WorldOctreeNode*>& generate_batch_out);
 	void process_stitching(SmartContainer<class WorldOctreeNode*>& batch_in);
 
+	void release_meshes(class WorldOctreeNode* n);
 	void unlink_renderable(class WorldOctreeNode* n);
 	void push_back_renderable(class WorldOctreeNode* n);
 
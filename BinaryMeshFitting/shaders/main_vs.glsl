@@ -1,7 +1,8 @@
 #version 400 core
 
+// Packed vertices, see PackedVertex.hpp: unorm16 positions in the chunk's box, octahedral normals
 attribute vec3 vertex_position;
-attribute vec3 vertex_normal;
+attribute vec2 vertex_normal;
 attribute vec3 vertex_color;
 uniform mat4 projection;
 uniform mat4 view;
@@ -11,6 +12,8 @@ uniform float specular_power;
 uniform vec3 camera_pos;
 uniform vec4 chunk_pos;
 uniform float chunk_depth;
+uniform vec3 chunk_box_min;
+uniform vec3 chunk_box_size;
 
 out vec3 f_normal;
 out vec3 f_color;
@@ -22,16 +25,27 @@ out float log_z;
 out vec4 f_world_pos;
 out float f_chunk_depth;
 
+vec3 unpack_octahedral(vec2 e)
+{
+	e = e * 2.0 - 1.0;
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	if (n.z < 0.0)
+		n.xy = (1.0 - abs(e.yx)) * mix(vec2(-1.0), vec2(1.0), step(0.0, e));
+	return normalize(n);
+}
+
 void main()
 {
-	f_normal = normalize(vertex_normal);
-	f_color = vertex_normal;
+	vec3 local_pos = chunk_box_min + vertex_position * chunk_box_size;
+
+	f_normal = unpack_octahedral(vertex_normal);
+	f_color = vertex_color;
 	f_mul_color = mul_color;
 	f_smooth_shading = smooth_shading;
 	f_specular_power = specular_power;
-	f_ec_pos = vertex_position;
+	f_ec_pos = local_pos;
 
-	vec3 world_pos = vertex_position * chunk_pos.w + chunk_pos.xyz;
+	vec3 world_pos = local_pos * chunk_pos.w + chunk_pos.xyz;
 	
 	gl_Position = projection * view * vec4(world_pos - camera_pos, 1);
 	f_world_pos = vec4(world_pos, chunk_pos.w);
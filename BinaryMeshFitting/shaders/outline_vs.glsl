@@ -5,6 +5,8 @@ uniform mat4 view;
 uniform vec3 mul_color;
 uniform vec3 camera_pos;
 uniform vec4 chunk_pos;
+uniform vec3 chunk_box_min;
+uniform vec3 chunk_box_size;
 
 out vec3 f_mul_color;
 out float log_z;
@@ -12,7 +14,7 @@ out float log_z;
 void main()
 {
 	f_mul_color = mul_color;
-	gl_Position = projection * view * vec4(vertex_position * chunk_pos.w + chunk_pos.xyz - camera_pos, 1);
+	gl_Position = projection * view * vec4((chunk_box_min + vertex_position * chunk_box_size) * chunk_pos.w + chunk_pos.xyz - camera_pos, 1);
 	const float near = 0.000001;
 	const float far = 1000.0;
 	const float C = 0.001;